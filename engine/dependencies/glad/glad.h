@@ -5168,4 +5168,7 @@ GLAPI PFNGLPOLYGONOFFSETCLAMPPROC glad_glPolygonOffsetClamp;
 
 #endif
 
-#undef APIENTRY
\ No newline at end of file
+//Windows.h defines its own APIENTRY
+#ifdef _WIN32
+#undef APIENTRY
+#endif
\ No newline at end of file
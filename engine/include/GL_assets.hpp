@@ -2,50 +2,205 @@
 #define QRK_GL_ASSETS
 
 #include "../glad/glad.h"
+#include "../include/gl_state.hpp"
 #include "../include/qrk_debug.hpp"
+#ifdef _WIN32
 #include <Windows.h>
+#endif
+#include <chrono>
+#include <cstdint>
 #include <filesystem>
+#include <initializer_list>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace qrk::assets {
 
-inline GLuint boundProgramID = 0;
+///////////////////////////////////////////////////////////////////////////
+// Linked programs saved to disk with glGetProgramBinary, so later launches
+// load them instead of compiling. Every program is a file named by a hash
+// of its sources, its defines and the vendor, renderer and version of the
+// driver, so a changed shader or driver misses the cache instead of
+// loading a stale binary. Binaries the driver rejects are compiled from
+// source again and replaced.
+///////////////////////////////////////////////////////////////////////////
+class ProgramCache {
+public:
+    /// Binaries are kept in directory, which is created by the first
+    /// Store. An empty directory disables the cache. Needs a current
+    /// context
+    explicit ProgramCache(std::filesystem::path _directory);
+
+    /// False without a directory or when the driver has no binary formats
+    bool IsEnabled() const { return enabled; }
+    uint64_t GetKey(const std::string &vertexCode,
+                    const std::string &fragmentCode,
+                    const std::string &defines = "") const;
+    /// Link program from its cached binary, false when there is none or
+    /// the driver rejected it
+    bool Load(GLuint program, uint64_t key);
+    /// Save a linked program, compileTime is the milliseconds loading it
+    /// saves from now on
+    void Store(GLuint program, uint64_t key, float compileTime);
+
+    int GetLoadedCount() const { return loadedCount; }
+    int GetCompiledCount() const { return compiledCount; }
+    /// Compile time of the loaded programs minus the time loading them
+    /// took, in milliseconds
+    float GetTimeSaved() const { return timeSaved; }
+
+private:
+    std::filesystem::path directory;
+    bool enabled = false;
+    std::string driver;
+    int loadedCount = 0;
+    int compiledCount = 0;
+    float timeSaved = 0.f;
+
+    std::filesystem::path GetPath(uint64_t key) const;
+};
+
+/// Look up GL_KHR_parallel_shader_compile, or the ARB version of it, once
+/// glad is loaded. glad is generated without extensions, getProcAddress
+/// is the loader glad was given
+void LoadParallelShaderCompile(void *(*getProcAddress)(const char *));
+/// True when the driver compiles on its own threads and can be asked
+/// whether a program is done without waiting for it
+bool HasParallelShaderCompile();
 
 class Program {
 public:
     Program() : programHandle(NULL), uniformBlockIndex(NULL) {}
-    Program(const std::string &vertexPath, const std::string &fragmentPath) {
-        programHandle = glCreateProgram();
-        if (!Compile(vertexPath, fragmentPath)) {
-            qrk::debug::Error(
-                    "Failed to compile shader. Vertex path: " + vertexPath +
-                            " Fragment shader: " + fragmentPath,
-                    qrk::debug::Q_FAILED_TO_COMPILE_SHADER);
-        }
-        glUseProgram(programHandle);
-        uniformBlockIndex =
-                glGetUniformBlockIndex(programHandle, "uniformBlock");
+    /// Compile and link right away, cache is checked before compiling and
+    /// receives the linked program
+    Program(const std::string &vertexPath, const std::string &fragmentPath,
+            ProgramCache *cache = nullptr) {
+        Submit(vertexPath, fragmentPath, cache);
+        Finish();
     }
 
+    /// Hand both shaders and the link to the driver without waiting for
+    /// any of them. cache has to live until Finish. defines are inserted
+    /// after the #version line of both shaders
+    void Submit(const std::string &vertexPath,
+                const std::string &fragmentPath,
+                ProgramCache *cache = nullptr,
+                const std::string &defines = "");
+    /// True when Finish would not wait for the driver. Without parallel
+    /// compile this is only known once it has been waited for
+    bool IsReady() const;
+    /// Wait for the link and check it, the program is usable afterwards.
+    /// Does nothing when the program is not pending
+    void Finish();
+    bool IsPending() const { return pending; }
+
     void UseProgram() {
-        glUseProgram(this->programHandle);
-        boundProgramID = this->programHandle;
+        if (pending) { Finish(); }
+        qrk::glState.UseProgram(this->programHandle);
     }
 
     GLuint programHandle;
     GLuint uniformBlockIndex;
 
 private:
-    bool Compile(const std::string &vertexPath,
-                 const std::string &fragmentPath);
+    //state of a submitted build until Finish
+    bool pending = false;
+    GLuint vertexShader = 0;
+    GLuint fragmentShader = 0;
+    ProgramCache *cache = nullptr;
+    uint64_t key = 0;
+    std::chrono::steady_clock::time_point compileStart;
+    std::string vertexPath;
+    std::string fragmentPath;
+
+    void Fail(const std::string &message) const;
+};
+
+///////////////////////////////////////////////////////////////////////////
+// Builds a batch of programs without serializing on the driver. Every
+// program is submitted before any status is read, so with parallel
+// compile the driver works on all of them at once on its own threads and
+// Poll finishes the ones that are done without blocking. Without it the
+// driver still gets every shader before the first wait. Programs are
+// referenced, so they have to stay where they are until finished. Programs
+// that are still pending finish on their first UseProgram.
+///////////////////////////////////////////////////////////////////////////
+class ProgramBuilder {
+public:
+    /// cache is handed to every program, it has to outlive the build
+    explicit ProgramBuilder(ProgramCache *_cache = nullptr);
+
+    void Add(Program &program, const std::string &vertexPath,
+             const std::string &fragmentPath,
+             const std::string &defines = "");
+    /// Finish the programs the driver is done with, true once none is
+    /// left. Blocks on every program without parallel compile
+    bool Poll();
+    /// Wait for every program
+    void Finish();
+    size_t GetPendingCount() const { return programs.size(); }
+
+private:
+    ProgramCache *cache;
+    std::vector<Program *> programs;
 };
+
+///////////////////////////////////////////////////////////////////////////
+// Variants of one program specialized at compile time. Every feature is a
+// #define set to 1 when its bit is in the variant and to 0 otherwise, so
+// the shaders pick their code with #if instead of branching on uniforms.
+// A variant is compiled the first time it is asked for and goes through
+// the program cache like any other program, its defines are part of the
+// key. Variants never move once created.
+///////////////////////////////////////////////////////////////////////////
+class ProgramVariants {
+public:
+    ProgramVariants() = default;
+    /// Bit i of a variant sets features[i]. cache has to outlive the
+    /// variants
+    ProgramVariants(std::string _vertexPath, std::string _fragmentPath,
+                    std::vector<std::string> _features,
+                    ProgramCache *_cache = nullptr)
+        : vertexPath(std::move(_vertexPath)),
+          fragmentPath(std::move(_fragmentPath)),
+          features(std::move(_features)), cache(_cache) {}
+
+    /// Start compiling the variant ahead of its first use, the builder
+    /// finishes it
+    void Prepare(uint32_t variant, ProgramBuilder &builder);
+    /// The program of the variant, compiled now when it does not exist.
+    /// It finishes compiling on its first UseProgram
+    Program &Get(uint32_t variant);
+    size_t GetVariantCount() const { return variants.size(); }
+
+private:
+    std::string vertexPath;
+    std::string fragmentPath;
+    std::vector<std::string> features;
+    ProgramCache *cache = nullptr;
+    std::unordered_map<uint32_t, std::unique_ptr<Program>> variants;
+
+    std::string GetDefines(uint32_t variant) const;
+};
+
+/// One float attribute of a vertex format, offset is relative to the
+/// vertex start in the buffer attached to binding
+struct VertexAttribute {
+    GLuint index;
+    GLint size;
+    GLuint offset;
+    GLuint binding = 0;
+};
+
+/// Declare the attribute formats of a VAO once, so draws only bind the VAO
+void SetVertexFormat(GLuint VAO,
+                     std::initializer_list<VertexAttribute> attributes);
 }// namespace qrk::assets
 namespace qrk {
-inline GLuint GetBoundProgram() { return qrk::assets::boundProgramID; }
-inline void UnbindProgram() {
-    glUseProgram(0);
-    qrk::assets::boundProgramID = 0;
-}
+inline GLuint GetBoundProgram() { return qrk::glState.GetProgram(); }
+inline void UnbindProgram() { qrk::glState.UseProgram(0); }
 }// namespace qrk
 
 #endif// !QRK_GL_ASSETS
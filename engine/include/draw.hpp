@@ -1,41 +1,88 @@
 #ifndef Q_DRAW
 #define Q_DRAW
 
-#define Q_POINT 0
-#define Q_DIRECTIONAL 1
-
 #include "../include/GL_assets.hpp"
+#include "../include/draw_sort.hpp"
+#include "../include/dynamic_bvh.hpp"
+#include "../include/frame_arena.hpp"
+#include "../include/handle_pool.hpp"
+#include "../include/job_pool.hpp"
+#include "../include/light_clusters.hpp"
+#include "../include/light_pool.hpp"
 #include "../include/matrix.hpp"
+#include "../include/mesh_pool.hpp"
+#include "../include/pass_profiler.hpp"
+#include "../include/ring_buffer.hpp"
+#include "../include/sprite_batch.hpp"
 #include "../include/texture.hpp"
 #include "../include/vector.hpp"
-#include "../include/window.hpp"
+#include "../include/render_surface.hpp"
+#include <cfloat>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
 #include <vector>
 
 namespace qrk {
+struct Material {
+    float shininess = 25.f;
+    char padding[12];
+    vec3f specular = qrk::vec3f({0.5f, 0.5f, 0.5f});
+    vec3f diffuse = qrk::vec3f({0.8f, 0.8f, 0.8f});
+    vec3f ambient = qrk::vec3f({1.f, 1.f, 1.f});
+};
+inline bool operator==(const Material &lhs, const Material &rhs) {
+    return lhs.shininess == rhs.shininess &&
+           lhs.specular.data == rhs.specular.data &&
+           lhs.diffuse.data == rhs.diffuse.data &&
+           lhs.ambient.data == rhs.ambient.data;
+}
+/// Hashes the bits of the fields operator== compares, not the padding.
+/// Mixed, so the low bits can index a table
+struct MaterialHash {
+    uint64_t operator()(const Material &material) const {
+        float values[10] = {material.shininess};
+        std::memcpy(&values[1], material.specular.data.data(), 12);
+        std::memcpy(&values[4], material.diffuse.data.data(), 12);
+        std::memcpy(&values[7], material.ambient.data.data(), 12);
+        uint64_t hash = 0;
+        for (float value : values) {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            hash = hash * 31 + bits;
+        }
+        hash *= 0x9E3779B97F4A7C15ull;
+        return hash ^ (hash >> 32);
+    }
+};
+
 //draw data types
 struct DrawData_3D {
     GLuint VAO = 0;
     GLuint VBO = 0;
+    /// Id of the mesh in VBO, see GLMesh
+    uint32_t mesh = 0;
     qrk::Texture2D *texture = nullptr;
     bool textured = false;
 
     GLsizei vertexCount = 0;
 
-    mat4 position = qrk::identity4();
-    mat4 rotation = qrk::identity4();
-    mat4 scale = qrk::identity4();
+    mat4 model = qrk::identity4();
     ColorF color = qrk::ColorF(1.f, 1.f, 1.f, 1.f);
+    Material material;
+    /// Bounds of the mesh before the model matrix, for the scene queries
+    /// over retained draws
+    qrk::AABB bounds;
 };
 struct DrawData_2D {
-    GLuint VAO = 0;
-    GLuint VBO = 0;
     qrk::vec2f position = qrk::vec2f({0, 0});
     qrk::vec2f size = qrk::vec2f({100, 100});
     qrk::ColorF color = {1.f, 1.f, 1.f, 1.f};
     float zLayer = 0.f;
     qrk::Texture2D *texture = nullptr;
     float rotation = 0.f;
-    GLsizei vertexCount = 0;
+    /// Normalized offset and size of the sampled texture region
+    qrk::vec4f uvRect = qrk::vec4f({0, 0, 1, 1});
 };
 struct DrawData_Text {
     GLuint VAO = 0;
@@ -44,35 +91,60 @@ struct DrawData_Text {
     qrk::ColorF color = {1.f, 1.f, 1.f, 1.f};
     qrk::Texture2D *texture = nullptr;
     GLsizei vertexCount = 0;
+    /// Vertices to upload into VBO before drawing, position and texture
+    /// position of every vertex. Null when unchanged
+    const GLfloat *vertices = nullptr;
 };
 template<typename T>
 concept drawDataStruct =
         std::is_same_v<T, DrawData_3D> || std::is_same_v<T, DrawData_2D> ||
         std::is_same_v<T, DrawData_Text>;
 
-struct Material {
-    float shininess = 25.f;
-    char padding[12];
-    vec3f specular = qrk::vec3f({0.5f, 0.5f, 0.5f});
-    vec3f diffuse = qrk::vec3f({0.8f, 0.8f, 0.8f});
-    vec3f ambient = qrk::vec3f({1.f, 1.f, 1.f});
+/// Stable reference to a draw retained by the renderer, see AddRenderable
+struct RenderHandle {
+    qrk::PoolHandle handle;
+    /// Pass of the draw, picks the pool it is kept in
+    qrk::DrawPass pass = qrk::Q_PASS_OPAQUE;
+
+    bool IsValid() const { return handle.IsValid(); }
+};
+
+/// Features the 3d programs are specialized for at compile time,
+/// each is a #define of the shaders. The bits of a draw pick its variant
+enum ShaderFeature : uint32_t {
+    /// TEXTURED, the texture of the draw is sampled
+    Q_FEATURE_TEXTURED = 1 << 0,
+    /// NUM_LIGHTS, shaded with the clustered point lights instead of unlit
+    Q_FEATURE_LIGHTS = 1 << 1,
+    /// VERTEX_FORMAT, position only vertices for the depth pre-pass
+    Q_FEATURE_POSITION_ONLY = 1 << 2
 };
+
 struct UniformData3D {
-    qrk::mat4 position = identity4();
-    qrk::mat4 rotation = identity4();
-    qrk::mat4 scale = identity4();
     qrk::mat4 view = identity4();
     qrk::mat4 projection = identity4();
-    qrk::vec4f color = qrk::vec4f({1, 1, 1, 1});
     qrk::vec4f cameraPosition = qrk::vec4f({0, 0, 0, 0});
-    Material material;
+    /// Maps log(w) to a light cluster slice, scale then bias in xy
+    qrk::vec4f clusterDepth = qrk::vec4f({0, 0, 0, 0});
 };
-struct UniformData2D {
-    qrk::mat4 rotation = identity4();
-    qrk::vec2f position = qrk::vec2f({0, 0});
-    qrk::vec2f size = qrk::vec2f({1, 1});
+/// Per instance data of the 3d pass, read from the instance SSBO (std430)
+struct InstanceData3D {
+    qrk::mat4 model = identity4();
     qrk::vec4f color = qrk::vec4f({1, 1, 1, 1});
-    float zLayer = 0.f;
+    /// Index into the materials of the frame
+    GLuint material = 0;
+    char padding[12];
+};
+static_assert(sizeof(InstanceData3D) == 96,
+              "InstanceData3D does not match the std430 Instance struct");
+static_assert(sizeof(Material) == 64,
+              "Material does not match the std430 Material struct");
+/// Layout glMultiDrawArraysIndirect reads its commands in
+struct DrawArraysIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint first;
+    GLuint baseInstance;
 };
 struct UniformDataText {
     qrk::vec4f color = qrk::vec4f({1, 1, 1, 1});
@@ -80,56 +152,74 @@ struct UniformDataText {
     float zLayer = 0.f;
     char padding[4];
 };
-struct LightSource {
-    LightSource() {
-        position = qrk::vec3f({0.f, 0.f, 0.f});
-        lightType = Q_POINT;
-
-        constant = 0.f;
-        linear = 1.f;
-        quadratic = 0.f;
+struct RendererSettings {
+    bool depthTest = true;
+    bool cullFaces = true;
+    bool alpha = true;
+    bool multisample = true;
+    /// Stream per draw uniform data through a persistently mapped ring
+    /// buffer instead of glBufferSubData on a shared buffer
+    bool persistentMapping = true;
+    /// Threads used for CPU side draw preparation, 0 picks one per core
+    unsigned int workerThreads = 0;
+    /// Time every pass on the CPU and the GPU, see GetProfiler
+    bool profilePasses = false;
+    /// Write the depth of the 3d draws in a position only pass first, so
+    /// the 3d pass only shades the fragments that end up visible. Needs
+    /// depthTest
+    bool depthPrepass = false;
+    /// Directory linked programs are cached in between launches, empty
+    /// compiles them from source every time
+    std::string programCacheDirectory = "cache/programs";
+};
 
-        ambient = qrk::vec3f({0.1f, 0.1f, 0.1f});
-        diffuse = qrk::vec3f({1.f, 1.f, 1.f});
-        specular = qrk::vec3f({0.3f, 0.3f, 0.3f});
+///////////////////////////////////////////////////////////////////////////
+// Draw queue owned by one recording thread. Lists are filled without any
+// locking and handed to the renderer with SubmitDrawList.
+///////////////////////////////////////////////////////////////////////////
+class DrawList {
+public:
+    template<drawDataStruct draw_t>
+    void QueueDraw(const draw_t &drawData, bool UI = false) {
+        if constexpr (std::is_same_v<draw_t, DrawData_3D>) {
+            objects3d.push_back(drawData);
+        } else if constexpr (std::is_same_v<draw_t, DrawData_2D>) {
+            if (UI) {
+                objectsUI.push_back(drawData);
+            } else {
+                objects2d.push_back(drawData);
+            }
+        } else if constexpr (std::is_same_v<draw_t, DrawData_Text>) {
+            text.push_back(drawData);
+        }
     }
-    LightSource(const qrk::vec3f &_position, const qrk::Color &color) {
-        position = _position;
-        lightType = Q_POINT;
 
-        constant = 0.f;
-        linear = 1.f;
-        quadratic = 0.f;
-
-        qrk::ColorF cf = qrk::ConvertToFloat(color);
-        ambient = qrk::vec3f({cf.r * 0.1f, cf.g * 0.1f, cf.b * 0.1f});
-        diffuse = qrk::vec3f({cf.r, cf.g, cf.b});
-        specular = qrk::vec3f({cf.r * 0.3f, cf.g * 0.3f, cf.b * 0.3f});
+    void Clear() {
+        objects3d.clear();
+        objects2d.clear();
+        objectsUI.clear();
+        text.clear();
+    }
+    bool Empty() const {
+        return objects3d.empty() && objects2d.empty() && objectsUI.empty() &&
+               text.empty();
     }
 
-    int lightType;
-    float constant;
-    float linear;
-    float quadratic;
-
-    vec3f position;
+private:
+    friend class qb_GL_Renderer;
 
-    vec3f ambient;
-    vec3f diffuse;
-    vec3f specular;
+    std::vector<DrawData_3D> objects3d;
+    std::vector<DrawData_2D> objects2d;
+    std::vector<DrawData_2D> objectsUI;
+    std::vector<DrawData_Text> text;
 };
 
-struct RendererSettings {
-    bool depthTest = true;
-    bool cullFaces = true;
-    bool alpha = true;
-    bool multisample = true;
-};
+class RetainedDraw;
 
 class qb_GL_Renderer {
 public:
     qb_GL_Renderer() = delete;
-    qb_GL_Renderer(qrk::glWindow &_targetWindow,
+    qb_GL_Renderer(qrk::RenderSurface &_targetWindow,
                    qrk::RendererSettings _settings = {true, true, true, true});
     ~qb_GL_Renderer() {}
 
@@ -150,56 +240,291 @@ public:
         }
     }
 
-    void AddLightSource(const qrk::LightSource &lightSource) {
-        q_3dLightSources.push_back(lightSource);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightSource_SSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER,
-                     q_3dLightSources.size() * sizeof(LightSource),
-                     q_3dLightSources.data(), GL_DYNAMIC_COPY);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    //light sources are uploaded by the next Draw, so these can be called
+    //while another thread owns the context. Only the lights changed since
+    //the last Draw are sent
+    qrk::LightHandle AddLightSource(const qrk::LightSource &lightSource) {
+        std::lock_guard<std::mutex> lock(submitMutex);
+        lightsDirty = true;
+        return lightPool.Add(lightSource);
     }
-    void RemoveLightSource(size_t index) {
-        q_3dLightSources.erase(q_3dLightSources.begin() + index);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightSource_SSBO);
-        glBufferData(GL_SHADER_STORAGE_BUFFER,
-                     q_3dLightSources.size() * sizeof(LightSource),
-                     q_3dLightSources.data(), GL_DYNAMIC_COPY);
-        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    void UpdateLightSource(qrk::LightHandle handle,
+                           const qrk::LightSource &lightSource) {
+        std::lock_guard<std::mutex> lock(submitMutex);
+        lightPool.Update(handle, lightSource);
+        lightsDirty = true;
+    }
+    void RemoveLightSource(qrk::LightHandle handle) {
+        std::lock_guard<std::mutex> lock(submitMutex);
+        lightPool.Remove(handle);
+        lightsDirty = true;
     }
 
-    void Draw();
+    //retained draws are drawn every frame until they are removed, without
+    //being queued again. Changes are applied by the next Draw, so these
+    //can be called from any thread. Retained 3d draws keep their instance
+    //data on the GPU and only the changed instances are uploaded. What a
+    //draw points to, textures and meshes, has to outlive it. Text vertices
+    //are copied before these return
+    template<drawDataStruct draw_t>
+    qrk::RenderHandle AddRenderable(const draw_t &drawData, bool UI = false) {
+        std::lock_guard<std::mutex> lock(submitMutex);
+        qrk::DrawPass pass = qrk::Q_PASS_TEXT;
+        if constexpr (std::is_same_v<draw_t, DrawData_3D>) {
+            pass = qrk::Q_PASS_OPAQUE;
+            retainedResized = true;
+        } else if constexpr (std::is_same_v<draw_t, DrawData_2D>) {
+            pass = UI ? qrk::Q_PASS_UI : qrk::Q_PASS_2D;
+        }
+        qrk::PoolHandle handle = RetainedPool<draw_t>(pass).Add(drawData);
+        if constexpr (std::is_same_v<draw_t, DrawData_3D>) {
+            IndexRetained3d(handle, drawData);
+        } else if constexpr (std::is_same_v<draw_t, DrawData_Text>) {
+            StoreRetainedText(handle, drawData);
+        }
+        return {handle, pass};
+    }
+    template<drawDataStruct draw_t>
+    void UpdateRenderable(qrk::RenderHandle handle, const draw_t &drawData) {
+        std::lock_guard<std::mutex> lock(submitMutex);
+        bool matches = handle.pass == qrk::Q_PASS_TEXT;
+        if constexpr (std::is_same_v<draw_t, DrawData_3D>) {
+            matches = handle.pass == qrk::Q_PASS_OPAQUE;
+        } else if constexpr (std::is_same_v<draw_t, DrawData_2D>) {
+            matches = handle.pass == qrk::Q_PASS_2D ||
+                      handle.pass == qrk::Q_PASS_UI;
+        }
+        if (!matches) {
+            qrk::debug::Warning("Updating a draw that is not retained");
+            return;
+        }
+        qrk::HandlePool<draw_t> &pool = RetainedPool<draw_t>(handle.pass);
+        const draw_t *current = pool.Get(handle.handle);
+        if (current == nullptr) {
+            qrk::debug::Warning("Updating a draw that is not retained");
+            return;
+        }
+        if constexpr (std::is_same_v<draw_t, DrawData_Text>) {
+            if (drawData.vertices != nullptr) {
+                StoreRetainedText(handle.handle, drawData);
+                return;
+            }
+            //keep a mesh change that was not uploaded yet
+            draw_t update = drawData;
+            update.vertices = current->vertices;
+            pool.Update(handle.handle, update);
+            return;
+        }
+        pool.Update(handle.handle, drawData);
+        if constexpr (std::is_same_v<draw_t, DrawData_3D>) {
+            IndexRetained3d(handle.handle, drawData);
+        }
+    }
+    void RemoveRenderable(qrk::RenderHandle handle);
+
+    /// callback(handle) for every retained 3d draw whose world bounds
+    /// intersect the frustum, found through a BVH instead of walking every
+    /// draw. The renderer stays locked during the callbacks, they must not
+    /// add, update or remove renderables
+    template<typename callback_t>
+    void QueryRenderables(const qrk::Frustum &frustum, callback_t &&callback) {
+        std::lock_guard<std::mutex> lock(submitMutex);
+        retainedBVH.QueryFrustum(frustum, [&](uint32_t proxy) {
+            qrk::PoolHandle handle = GetRetainedHandle(proxy);
+            const qrk::AABB &box = retainedBounds[handle.slot].box;
+            if (qrk::TestFrustum(frustum, box) != qrk::Q_OUTSIDE) {
+                callback(qrk::RenderHandle{handle, qrk::Q_PASS_OPAQUE});
+            }
+            return true;
+        });
+    }
+    /// Same as above for the draws whose world bounds overlap box
+    template<typename callback_t>
+    void QueryRenderables(const qrk::AABB &box, callback_t &&callback) {
+        std::lock_guard<std::mutex> lock(submitMutex);
+        retainedBVH.QueryOverlap(box, [&](uint32_t proxy) {
+            qrk::PoolHandle handle = GetRetainedHandle(proxy);
+            if (qrk::Overlaps(retainedBounds[handle.slot].box, box)) {
+                callback(qrk::RenderHandle{handle, qrk::Q_PASS_OPAQUE});
+            }
+            return true;
+        });
+    }
+    /// The retained 3d draw whose world bounds the ray enters first within
+    /// maxDistance, invalid when it hits none. distance is set on a hit
+    qrk::RenderHandle PickRenderable(qrk::vec3f origin, qrk::vec3f direction,
+                                     float maxDistance = FLT_MAX,
+                                     float *distance = nullptr);
+
+    /// Hand a recorded list to the next frame, safe to call from any
+    /// thread. Lists are merged in ascending sequence order after the draws
+    /// queued directly, so the frame does not depend on which thread
+    /// finished first. Sequences should be unique, 0 is used by a threaded
+    /// RenderWindow. The list is left empty
+    void SubmitDrawList(DrawList &list, uint32_t sequence);
+    /// Close the frame being recorded, lists submitted later go to the
+    /// frame after it. Called once per drawn frame
+    void EndRecording();
+
+    /// Memory for data the draws of the frame being recorded point to,
+    /// like text meshes. It stays valid until that frame was drawn, so
+    /// every thread recording the frame can use it. Frames alternate
+    /// between two arenas, the next frame is recorded into one while the
+    /// last one is drawn from the other
+    std::pmr::memory_resource *GetFrameArena() {
+        std::lock_guard<std::mutex> lock(submitMutex);
+        return &frameArenas[recordingArena];
+    }
+    /// The most bytes a single frame took from its arena
+    size_t GetFrameArenaHighWaterMark() const {
+        return std::max(frameArenas[0].GetHighWaterMark(),
+                        frameArenas[1].GetHighWaterMark());
+    }
+
+    void Draw() {
+        EndRecording();
+        Draw(targetWindow->GetSize());
+    }
+    /// Draw the frame closed by the last EndRecording. The target size is
+    /// passed in when the window is resized on another thread
+    void Draw(qrk::vec2u screenSize);
+
+    /// Per pass timings of finished frames, recorded when profilePasses
+    /// is set. Safe to read while another thread draws
+    const qrk::PassProfiler &GetProfiler() const { return profiler; }
 
 private:
+    ///////////////////////////////////////////////////////////////////////
+    // 3d draws sorted and laid out for multi draw indirect. Instances are
+    // in sorted order, every command reads a contiguous range of them
+    // starting at its base instance.
+    ///////////////////////////////////////////////////////////////////////
+    struct Batch3D {
+        std::vector<InstanceData3D> instances;
+        std::vector<Material> materials;
+        //materials by MaterialHash, linearly probed. Holds the index into
+        //materials plus one, 0 is empty. Kept at most half full
+        std::vector<GLuint> materialTable;
+        std::vector<DrawArraysIndirectCommand> commands;
+        //first command and texture of every texture run, one multi draw
+        //each
+        std::vector<size_t> textureRuns;
+        std::vector<qrk::Texture2D *> runTextures;
+        //commands past this one belong to the depth pre-pass
+        size_t colorCommands = 0;
+        //sort key and color pass command of every instance, and the
+        //instance every queued draw ended up at
+        std::vector<uint64_t> keys;
+        std::vector<GLuint> instanceCommands;
+        std::vector<uint32_t> positions;
+
+        //where the batch was uploaded to
+        GLuint instanceBuffer = 0;
+        GLintptr instanceOffset = 0;
+        GLuint materialBuffer = 0;
+        GLintptr materialOffset = 0;
+        GLuint commandBuffer = 0;
+        GLintptr commandOffset = 0;
+    };
+
     //vectors containing draw queue
     std::vector<DrawData_3D> q_3dObjects;
     std::vector<DrawData_2D> q_2dObjects;
     std::vector<DrawData_2D> q_UIObjects;
     std::vector<DrawData_Text> q_Text;
-    std::vector<LightSource> q_3dLightSources;
+    qrk::LightPool lightPool;
+    //lists submitted from recording threads, merged at the start of Draw
+    std::vector<std::pair<uint32_t, DrawList>> submittedLists;
+    std::vector<std::pair<uint32_t, DrawList>> recordedLists;
+    //merged lists keep their capacity and are handed back on submission
+    std::vector<DrawList> recycledLists;
+    std::mutex submitMutex;
+    //arena of the frame being recorded and of the frame being drawn, the
+    //drawn one is reset once the frame is done
+    qrk::FrameArena frameArenas[2];
+    unsigned int recordingArena = 0;
+    unsigned int drawingArena = 0;
+    bool lightsDirty = false;
+    //retained draws, guarded by submitMutex. 2d and text draws are added
+    //to the queues of every frame
+    qrk::HandlePool<DrawData_3D> retained3d;
+    qrk::HandlePool<DrawData_2D> retained2d;
+    qrk::HandlePool<DrawData_2D> retainedUI;
+    qrk::HandlePool<DrawData_Text> retainedText;
+    //retained draws whose owner changed since the last EndRecording,
+    //guarded by submitMutex. Sent by EndRecording from the second list
+    std::vector<RetainedDraw *> retainedDirty;
+    std::vector<RetainedDraw *> retainedFlushing;
+    //copies of the retained text meshes by pool slot, the vertices of a
+    //retained text point here until the next Draw takes them
+    std::vector<std::vector<GLfloat>> retainedTextMeshes;
+    bool retainedResized = false;
+    //world bounds of the retained 3d draws by pool slot and the tree over
+    //them, guarded by submitMutex
+    struct RetainedBounds {
+        uint32_t proxy = qrk::DynamicBVH::nullNode;
+        qrk::AABB box;
+    };
+    std::vector<RetainedBounds> retainedBounds;
+    qrk::DynamicBVH retainedBVH;
+    qrk::JobPool jobs;
+    //sort keys for the queue currently being submitted
+    std::vector<SortKey> sortKeys;
+    std::vector<SortKey> sortScratch;
 
-
-    //3d draw program and associated 3d draw specific uniform locations
-    qrk::assets::Program q_3dDraw;
+    //linked programs kept between launches, the variants compiled later
+    //go through it as well
+    qrk::assets::ProgramCache programCache;
+    //3d draw program variants, see ShaderFeature
+    qrk::assets::ProgramVariants q_3dDraw;
     qrk::UniformData3D UBO3D_Data;
     GLuint UBO3D;
-    GLuint textureID_3d;
-    GLuint texturedID_3d;
-    GLuint lightSource_SSBO;
+    GLuint instance_SSBO;
+    GLuint material_SSBO;
+    GLuint indirectBuffer;
+    Batch3D frameBatch;
+    //retained 3d draws copied over from retained3d by the drawing thread.
+    //Their batch stays resident and is only sorted again when draws are
+    //added or removed, or change mesh, texture or to a new material
+    std::vector<DrawData_3D> retained3dDraws;
+    std::vector<uint32_t> retainedChanges;
+    std::vector<uint32_t> retainedUploads;
+    bool retainedSorted = false;
+    Batch3D retainedBatch;
+    GLuint retainedInstanceBuffer;
+    GLuint retainedMaterialBuffer;
+    GLuint retainedCommandBuffer;
+    //the depth pre-pass draws the position only 3d variant, its commands
+    //are sorted front to back
+    std::vector<SortKey> depthKeys;
+    //every 3d mesh copied into one buffer, so one VAO draws the pass
+    qrk::assets::MeshPool meshPool;
+    //point lights binned per view cluster, rebuilt when the lights or the
+    //projection change. The copy is owned by the drawing thread
+    qrk::LightClusters lightClusters;
+    std::vector<LightSource> clusteredLights;
+    bool clustersDirty = true;
+    float clusterAspect = 0.f;
 
-    //2d draw program and associated 2d draw specific uniform locations;
+    //2d draw program, every sprite samples a texture
     qrk::assets::Program q_2dDraw;
-    qrk::UniformData2D UBO2D_Data;
-    GLuint UBO2D;
-    GLuint textureID_2d;
-    GLuint texturedID_2d;
-    //text draw program and associated uniform locations
+    qrk::SpriteBatch spriteBatch;
+    //text draw program
     qrk::assets::Program q_textDraw;
     qrk::UniformDataText UBO_Text_data;
     GLuint UBO_Text;
-    GLuint textureID_Text;
+
+    //per frame uniform and instance data when persistent mapping is enabled
+    qrk::assets::RingBuffer uniformRing;
+    GLint uniformAlignment = 256;
+    GLint storageAlignment = 256;
+    qrk::PassProfiler profiler;
 
     //misc variables
-    qrk::glWindow *targetWindow;
+    qrk::RenderSurface *targetWindow;
+    qrk::RendererSettings settings;
+    float nearPlane = 1.f;
+    float farPlane = 100.f;
 
     void Queue3dDraw(const DrawData_3D &drawData) {
         q_3dObjects.push_back(drawData);
@@ -213,6 +538,155 @@ private:
     void QueueTextDraw(const DrawData_Text &drawData) {
         q_Text.push_back(drawData);
     }
+
+    template<typename uniform_t>
+    void UploadUniformBlock(GLuint index, GLuint buffer,
+                            const uniform_t &data) {
+        if (settings.persistentMapping) {
+            GLintptr offset = uniformRing.Write(&data, sizeof(uniform_t),
+                                                uniformAlignment);
+            qrk::glState.BindBufferRange(GL_UNIFORM_BUFFER, index,
+                                         uniformRing.GetHandle(), offset,
+                                         sizeof(uniform_t));
+        } else {
+            qrk::glState.BindBufferBase(GL_UNIFORM_BUFFER, index, buffer);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(uniform_t), &data);
+        }
+    }
+    GLsizeiptr EstimateFrameUpload() const;
+    void MergeDrawLists();
+
+    template<drawDataStruct draw_t>
+    qrk::HandlePool<draw_t> &RetainedPool(qrk::DrawPass pass) {
+        if constexpr (std::is_same_v<draw_t, DrawData_3D>) {
+            return retained3d;
+        } else if constexpr (std::is_same_v<draw_t, DrawData_2D>) {
+            return pass == qrk::Q_PASS_UI ? retainedUI : retained2d;
+        } else {
+            return retainedText;
+        }
+    }
+
+    void IndexRetained3d(qrk::PoolHandle handle, const DrawData_3D &drawData);
+    friend class RetainedDraw;
+    void MarkRetainedDirty(RetainedDraw &retained);
+    void UnmarkRetainedDirty(RetainedDraw &retained);
+    void MoveRetainedDirty(RetainedDraw &from, RetainedDraw &to);
+    void FlushRetained();
+    void StoreRetainedText(qrk::PoolHandle handle,
+                           const DrawData_Text &drawData);
+    qrk::PoolHandle GetRetainedHandle(uint32_t proxy) const {
+        uint64_t packed = retainedBVH.GetUserData(proxy);
+        return {static_cast<uint32_t>(packed),
+                static_cast<uint32_t>(packed >> 32)};
+    }
+
+    static constexpr GLuint noMaterial = UINT32_MAX;
+    /// Index of the material in the batch, added when add is set and
+    /// noMaterial when it is missing otherwise
+    GLuint FindMaterial(Batch3D &batch, const Material &material, bool add);
+    uint64_t Create3dSortKey(const DrawData_3D &object) const;
+    void Build3dBatch(const std::vector<DrawData_3D> &queue, Batch3D &batch);
+    void Upload3dBatch(Batch3D &batch);
+    void UpdateRetainedBatch();
+    void Bind3dBatch(const Batch3D &batch) const;
+    void Draw3dQueue();
+    void Draw2dQueue(std::vector<DrawData_2D> &queue, DrawPass pass,
+                     qrk::vec2u screenSize);
+    template<typename draw_t>
+    void SortLayeredQueue(const std::vector<draw_t> &queue, DrawPass pass) {
+        sortKeys.resize(queue.size());
+        jobs.ParallelFor(queue.size(), 1024, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                sortKeys[i] = {qrk::CreateLayeredSortKey(pass, queue[i].zLayer),
+                               static_cast<uint32_t>(i)};
+            }
+        });
+        qrk::RadixSort(sortKeys, sortScratch);
+    }
+};
+
+///////////////////////////////////////////////////////////////////////////
+// Owns a draw retained by a renderer and removes it again when destroyed.
+// Lives as a member of the object it draws. Changes of the owner are only
+// marked, the renderer takes the draw data of every marked owner once
+// when the frame is closed by EndRecording, which must not run while the
+// owner changes. Copies start out unregistered, so copied objects never
+// share a draw. Has to be released before the renderer is destroyed.
+///////////////////////////////////////////////////////////////////////////
+class RetainedDraw {
+public:
+    RetainedDraw() = default;
+    RetainedDraw(const RetainedDraw &) {}
+    RetainedDraw(RetainedDraw &&other) noexcept { TakeOver(other); }
+    RetainedDraw &operator=(const RetainedDraw &other) {
+        if (this != &other) { Release(); }
+        return *this;
+    }
+    RetainedDraw &operator=(RetainedDraw &&other) noexcept {
+        if (this != &other) {
+            Release();
+            TakeOver(other);
+        }
+        return *this;
+    }
+    ~RetainedDraw() { Release(); }
+
+    /// Retain the draw of owner, which this is a member of. The owner
+    /// gives its draw through GetDrawData
+    template<typename owner_t>
+    void Register(qb_GL_Renderer &_renderer, owner_t &owner,
+                  bool UI = false) {
+        Release();
+        renderer = &_renderer;
+        ownerOffset = reinterpret_cast<char *>(this) -
+                      reinterpret_cast<char *>(&owner);
+        send = &Send<owner_t>;
+        handle = renderer->AddRenderable(owner.GetDrawData(), UI);
+    }
+    /// The owner changed, its draw is sent once with the next frame
+    void MarkDirty() {
+        if (renderer != nullptr && dirtyIndex == notDirty) {
+            renderer->MarkRetainedDirty(*this);
+        }
+    }
+    void Release() {
+        if (renderer == nullptr) { return; }
+        if (dirtyIndex != notDirty) { renderer->UnmarkRetainedDirty(*this); }
+        renderer->RemoveRenderable(handle);
+        renderer = nullptr;
+    }
+    bool IsRegistered() const { return renderer != nullptr; }
+
+private:
+    friend class qb_GL_Renderer;
+    static constexpr uint32_t notDirty = UINT32_MAX;
+
+    qb_GL_Renderer *renderer = nullptr;
+    qrk::RenderHandle handle;
+    //bytes from the owner to this member, the same after the owner moved
+    std::ptrdiff_t ownerOffset = 0;
+    void (*send)(RetainedDraw &) = nullptr;
+    //position in the dirty list of the renderer, guarded by its lock
+    uint32_t dirtyIndex = notDirty;
+
+    template<typename owner_t>
+    static void Send(RetainedDraw &retained) {
+        owner_t *owner = reinterpret_cast<owner_t *>(
+                reinterpret_cast<char *>(&retained) - retained.ownerOffset);
+        retained.renderer->UpdateRenderable(retained.handle,
+                                            owner->GetDrawData());
+    }
+    void TakeOver(RetainedDraw &other) {
+        renderer = other.renderer;
+        handle = other.handle;
+        ownerOffset = other.ownerOffset;
+        send = other.send;
+        if (renderer != nullptr && other.dirtyIndex != notDirty) {
+            renderer->MoveRetainedDirty(other, *this);
+        }
+        other.renderer = nullptr;
+    }
 };
 }// namespace qrk
 
@@ -0,0 +1,67 @@
+#ifndef Q_DRAW_SORT
+#define Q_DRAW_SORT
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+///////////////////////////////////////////////////////////////////////////
+// 64 bit draw sort keys. Every queued draw gets a key, the queues are
+// radix sorted once per frame and then submitted in key order.
+//
+// 3d key layout (msb -> lsb):
+// | pass 2 | program 6 | texture 16 | VAO 16 | depth 24 |
+//
+// The program field holds the shader features of the draw, so draws of
+// the same program variant are adjacent.
+//
+// Layered keys (2d, UI, text) only carry the pass and the layer. The radix
+// sort is stable, so draws on the same layer keep their submission order.
+///////////////////////////////////////////////////////////////////////////
+namespace qrk {
+enum DrawPass : uint64_t {
+    Q_PASS_OPAQUE = 0,
+    Q_PASS_2D = 1,
+    Q_PASS_UI = 2,
+    Q_PASS_TEXT = 3,
+    /// Depth pre-pass of the 3d draws, only used to profile it and never
+    /// part of a sort key
+    Q_PASS_DEPTH = 4
+};
+
+struct SortKey {
+    uint64_t key;
+    uint32_t index;
+};
+
+constexpr uint64_t Q_KEY_DEPTH_BITS = 24;
+constexpr uint64_t Q_KEY_DEPTH_MAX = (1ull << Q_KEY_DEPTH_BITS) - 1;
+
+/// Quantize a value between 0 and 1 into the 24 depth bits of a key
+inline uint64_t QuantizeDepth(float depth) {
+    depth = std::clamp(depth, 0.f, 1.f);
+    return static_cast<uint64_t>(depth * static_cast<float>(Q_KEY_DEPTH_MAX));
+}
+
+inline uint64_t CreateSortKey(DrawPass pass, uint32_t program,
+                              uint32_t texture, uint32_t VAO, float depth) {
+    return (static_cast<uint64_t>(pass) << 62) |
+           ((static_cast<uint64_t>(program) & 0x3F) << 56) |
+           ((static_cast<uint64_t>(texture) & 0xFFFF) << 40) |
+           ((static_cast<uint64_t>(VAO) & 0xFFFF) << 24) |
+           QuantizeDepth(depth);
+}
+
+/// Layer in the range used by SetLayer (-1 to 1), lower layers come first
+inline uint64_t CreateLayeredSortKey(DrawPass pass, float zLayer) {
+    //zLayer is stored negated, so a bigger z means a lower layer
+    return (static_cast<uint64_t>(pass) << 62) |
+           (QuantizeDepth((1.f - zLayer) * 0.5f) << 38);
+}
+
+/// Stable LSD radix sort on 8 bit digits. Digits shared by every key are
+/// skipped, so short keys only pay for the passes they use.
+void RadixSort(std::vector<SortKey> &keys, std::vector<SortKey> &scratch);
+}// namespace qrk
+
+#endif// !Q_DRAW_SORT
@@ -0,0 +1,213 @@
+#ifndef Q_DYNAMIC_BVH
+#define Q_DYNAMIC_BVH
+
+#include "../dependencies/glad/glad.h"
+#include "../include/vector.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace qrk {
+/// Axis aligned box, min must not be above max on any axis
+struct AABB {
+    float min[3] = {0, 0, 0};
+    float max[3] = {0, 0, 0};
+};
+
+inline AABB Union(const AABB &lhs, const AABB &rhs) {
+    AABB result;
+    for (int i = 0; i < 3; i++) {
+        result.min[i] = std::min(lhs.min[i], rhs.min[i]);
+        result.max[i] = std::max(lhs.max[i], rhs.max[i]);
+    }
+    return result;
+}
+/// Surface area, the cost the tree minimizes
+inline float SurfaceArea(const AABB &box) {
+    float x = box.max[0] - box.min[0];
+    float y = box.max[1] - box.min[1];
+    float z = box.max[2] - box.min[2];
+    return 2.f * (x * y + y * z + z * x);
+}
+inline bool Overlaps(const AABB &lhs, const AABB &rhs) {
+    for (int i = 0; i < 3; i++) {
+        if (lhs.max[i] < rhs.min[i] || rhs.max[i] < lhs.min[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+inline bool Contains(const AABB &outer, const AABB &inner) {
+    for (int i = 0; i < 3; i++) {
+        if (inner.min[i] < outer.min[i] || inner.max[i] > outer.max[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+/// Box around a box transformed by an affine model matrix
+AABB TransformAABB(const AABB &box, const qrk::mat4 &model);
+/// Distance along the ray to where it enters the box, direction does not
+/// have to be normalized. False when it misses or enters past maxDistance
+bool IntersectRay(const AABB &box, const float origin[3],
+                  const float inverseDirection[3], float maxDistance,
+                  float &distance);
+
+/// Planes of a view volume, ax + by + cz + d >= 0 inside every one
+struct Frustum {
+    float planes[6][4];
+};
+/// Frustum of projection * view, for OpenGL clip space
+Frustum CreateFrustum(const qrk::mat4 &viewProjection);
+enum FrustumTest { Q_OUTSIDE, Q_INTERSECTING, Q_INSIDE };
+FrustumTest TestFrustum(const Frustum &frustum, const AABB &box);
+
+///////////////////////////////////////////////////////////////////////////
+// Dynamic AABB tree for scene queries. Leaves hold a box enlarged by a
+// margin, moving an object only touches the tree once its box leaves the
+// enlarged one. A leaf is inserted next to the sibling that adds the
+// least surface area, found by branch and bound, and the nodes above it
+// are refit and rotated where swapping a child with a grandchild lowers
+// their area. Proxies are node indices and stay valid until removed.
+// Queries reuse a stack, so like everything else they are not
+// synchronized.
+///////////////////////////////////////////////////////////////////////////
+class DynamicBVH {
+public:
+    static constexpr uint32_t nullNode = UINT32_MAX;
+
+    /// margin enlarges the leaf boxes on every side
+    explicit DynamicBVH(float _margin = 0.1f) : margin(_margin) {}
+
+    uint32_t Insert(const AABB &box, uint64_t userData);
+    void Remove(uint32_t proxy);
+    /// Refit for the new box of the object. True when it left the enlarged
+    /// box and the leaf was inserted again
+    bool Move(uint32_t proxy, const AABB &box);
+
+    /// Enlarged box of the leaf
+    const AABB &GetBox(uint32_t proxy) const { return nodes[proxy].box; }
+    uint64_t GetUserData(uint32_t proxy) const {
+        return nodes[proxy].userData;
+    }
+    size_t GetProxyCount() const { return proxyCount; }
+    int GetHeight() const {
+        return root == nullNode ? 0 : nodes[root].height;
+    }
+    /// Area of the inner nodes over the area of the root, lower is a
+    /// better tree
+    float GetAreaRatio() const;
+
+    /// callback(proxy) for every leaf overlapping box, returns false to
+    /// stop the query
+    template<typename callback_t>
+    void QueryOverlap(const AABB &box, callback_t &&callback) {
+        if (root == nullNode) { return; }
+        stack.clear();
+        stack.push_back(root);
+        while (!stack.empty()) {
+            uint32_t index = stack.back();
+            stack.pop_back();
+            const Node &node = nodes[index];
+            if (!Overlaps(node.box, box)) { continue; }
+            if (node.IsLeaf()) {
+                if (!callback(index)) { return; }
+            } else {
+                stack.push_back(node.child1);
+                stack.push_back(node.child2);
+            }
+        }
+    }
+    /// callback(proxy) for every leaf intersecting the frustum, returns
+    /// false to stop the query. Subtrees inside the frustum are not tested
+    /// any further
+    template<typename callback_t>
+    void QueryFrustum(const Frustum &frustum, callback_t &&callback) {
+        if (root == nullNode) { return; }
+        stack.clear();
+        stack.push_back(root);
+        while (!stack.empty()) {
+            uint32_t index = stack.back() & ~insideBit;
+            bool inside = (stack.back() & insideBit) != 0;
+            stack.pop_back();
+            const Node &node = nodes[index];
+            if (!inside) {
+                FrustumTest test = TestFrustum(frustum, node.box);
+                if (test == Q_OUTSIDE) { continue; }
+                inside = test == Q_INSIDE;
+            }
+            if (node.IsLeaf()) {
+                if (!callback(index)) { return; }
+            } else {
+                uint32_t flag = inside ? insideBit : 0;
+                stack.push_back(node.child1 | flag);
+                stack.push_back(node.child2 | flag);
+            }
+        }
+    }
+    /// callback(proxy) for every leaf the ray enters within maxDistance,
+    /// returns the distance to clip the ray to. Returning maxDistance
+    /// keeps searching, 0 stops
+    template<typename callback_t>
+    void QueryRay(qrk::vec3f origin, qrk::vec3f direction, float maxDistance,
+                  callback_t &&callback) {
+        if (root == nullNode) { return; }
+        float start[3] = {origin.x(), origin.y(), origin.z()};
+        float inverse[3] = {1.f / direction.x(), 1.f / direction.y(),
+                            1.f / direction.z()};
+        stack.clear();
+        stack.push_back(root);
+        while (!stack.empty() && maxDistance > 0.f) {
+            uint32_t index = stack.back();
+            stack.pop_back();
+            const Node &node = nodes[index];
+            float distance;
+            if (!IntersectRay(node.box, start, inverse, maxDistance,
+                              distance)) {
+                continue;
+            }
+            if (node.IsLeaf()) {
+                maxDistance = std::min(maxDistance, callback(index));
+            } else {
+                stack.push_back(node.child1);
+                stack.push_back(node.child2);
+            }
+        }
+    }
+
+private:
+    //marks subtrees on the frustum query stack that are fully inside
+    static constexpr uint32_t insideBit = 1u << 31;
+
+    struct Node {
+        AABB box;
+        uint64_t userData = 0;
+        //next free node while the node is free
+        uint32_t parent = nullNode;
+        uint32_t child1 = nullNode;
+        uint32_t child2 = nullNode;
+        //0 for leaves, -1 for free nodes
+        int32_t height = 0;
+
+        bool IsLeaf() const { return child1 == nullNode; }
+    };
+
+    std::vector<Node> nodes;
+    uint32_t root = nullNode;
+    uint32_t freeList = nullNode;
+    size_t proxyCount = 0;
+    float margin;
+    std::vector<uint32_t> stack;
+
+    uint32_t AllocateNode();
+    void FreeNode(uint32_t index);
+    void InsertLeaf(uint32_t leaf);
+    void RemoveLeaf(uint32_t leaf);
+    uint32_t FindBestSibling(const AABB &box) const;
+    void Rotate(uint32_t index);
+    //refits the boxes and heights from index up to the root
+    void Refit(uint32_t index, bool rotate);
+};
+}// namespace qrk
+
+#endif// !Q_DYNAMIC_BVH
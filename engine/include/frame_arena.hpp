@@ -0,0 +1,69 @@
+#ifndef Q_FRAME_ARENA
+#define Q_FRAME_ARENA
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+namespace qrk {
+///////////////////////////////////////////////////////////////////////////
+// Linear allocator for data that only lives until the end of a frame.
+// Allocating bumps an offset into one block, deallocating does nothing and
+// Reset drops everything at once. Requests that do not fit go to the heap
+// and the next Reset replaces the block with one big enough for that
+// frame, so frames of a steady size stop allocating from the heap. Usable
+// from any thread, Reset must not overlap allocations. The high water mark
+// can be read at any time. Plugs into the std::pmr containers as their
+// memory resource.
+///////////////////////////////////////////////////////////////////////////
+class FrameArena : public std::pmr::memory_resource {
+public:
+    explicit FrameArena(size_t initialSize = 1 << 16);
+    ~FrameArena() override { ReleaseOverflow(); }
+
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    /// Drop every allocation of the frame. Constant time unless the frame
+    /// overflowed the block
+    void Reset();
+
+    /// Bytes taken by the current frame, including alignment
+    size_t GetUsed() const;
+    /// Most bytes a single frame took since the arena was created
+    size_t GetHighWaterMark() const { return highWaterMark.load(); }
+    size_t GetCapacity() const { return capacity; }
+    /// Heap allocations made by the arena itself, blocks and overflow
+    size_t GetHeapAllocations() const { return heapAllocations; }
+
+private:
+    struct Overflow {
+        void *memory;
+        size_t bytes;
+        size_t alignment;
+    };
+
+    std::unique_ptr<std::byte[]> block;
+    size_t capacity;
+    std::atomic<size_t> offset;
+    //requests the block could not hold, freed by Reset
+    std::mutex overflowMutex;
+    std::vector<Overflow> overflow;
+    size_t overflowBytes = 0;
+    std::atomic<size_t> highWaterMark = 0;
+    size_t heapAllocations = 0;
+
+    void *do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void *, size_t, size_t) override {}
+    bool do_is_equal(
+            const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+    void ReleaseOverflow();
+};
+}// namespace qrk
+
+#endif// !Q_FRAME_ARENA
@@ -0,0 +1,142 @@
+#ifndef Q_GL_STATE
+#define Q_GL_STATE
+
+#include "../dependencies/glad/glad.h"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+namespace qrk {
+enum GLStateKind {
+    Q_STATE_PROGRAM,
+    Q_STATE_VERTEX_ARRAY,
+    Q_STATE_BUFFER,
+    Q_STATE_TEXTURE,
+    Q_STATE_UNIFORM_BLOCK,
+    Q_STATE_UNIFORM,
+    /// Capabilities, depth, color and blend state
+    Q_STATE_FIXED_FUNCTION
+};
+constexpr size_t Q_STATE_KIND_COUNT = 7;
+
+/// Name of a kind of state for reports
+const char *StateKindName(GLStateKind kind);
+
+/// Calls that went through the state cache, by the kind of state they set
+struct GLStateStats {
+    /// Calls handed to GL
+    uint64_t issued[Q_STATE_KIND_COUNT] = {};
+    /// Calls dropped because the state was already set
+    uint64_t elided[Q_STATE_KIND_COUNT] = {};
+
+    uint64_t TotalIssued() const;
+    uint64_t TotalElided() const;
+};
+
+///////////////////////////////////////////////////////////////////////////
+// Shadow copy of the GL state the engine sets, every bind, uniform and
+// fixed function change of the engine goes through it and is dropped when
+// it would not change anything. Uniform values and uniform block bindings
+// are kept per program, so they survive switching programs. State starts
+// out unknown, the first call of every kind is always issued. Deleting
+// objects through the cache forgets their bindings, GL calls that bypass
+// it have to be followed by Invalidate. Only one context is tracked and
+// nothing is synchronized, it belongs to the thread the context is
+// current on.
+///////////////////////////////////////////////////////////////////////////
+class GLStateCache {
+public:
+    GLStateCache() { Invalidate(); }
+
+    void UseProgram(GLuint program);
+    GLuint GetProgram() const { return program == unknown ? 0 : program; }
+    void BindVertexArray(GLuint vertexArray);
+    void BindBuffer(GLenum target, GLuint buffer);
+    void BindBufferBase(GLenum target, GLuint index, GLuint buffer);
+    void BindBufferRange(GLenum target, GLuint index, GLuint buffer,
+                         GLintptr offset, GLsizeiptr size);
+    void ActiveTexture(GLenum unit);
+    /// Binds to the active unit
+    void BindTexture(GLenum target, GLuint texture);
+    void UniformBlockBinding(GLuint program, GLuint blockIndex,
+                             GLuint binding);
+    /// Uniforms of the bound program
+    void Uniform1i(GLint location, GLint value);
+    void Uniform2f(GLint location, GLfloat x, GLfloat y);
+    void Enable(GLenum capability) { SetCapability(capability, true); }
+    void Disable(GLenum capability) { SetCapability(capability, false); }
+    void DepthFunc(GLenum function);
+    void DepthMask(GLboolean mask);
+    void ColorMask(GLboolean red, GLboolean green, GLboolean blue,
+                   GLboolean alpha);
+    void BlendFunc(GLenum source, GLenum destination);
+    void CullFace(GLenum face);
+
+    void DeleteBuffers(GLsizei count, const GLuint *buffers);
+    void DeleteTextures(GLsizei count, const GLuint *textures);
+    void DeleteVertexArrays(GLsizei count, const GLuint *vertexArrays);
+
+    /// Forget all state, after a new context or GL calls that bypassed
+    /// the cache
+    void Invalidate();
+    /// Close the current frame, its counts become the last frame
+    void EndFrame();
+    /// Counts of the last closed frame
+    const GLStateStats &LastFrame() const { return lastFrame; }
+    /// Counts since the last frame boundary
+    const GLStateStats &Recorded() const { return recorded; }
+
+private:
+    static constexpr GLuint unknown = UINT32_MAX;
+    static constexpr int bufferTargetCount = 9;
+    static constexpr int indexedBindingCount = 16;
+    static constexpr int textureUnitCount = 16;
+
+    struct IndexedBinding {
+        GLuint buffer;
+        GLintptr offset;
+        //-1 for the whole buffer
+        GLsizeiptr size;
+    };
+
+    GLuint program;
+    GLuint vertexArray;
+    GLuint buffers[bufferTargetCount];
+    //uniform buffers first, then shader storage buffers
+    IndexedBinding indexedBuffers[2][indexedBindingCount];
+    GLenum activeUnit;
+    GLuint textures[textureUnitCount];
+    GLenum depthFunction;
+    GLenum blendSource, blendDestination;
+    GLenum cullFace;
+    //unknown, or the mask bits
+    GLuint depthMask;
+    GLuint colorMask;
+    std::unordered_map<GLenum, bool> capabilities;
+    //keyed by program and block index or location
+    std::unordered_map<uint64_t, GLuint> blockBindings;
+    std::unordered_map<uint64_t, uint64_t> uniforms;
+
+    GLStateStats recorded;
+    GLStateStats lastFrame;
+
+    //index into buffers, -1 for targets that are not cached
+    static int BufferSlot(GLenum target);
+    static uint64_t Key(GLuint program, GLuint index) {
+        return (uint64_t) program << 32 | index;
+    }
+    //counts the call, true when it has to be issued
+    bool Changed(GLStateKind kind, bool changed) {
+        (changed ? recorded.issued : recorded.elided)[kind]++;
+        return changed;
+    }
+    bool SetUniform(GLint location, uint64_t value);
+    void SetCapability(GLenum capability, bool enabled);
+    void SetIndexed(GLenum target, GLuint index, IndexedBinding binding);
+};
+
+/// State of the current context
+inline GLStateCache glState;
+}// namespace qrk
+
+#endif// !Q_GL_STATE
@@ -49,13 +49,23 @@ public:
     Text() = default;
     explicit Text(qrk::Font &_font) {
         font = &_font;
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
+        glCreateVertexArrays(1, &VAO);
+        glCreateBuffers(1, &VBO);
+        //vertex position then texture position
+        glVertexArrayVertexBuffer(VAO, 0, VBO, 0, 4 * sizeof(GLfloat));
+        qrk::assets::SetVertexFormat(VAO,
+                                     {{0, 2, 0}, {1, 2, 2 * sizeof(GLfloat)}});
     }
     ~Text() = default;
+    //moves keep the retained draw, copies start out unregistered
+    Text(const Text &) = default;
+    Text(Text &&) noexcept = default;
+    Text &operator=(const Text &) = default;
+    Text &operator=(Text &&) noexcept = default;
 
     void SetText(const std::string &_text) {
         text = _text;
+        meshDirty = true;
         float _textWidth = 0;
         for (int i = 0; i < text.size(); i++) {
             qrk::Font::GlyphData *glyph = font->GetGlyphData(text[i]);
@@ -63,32 +73,60 @@ public:
         }
         _textWidth /= 2;
         textWidth = std::round(_textWidth);
+        SendChanges();
     }
     std::string GetText() { return text; }
 
     int GetWidth() const { return textWidth; }
     int GetHeight() const { return font->fontHeight / 3; }
 
-    void SetColor(const qrk::Color &_color) { color = _color; }
+    void SetColor(const qrk::Color &_color) {
+        color = _color;
+        SendChanges();
+    }
     qrk::Color GetColor() const { return color; }
 
     void SetPosition(const float x, const float y) {
         position = qrk::vec2f({x, y});
+        meshDirty = true;
+        SendChanges();
     }
     qrk::vec2f GetPosition() { return position; }
 
-    void SetSpacing(int _spacing) { spacing = _spacing; }
+    void SetSpacing(int _spacing) {
+        spacing = _spacing;
+        meshDirty = true;
+        SendChanges();
+    }
 
     /// Set z layer betwen -1 and 1
     void SetLayer(const float layer) {
         zLayer = -std::clamp(layer, -0.999f, 0.999f);
+        SendChanges();
     }
 
+    /// Does no GL work, so it can be called from a recording thread. The
+    /// glyph mesh is rebuilt only after the text changed and is uploaded by
+    /// the renderer, the text must not change until that frame is drawn
     qrk::DrawData_Text GetDrawData();
+    /// Same as GetDrawData, but a changed mesh is built in the frame arena
+    /// of the renderer, so the text can change again right away
+    qrk::DrawData_Text GetDrawData(std::pmr::memory_resource *frameArena);
+
+    /// Keep drawing the text with the renderer until Unregister, instead
+    /// of queueing it every frame. The setters mark the text changed from
+    /// then on, its mesh is rebuilt and copied by the renderer once per
+    /// recorded frame
+    void Register(qrk::qb_GL_Renderer &renderer) {
+        retained.Register(renderer, *this);
+    }
+    void Unregister() { retained.Release(); }
 
 private:
     GLuint VAO = 0;
     GLuint VBO = 0;
+    std::vector<GLfloat> vertexArray;
+    bool meshDirty = true;
 
     qrk::Font *font;
     float spacing = 0;
@@ -98,6 +136,12 @@ private:
     qrk::vec2f position = qrk::vec2f({0, 0});
     qrk::Color color = {255, 255, 255, 255};
     float zLayer = 0.f;
+    qrk::RetainedDraw retained;
+
+    qrk::DrawData_Text CreateDrawData() const;
+    /// 6 vertices of 4 floats for every glyph
+    void WriteMesh(GLfloat *vertices);
+    void SendChanges() { retained.MarkDirty(); }
 };
 }// namespace qrk
 
@@ -0,0 +1,119 @@
+#ifndef Q_HANDLE_POOL
+#define Q_HANDLE_POOL
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace qrk {
+/// Stable reference to an element of a HandlePool. The generation tells a
+/// removed element apart from a later one reusing its slot
+struct PoolHandle {
+    static constexpr uint32_t invalidSlot = UINT32_MAX;
+
+    uint32_t slot = invalidSlot;
+    uint32_t generation = 0;
+
+    bool IsValid() const { return slot != invalidSlot; }
+};
+
+///////////////////////////////////////////////////////////////////////////
+// Elements kept densely packed behind stable handles. Adding appends,
+// removing moves the last element into the hole, so both are O(1) and
+// handles stay valid while the elements move. Every change marks the dense
+// indices it wrote, owners mirror or upload only those and clear the marks
+// afterwards. Not synchronized.
+///////////////////////////////////////////////////////////////////////////
+template<typename T>
+class HandlePool {
+public:
+    PoolHandle Add(const T &element) {
+        uint32_t slot;
+        if (freeSlots.empty()) {
+            slot = static_cast<uint32_t>(slotElements.size());
+            slotElements.push_back(0);
+            generations.push_back(0);
+        } else {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        uint32_t index = static_cast<uint32_t>(elements.size());
+        slotElements[slot] = index;
+        elements.push_back(element);
+        elementSlots.push_back(slot);
+        MarkDirty(index);
+        return {slot, generations[slot]};
+    }
+    /// False when the handle was already removed
+    bool Update(PoolHandle handle, const T &element) {
+        if (!Contains(handle)) { return false; }
+        uint32_t index = slotElements[handle.slot];
+        elements[index] = element;
+        MarkDirty(index);
+        return true;
+    }
+    /// False when the handle was already removed
+    bool Remove(PoolHandle handle) {
+        if (!Contains(handle)) { return false; }
+        uint32_t index = slotElements[handle.slot];
+        uint32_t last = static_cast<uint32_t>(elements.size() - 1);
+        if (index != last) {
+            elements[index] = std::move(elements[last]);
+            elementSlots[index] = elementSlots[last];
+            slotElements[elementSlots[index]] = index;
+            MarkDirty(index);
+        }
+        elements.pop_back();
+        elementSlots.pop_back();
+        generations[handle.slot]++;
+        freeSlots.push_back(handle.slot);
+        return true;
+    }
+    bool Contains(PoolHandle handle) const {
+        //removing an element bumps the generation of its slot
+        return handle.slot < generations.size() &&
+               generations[handle.slot] == handle.generation;
+    }
+    /// The element behind a handle, nullptr when it was removed
+    const T *Get(PoolHandle handle) const {
+        if (!Contains(handle)) { return nullptr; }
+        return &elements[slotElements[handle.slot]];
+    }
+
+    /// Elements in dense order, the order shifts when elements are removed
+    const std::vector<T> &GetElements() const { return elements; }
+    std::vector<T> &GetElements() { return elements; }
+    size_t Size() const { return elements.size(); }
+
+    /// Dense indices changed since the last ClearDirty, each once and in
+    /// no particular order. Indices past the end belong to removed elements
+    std::vector<uint32_t> &GetDirty() { return dirty; }
+    void ClearDirty() {
+        for (uint32_t index : dirty) { dirtyFlags[index] = false; }
+        dirty.clear();
+    }
+
+private:
+    std::vector<T> elements;
+    //dense index of every slot, and the slot of every dense element
+    std::vector<uint32_t> slotElements;
+    std::vector<uint32_t> generations;
+    std::vector<uint32_t> freeSlots;
+    std::vector<uint32_t> elementSlots;
+    //flagged to dedupe the dirty indices
+    std::vector<uint32_t> dirty;
+    std::vector<bool> dirtyFlags;
+
+    void MarkDirty(uint32_t index) {
+        if (index >= dirtyFlags.size()) {
+            dirtyFlags.resize(index + 1, false);
+        }
+        if (dirtyFlags[index]) { return; }
+        dirtyFlags[index] = true;
+        dirty.push_back(index);
+    }
+};
+}// namespace qrk
+
+#endif// !Q_HANDLE_POOL
@@ -0,0 +1,89 @@
+#ifndef Q_HEADLESS_SURFACE
+#define Q_HEADLESS_SURFACE
+
+#include "../dependencies/glad/glad.h"
+#include "../include/color.hpp"
+#include "../include/qrk_debug.hpp"
+#include "../include/vector.hpp"
+#include <string>
+#include <vector>
+
+//window styles have no meaning without a window
+#define Q_WINDOW_DEFAULT 0
+#define Q_WINDOW_NONRESIZABLE 0
+
+namespace qrk {
+struct WindowSettings {
+    int windowStyle = Q_WINDOW_DEFAULT;
+    int multisamplingLevel = 8;
+    qrk::Color clearColor = {255, 255, 255, 255};
+    int glMajorVersion = 4;
+    int glMinorVersion = 6;
+};
+
+///////////////////////////////////////////////////////////////////////////
+// Offscreen stand in for glWindow in headless builds. Creates a context
+// through EGL without any surface (Mesa llvmpipe works, no GPU or display
+// server is needed) and renders into a framebuffer object of the requested
+// size. Exposes the parts of the glWindow interface the renderer and the
+// render window use, window messages are no-ops. With the null GL backend
+// no context is created and GL calls are only recorded.
+///////////////////////////////////////////////////////////////////////////
+class HeadlessSurface {
+public:
+    HeadlessSurface(const std::string &surfaceName, qrk::vec2u size,
+                    qrk::WindowSettings settings =
+                            {Q_WINDOW_DEFAULT, 8, {255, 255, 255, 255}, 4, 6});
+    ~HeadlessSurface() { Close(); }
+
+    HeadlessSurface(const HeadlessSurface &) = delete;
+    HeadlessSurface &operator=(const HeadlessSurface &) = delete;
+
+    bool IsOpen() const { return open; }
+    void Close();
+    bool IsContextCurrent();
+    void MakeContextCurrent() const;
+    void ReleaseContext() const;
+    void SetContextDetached(bool detached) {}
+
+    void SetClearColor(qrk::Color _clearColor) {
+        qrk::ColorF fColor = qrk::ConvertToFloat(_clearColor);
+        glClearColor(fColor.r, fColor.g, fColor.b, fColor.a);
+    }
+    void Clear() { glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); }
+    /// There is nothing to present, the submitted commands are flushed.
+    /// Ends the frame of the null backend
+    void SwapWindowBuffers() const;
+    void SetSwapInterval(int interval) {}
+    void GetWindowMessage() const {}
+
+    qrk::vec2u GetSize() const {
+        if (!open) { return qrk::vec2u({0, 0}); }
+        return size;
+    }
+
+    /// Read back the last frame as tightly packed RGBA8 rows, bottom row
+    /// first. Waits for the GPU to finish
+    void ReadPixels(std::vector<unsigned char> &pixels);
+
+private:
+    void *display;
+    void *context;
+    bool open;
+    qrk::vec2u size;
+
+    //render target, multisampled when requested and resolved on readback
+    int samples;
+    GLuint framebuffer;
+    GLuint colorBuffer;
+    GLuint depthBuffer;
+    GLuint resolveFramebuffer;
+    GLuint resolveBuffer;
+
+    void CreateContext(int glMajorVersion, int glMinorVersion);
+    void DestroyContext();
+    void CreateFramebuffer();
+};
+}// namespace qrk
+
+#endif// !Q_HEADLESS_SURFACE
\ No newline at end of file
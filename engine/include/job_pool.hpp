@@ -0,0 +1,75 @@
+#ifndef Q_JOB_POOL
+#define Q_JOB_POOL
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace qrk {
+///////////////////////////////////////////////////////////////////////////
+// Small pool of worker threads for data parallel CPU work. ParallelFor
+// splits a range into chunks, the workers and the calling thread take
+// chunks until the range is done. Jobs must not throw and must only write
+// to their own part of the output, which keeps results independent of
+// how the chunks were scheduled.
+///////////////////////////////////////////////////////////////////////////
+class JobPool {
+public:
+    /// threadCount 0 uses one worker less than the hardware threads, the
+    /// calling thread is the last one
+    explicit JobPool(unsigned int threadCount = 0);
+    ~JobPool();
+
+    JobPool(const JobPool &) = delete;
+    JobPool &operator=(const JobPool &) = delete;
+
+    /// Call func(begin, end) over [0, count) in chunks of grain items and
+    /// block until every chunk is done. Not reentrant
+    template<typename func_t>
+    void ParallelFor(size_t count, size_t grain, const func_t &func) {
+        //func outlives the call, so it is only referenced, never copied
+        Job job = {&func, [](const void *func, size_t begin, size_t end) {
+                       (*static_cast<const func_t *>(func))(begin, end);
+                   }};
+        ParallelFor(count, grain, job);
+    }
+
+    unsigned int GetThreadCount() const {
+        return static_cast<unsigned int>(workers.size()) + 1;
+    }
+
+private:
+    //type erased reference to the callable of a ParallelFor
+    struct Job {
+        const void *func;
+        void (*call)(const void *func, size_t begin, size_t end);
+
+        void operator()(size_t begin, size_t end) const {
+            call(func, begin, end);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    bool stopping = false;
+
+    //the job currently being run
+    const Job *job = nullptr;
+    size_t jobCount = 0;
+    size_t jobGrain = 1;
+    std::atomic<size_t> nextChunk = 0;
+    size_t activeWorkers = 0;
+    uint64_t generation = 0;
+
+    void ParallelFor(size_t count, size_t grain, const Job &func);
+    void WorkerLoop();
+    void RunChunks();
+};
+}// namespace qrk
+
+#endif// !Q_JOB_POOL
\ No newline at end of file
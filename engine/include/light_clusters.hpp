@@ -0,0 +1,69 @@
+#ifndef Q_LIGHT_CLUSTERS
+#define Q_LIGHT_CLUSTERS
+
+#include "../dependencies/glad/glad.h"
+#include "../include/matrix.hpp"
+#include "../include/vector.hpp"
+#include <utility>
+#include <vector>
+
+namespace qrk {
+struct LightSource;
+
+//cluster grid, must match the defines in 3d_fragment_shader.frag
+constexpr int Q_CLUSTERS_X = 16;
+constexpr int Q_CLUSTERS_Y = 9;
+constexpr int Q_CLUSTERS_Z = 24;
+constexpr int Q_CLUSTER_COUNT = Q_CLUSTERS_X * Q_CLUSTERS_Y * Q_CLUSTERS_Z;
+
+/// Distance at which a point light no longer changes an 8 bit channel, or
+/// a negative value when its attenuation never gets there
+float LightRange(const LightSource &light);
+
+///////////////////////////////////////////////////////////////////////////
+// Clustered forward light culling. The 3d pass lights fragments in clip
+// space, so the grid splits the screen into tiles and the clip w (the
+// view distance) into exponential slices between the near and far plane.
+// Every cluster gets the range of a compact index list naming the point
+// lights whose bounding sphere touches it, the fragment shader only loops
+// over those. Clusters live in SSBO binding 7, the indices in binding 8.
+///////////////////////////////////////////////////////////////////////////
+class LightClusters {
+public:
+    LightClusters() : clusterBuffer(0), indexBuffer(0) {}
+    ~LightClusters() { Delete(); }
+
+    LightClusters(const LightClusters &) = delete;
+    LightClusters &operator=(const LightClusters &) = delete;
+
+    void Create();
+    void Delete();
+
+    /// Assign the lights to the clusters of the projection and upload the
+    /// result. Only needs to run when the lights or the projection change
+    void Build(const std::vector<LightSource> &lights,
+               const qrk::mat4 &projection, float nearPlane, float farPlane);
+    void Bind() const;
+
+    /// Maps log(w) to a slice, scale then bias, for the fragment shader
+    qrk::vec2f GetDepthMapping() const { return depthMapping; }
+    size_t GetIndexCount() const { return indices.size(); }
+    bool IsCreated() const { return clusterBuffer != 0; }
+
+private:
+    struct ClusterRange {
+        GLuint offset;
+        GLuint count;
+    };
+
+    GLuint clusterBuffer;
+    GLuint indexBuffer;
+    std::vector<ClusterRange> clusters;
+    std::vector<GLuint> indices;
+    //cluster and light of every hit, bucketed into indices afterwards
+    std::vector<std::pair<GLuint, GLuint>> hits;
+    qrk::vec2f depthMapping = qrk::vec2f({0, 0});
+};
+}// namespace qrk
+
+#endif// !Q_LIGHT_CLUSTERS
\ No newline at end of file
@@ -0,0 +1,114 @@
+#ifndef Q_LIGHT_POOL
+#define Q_LIGHT_POOL
+
+#define Q_POINT 0
+#define Q_DIRECTIONAL 1
+
+#include "../dependencies/glad/glad.h"
+#include "../include/color.hpp"
+#include "../include/handle_pool.hpp"
+#include "../include/vector.hpp"
+#include <vector>
+
+namespace qrk {
+/// Point lights fall off by 1 / (constant + linear d + quadratic d^2). Only
+/// lights with a linear or quadratic term have a finite range and are culled
+/// per cluster, the default reaches the whole scene
+struct LightSource {
+    LightSource() {
+        position = qrk::vec3f({0.f, 0.f, 0.f});
+        lightType = Q_POINT;
+
+        constant = 1.f;
+        linear = 0.f;
+        quadratic = 0.f;
+
+        ambient = qrk::vec3f({0.1f, 0.1f, 0.1f});
+        diffuse = qrk::vec3f({1.f, 1.f, 1.f});
+        specular = qrk::vec3f({0.3f, 0.3f, 0.3f});
+    }
+    LightSource(const qrk::vec3f &_position, const qrk::Color &color) {
+        position = _position;
+        lightType = Q_POINT;
+
+        constant = 1.f;
+        linear = 0.f;
+        quadratic = 0.f;
+
+        qrk::ColorF cf = qrk::ConvertToFloat(color);
+        ambient = qrk::vec3f({cf.r * 0.1f, cf.g * 0.1f, cf.b * 0.1f});
+        diffuse = qrk::vec3f({cf.r, cf.g, cf.b});
+        specular = qrk::vec3f({cf.r * 0.3f, cf.g * 0.3f, cf.b * 0.3f});
+    }
+
+    int lightType;
+    float constant;
+    float linear;
+    float quadratic;
+
+    vec3f position;
+
+    vec3f ambient;
+    vec3f diffuse;
+    vec3f specular;
+};
+//a std430 vec3 is 16 byte aligned, vec3f carries the padding itself. With
+//both sizes fixed every member sits at its std430 offset
+static_assert(sizeof(vec3f) == 16, "vec3f does not match a std430 vec3");
+static_assert(sizeof(LightSource) == 80,
+              "LightSource does not match the std430 LightSource struct");
+
+/// Stable reference to a light in a LightPool
+using LightHandle = PoolHandle;
+
+///////////////////////////////////////////////////////////////////////////
+// Lights kept densely packed in a HandlePool, in the order the light SSBO
+// stores them. Changes only mark the lights they touch, Upload sends the
+// modified ranges with glNamedBufferSubData and reallocates only when the
+// pool outgrows the buffer. Adding, updating and removing do not touch GL
+// and can run on any thread as long as they are serialized with Upload.
+///////////////////////////////////////////////////////////////////////////
+class LightPool {
+public:
+    LightPool() : buffer(0), binding(0), capacity(0) {}
+    ~LightPool() { Delete(); }
+
+    LightPool(const LightPool &) = delete;
+    LightPool &operator=(const LightPool &) = delete;
+
+    /// Create the SSBO and bind it to the storage block binding
+    void Create(GLuint _binding, size_t initialCapacity = 64);
+    void Delete();
+
+    LightHandle Add(const LightSource &light);
+    void Update(LightHandle handle, const LightSource &light);
+    void Remove(LightHandle handle);
+    bool Contains(LightHandle handle) const;
+    /// The light behind a handle, nullptr when it was removed
+    const LightSource *Get(LightHandle handle) const;
+
+    /// Send the lights changed since the last upload, returns the number
+    /// of bytes uploaded
+    size_t Upload();
+
+    /// Lights in SSBO order, the order shifts when lights are removed
+    const std::vector<LightSource> &GetLights() const {
+        return lights.GetElements();
+    }
+    size_t Size() const { return lights.Size(); }
+    GLuint GetHandle() const { return buffer; }
+    bool IsCreated() const { return buffer != 0; }
+
+private:
+    //dirty lights closer than this are sent in one range
+    static constexpr size_t mergeDistance = 4;
+
+    GLuint buffer;
+    GLuint binding;
+    size_t capacity;
+    qrk::HandlePool<LightSource> lights;
+    bool reallocate = false;
+};
+}// namespace qrk
+
+#endif// !Q_LIGHT_POOL
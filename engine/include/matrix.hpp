@@ -74,16 +74,15 @@ public:
     }
     Matrix operator*(Matrix &other) {
         if (this->data[0].size() != other.data.size()) return *this;
-        std::vector<std::vector<mat_type>> result(
-                this->data[0].size(),
-                std::vector<mat_type>(other.data.size(), 0));
+        //zeroed array, products of matrices stay off the heap
+        std::array<std::array<mat_type, rows>, columns> result{};
         for (int i = 0; i < this->data.size(); i++)
             for (int j = 0; j < other.data[0].size(); j++)
                 for (int k = 0; k < this->data.size(); k++)
                     result[i][j] += this->data[i][k] * other.data[k][j];
         return result;
     }
-    Matrix operator=(Matrix &other) {
+    Matrix operator=(const Matrix &other) {
         if (this->data.size() != other.data.size()) return *this;
         if (this->data[0].size() != other.data[0].size()) return *this;
 
@@ -0,0 +1,84 @@
+#ifndef Q_MESH_POOL
+#define Q_MESH_POOL
+
+#include "../dependencies/glad/glad.h"
+#include "../include/GL_assets.hpp"
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace qrk::assets {
+///////////////////////////////////////////////////////////////////////////
+// One vertex buffer and VAO holding every mesh drawn in the 3d pass, so
+// the whole pass can be submitted with multi draw indirect. Meshes are
+// copied in on the GPU the first time they are drawn and addressed by
+// their first vertex afterwards. They are keyed by an id handed out once
+// per upload, so a deleted or refilled VBO whose name GL reuses is never
+// mistaken for the mesh copied from it. Released meshes leave their range
+// to later ones. The buffer doubles when it runs out of space, the VAOs
+// stay the same. A second VAO reads only the positions, for passes that
+// only write depth.
+///////////////////////////////////////////////////////////////////////////
+class MeshPool {
+public:
+    /// Bytes per vertex, position, texture position and normal in the
+    /// layout GLObject uploads
+    static constexpr GLsizei vertexStride = 9 * sizeof(GLfloat);
+
+    MeshPool() : VAO(0), positionVAO(0), buffer(0), capacity(0), size(0) {}
+    ~MeshPool() { Delete(); }
+
+    MeshPool(const MeshPool &) = delete;
+    MeshPool &operator=(const MeshPool &) = delete;
+
+    void Create(GLsizei initialVertices = 1 << 16);
+    void Delete();
+
+    /// Id for a newly uploaded mesh, never handed out twice
+    static uint32_t CreateId();
+    /// Drop the mesh from every pool once its VBO is deleted. Can be called
+    /// from any thread, the pools apply it in CollectReleased
+    static void Release(uint32_t mesh);
+
+    /// First vertex of the mesh, copied from VBO into the pool when it is
+    /// not there yet
+    GLint Register(uint32_t mesh, GLuint VBO, GLsizei vertexCount);
+    /// Free the range of the mesh for later meshes
+    void Unregister(uint32_t mesh);
+    /// Unregister the meshes released since the last call, on the thread
+    /// drawing with the pool
+    void CollectReleased();
+
+    GLuint GetVAO() const { return VAO; }
+    GLuint GetPositionVAO() const { return positionVAO; }
+    GLuint GetBuffer() const { return buffer; }
+    size_t GetMeshCount() const { return meshes.size(); }
+    bool IsCreated() const { return VAO != 0; }
+
+private:
+    struct Mesh {
+        GLint first;
+        GLsizei count;
+    };
+
+    GLuint VAO;
+    GLuint positionVAO;
+    GLuint buffer;
+    GLsizei capacity;
+    GLsizei size;
+    std::unordered_map<uint32_t, Mesh> meshes;
+    //unused ranges below size, sorted by their first vertex
+    std::vector<Mesh> freeRanges;
+    //meshes released by Release, guarded by poolsMutex
+    std::vector<uint32_t> released;
+
+    static std::mutex poolsMutex;
+    static std::vector<MeshPool *> pools;
+
+    GLint Allocate(GLsizei count);
+    void Free(Mesh range);
+    void Grow(GLsizei required);
+};
+}// namespace qrk::assets
+
+#endif// !Q_MESH_POOL
\ No newline at end of file
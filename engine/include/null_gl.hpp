@@ -0,0 +1,41 @@
+#ifndef Q_NULL_GL_HPP
+#define Q_NULL_GL_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace qrk::nullgl {
+/// Everything the engine asked of GL between two frame boundaries
+struct FrameStats {
+    uint64_t calls = 0;
+    /// Binds, fixed function state, program and uniform changes
+    uint64_t stateChanges = 0;
+    uint64_t drawCalls = 0;
+    /// Instances of indirect draws are only counted when the commands
+    /// are read from a persistently mapped buffer
+    uint64_t instances = 0;
+    /// Commands submitted through multi draw indirect calls
+    uint64_t indirectCommands = 0;
+    /// Bytes handed to buffer and texture uploads. Writes into mapped
+    /// buffers are not visible to the backend and are not counted
+    uint64_t bytesUploaded = 0;
+    /// Calls per entry point, only the ones that were called
+    std::map<std::string, uint64_t> callCounts;
+};
+
+/// Point the glad function pointers at the null backend and reset all
+/// counters. No driver is involved, created objects get sequential names
+/// and queries return the values of a typical 4.6 implementation. Entry
+/// points without a stub stay null, add one when the engine starts
+/// calling a new function
+void Load();
+/// Close the current frame, its counts become the last frame
+void EndFrame();
+/// Counts of the last closed frame
+FrameStats LastFrame();
+/// Counts recorded since the last frame boundary, like resource creation
+FrameStats Recorded();
+}// namespace qrk::nullgl
+
+#endif// !Q_NULL_GL_HPP
@@ -9,6 +9,7 @@
 #include "../include/vector.hpp"
 #include <filesystem>
 #include <future>
+#include <memory>
 #include <string>
 #include <thread>
 #include <vector>
@@ -36,7 +37,7 @@ public:
 
     ~Object() = default;
 
-    bool WaitForLoad(const qrk::glWindow &window) {
+    bool WaitForLoad(const qrk::RenderSurface &window) {
         if (asyncLoad) {
             if (!data.empty()) { return false; }
             if (loadFinished) {
@@ -95,73 +96,117 @@ private:
     };
 };
 
+///////////////////////////////////////////////////////////////////////////
+// Vertex buffer and VAO of an uploaded mesh, shared by the copies of a
+// GLObject and deleted with the last of them. Every upload gets its own
+// id, mesh pools key their copies by it and drop them on deletion.
+///////////////////////////////////////////////////////////////////////////
+class GLMesh {
+public:
+    explicit GLMesh(const qrk::Object &objectData);
+    ~GLMesh();
+
+    GLMesh(const GLMesh &) = delete;
+    GLMesh &operator=(const GLMesh &) = delete;
+
+    GLuint VAO;
+    GLuint VBO;
+    GLsizei vertexCount;
+    uint32_t id;
+    //bounds of the vertex positions, before the model matrix
+    qrk::AABB bounds;
+};
+
 class GLObject {
 public:
     GLObject() = delete;
     explicit GLObject(const qrk::Object &_objectData)
-        : texture(nullptr), textured(false), VAO(0), VBO(0),
+        : texture(nullptr), textured(false),
           color({1.f, 1.f, 1.f, 1.f}), position({0, 0, 0}), rotation({0, 0, 0}),
           scale({1, 1, 1}) {
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, _objectData.data.size() * sizeof(GLfloat),
-                     _objectData.data.data(), GL_STATIC_DRAW);
-        vertexNumber = _objectData.vertexNumber;
+        mesh = std::make_shared<const GLMesh>(_objectData);
+        material = _objectData.material;
         qrk::mat4 identity = identity4();
-        posMatrix = identity;
-        rotMatrix = identity;
-        sclMatrix = identity;
+        modelMatrix = identity;
+        modelDirty = false;
     }
 
     explicit GLObject(const std::string &objectPath)
-        : texture(nullptr), textured(false), VAO(0),
-          VBO(0), color({1.f, 1.f, 1.f, 1.f}), position({0, 0, 0}), rotation({0, 0, 0}), scale({1, 1, 1}) {
+        : texture(nullptr), textured(false),
+          color({1.f, 1.f, 1.f, 1.f}), position({0, 0, 0}), rotation({0, 0, 0}), scale({1, 1, 1}) {
         qrk::Object _objectData(objectPath, false);
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, _objectData.data.size() * sizeof(GLfloat),
-                     _objectData.data.data(), GL_STATIC_DRAW);
-        vertexNumber = _objectData.vertexNumber;
+        mesh = std::make_shared<const GLMesh>(_objectData);
+        material = _objectData.material;
         qrk::mat4 identity = identity4();
-        posMatrix = identity;
-        rotMatrix = identity;
-        sclMatrix = identity;
+        modelMatrix = identity;
+        modelDirty = false;
         _objectData.DeleteData();
     }
 
+    //the model matrix is rebuilt on the next GetDrawData call
     void SetPosition(float x, float y, float z) {
         position = qrk::vec3f({x, y, z});
-        qrk::mat4 tempMatrix = qrk::CreateTranslationMatrix(x, y, z);
-        posMatrix = tempMatrix;
+        modelDirty = true;
+        SendChanges();
     }
     void SetRotation(float x, float y, float z) {
         rotation = qrk::vec3f({x, y, z});
-        qrk::mat4 tempMatrix = qrk::CreateRotationMatrix(x, y, z);
-        rotMatrix = tempMatrix;
+        modelDirty = true;
+        SendChanges();
     }
     void SetScale(float x, float y, float z) {
         scale = qrk::vec3f({x, y, z});
-        qrk::mat4 tempMatrix = qrk::CreateScaleMatrix(x, y, z);
-        sclMatrix = tempMatrix;
+        modelDirty = true;
+        SendChanges();
+    }
+    /// Use a model matrix built elsewhere, like the world matrix of a
+    /// scene graph node. The next SetPosition, SetRotation or SetScale
+    /// replaces it
+    void SetModelMatrix(const qrk::mat4 &model) {
+        modelMatrix = model;
+        modelDirty = false;
+        SendChanges();
+    }
+    void SetColor(const qrk::Color &_color) {
+        color = qrk::ConvertToFloat(_color);
+        SendChanges();
+    }
+    void SetColor(const qrk::ColorF &_color) {
+        color = _color;
+        SendChanges();
+    }
+    void SetMaterial(const qrk::Material &_material) {
+        material = _material;
+        SendChanges();
     }
-    void SetColor(const qrk::Color &_color) { color = qrk::ConvertToFloat(_color); }
-    void SetColor(const qrk::ColorF &_color) { color = _color; }
     void SetTexture(qrk::Texture2D &_texture) {
         texture = &_texture;
         textured = true;
+        SendChanges();
     }
     void RemoveTexture() {
         texture = nullptr;
         textured = false;
+        SendChanges();
+    }
+    /// Upload new geometry, copies made before keep drawing the old mesh
+    void SetMesh(const qrk::Object &objectData) {
+        mesh = std::make_shared<const GLMesh>(objectData);
+        SendChanges();
     }
 
+    /// Keep drawing the object with the renderer until Unregister, instead
+    /// of queueing it every frame. From then on the setters only mark the
+    /// object changed, its draw is sent once when the frame is recorded
+    void Register(qrk::qb_GL_Renderer &renderer) {
+        retained.Register(renderer, *this);
+    }
+    void Unregister() { retained.Release(); }
+
     qrk::vec3f GetPosition() { return position; }
     qrk::vec3f GetRotation() { return rotation; }
     qrk::vec3f GetScale() { return scale; }
+    qrk::Material GetMaterial() { return material; }
 
     qrk::DrawData_3D GetDrawData();
 
@@ -169,17 +214,18 @@ private:
     qrk::Texture2D *texture;
     bool textured;
 
-    GLuint VAO;
-    GLuint VBO;
-    GLsizei vertexNumber;
+    std::shared_ptr<const GLMesh> mesh;
 
     qrk::ColorF color;
+    qrk::Material material;
     qrk::vec3f position;
     qrk::vec3f rotation;
     qrk::vec3f scale;
-    qrk::mat4 posMatrix;
-    qrk::mat4 rotMatrix;
-    qrk::mat4 sclMatrix;
+    qrk::mat4 modelMatrix;
+    bool modelDirty;
+    qrk::RetainedDraw retained;
+
+    void SendChanges() { retained.MarkDirty(); }
 };
 }// namespace qrk
 
@@ -0,0 +1,129 @@
+#ifndef Q_OCCLUSION_CULLER
+#define Q_OCCLUSION_CULLER
+
+#include "../dependencies/glad/glad.h"
+#include "../include/dynamic_bvh.hpp"
+#include "../include/job_pool.hpp"
+#include "../include/vector.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace qrk {
+class Object;
+
+/// Triangles of a mesh drawn into the occlusion depth buffer. Only large,
+/// solid meshes make good occluders, a low polygon stand in works as well
+/// as the mesh that is drawn. Triangles sharing an edge are found by their
+/// positions, so the inside of the mesh is drawn without gaps
+class Occluder {
+public:
+    static constexpr uint32_t noNeighbor = UINT32_MAX;
+    /// Set on neighbors that run along the shared edge in the same
+    /// direction, so they are wound the other way
+    static constexpr uint32_t flippedNeighbor = 1u << 31;
+
+    Occluder() = default;
+    /// Positions of a loaded object, 3 vertices per triangle
+    explicit Occluder(const qrk::Object &object);
+    /// Positions as x y z, 3 vertices per triangle
+    explicit Occluder(std::vector<float> _positions);
+
+    const std::vector<float> &GetPositions() const { return positions; }
+    size_t GetTriangleCount() const { return positions.size() / 9; }
+    const qrk::AABB &GetBounds() const { return bounds; }
+    /// Triangle across every edge, edge i is the one facing vertex i
+    const std::vector<uint32_t> &GetNeighbors() const { return neighbors; }
+
+private:
+    std::vector<float> positions;
+    std::vector<uint32_t> neighbors;
+    qrk::AABB bounds;
+
+    void ComputeBounds();
+    void FindNeighbors();
+};
+
+///////////////////////////////////////////////////////////////////////////
+// Software occlusion culling on the CPU. The occluders of a frame are
+// rasterized into a small depth buffer, and bounding boxes are tested
+// against it before their objects are queued for the renderer. The screen
+// is split into bins that are rasterized in parallel, each writing only
+// its own pixels, and rows of 4 pixels are filled at once with SSE where
+// it is available. Every 8x8 tile keeps the farthest depth in it, so most
+// boxes are decided by a few tiles without reading the pixels.
+// Occluders claim the farthest depth they reach in a pixel, and only
+// pixels they cover completely along the outline of the mesh. Inside the
+// outline, where an edge has a triangle on either side on screen, pixels
+// are claimed by their center so the mesh has no cracks, the price is that
+// a pixel next to a corner of the outline can be claimed by a little more
+// than the mesh covers. Triangles crossing the near plane are skipped and
+// boxes crossing it are always visible.
+///////////////////////////////////////////////////////////////////////////
+class OcclusionCuller {
+public:
+    /// Size of the depth buffer, rounded up to a multiple of 8
+    explicit OcclusionCuller(int width = 256, int height = 128);
+
+    /// Clear the depth buffer and the occluders for a new frame
+    void BeginFrame(const qrk::mat4 &viewProjection);
+    /// Draw the occluder with the model matrix this frame. It is only
+    /// referenced, so it has to live until RenderOccluders
+    void AddOccluder(const Occluder &occluder, const qrk::mat4 &model);
+    /// Rasterize the occluders, jobs splits the bins across its threads
+    void RenderOccluders(qrk::JobPool *jobs = nullptr);
+
+    /// False when the box is hidden behind the occluders or off screen
+    bool IsVisible(const qrk::AABB &box) const;
+    /// The box of an object in its model space
+    bool IsVisible(const qrk::AABB &bounds, const qrk::mat4 &model) const {
+        return IsVisible(qrk::TransformAABB(bounds, model));
+    }
+
+    int GetWidth() const { return width; }
+    int GetHeight() const { return height; }
+    /// Normalized device depth of every pixel, rows from the top
+    const float *GetDepthBuffer() const { return depth.data(); }
+    /// Triangles of the last RenderOccluders that reached the screen
+    size_t GetRasterizedTriangleCount() const { return rasterizedCount; }
+
+private:
+    static constexpr int tileSize = 8;
+    static constexpr int binWidth = 64;
+    static constexpr int binHeight = 32;
+
+    //screen space triangle, edges are a x + b y + c >= 0 inside
+    struct Triangle {
+        float edges[3][3];
+        //farthest depth in a pixel is z[0] + z[1] x + z[2] y, but never
+        //past the farthest vertex
+        float z[3];
+        float maxZ;
+        int minX, minY, maxX, maxY;
+    };
+    struct Instance {
+        const Occluder *occluder;
+        qrk::mat4 modelViewProjection;
+        size_t firstTriangle;
+    };
+
+    int width, height;
+    int tilesX, tilesY;
+    int binsX, binsY;
+    qrk::mat4 viewProjection;
+    std::vector<float> depth;
+    std::vector<float> tileDepth;
+    std::vector<Instance> instances;
+    std::vector<Triangle> triangles;
+    //winding on screen of every triangle, 0 when it is skipped
+    std::vector<int8_t> facing;
+    size_t triangleCount = 0;
+    size_t rasterizedCount = 0;
+
+    void SetupTriangles(const Instance &instance);
+    void RasterizeBin(int bin);
+    void RasterizeTriangle(const Triangle &triangle, int minX, int minY,
+                           int maxX, int maxY);
+};
+}// namespace qrk
+
+#endif// !Q_OCCLUSION_CULLER
@@ -0,0 +1,106 @@
+#ifndef Q_PASS_PROFILER
+#define Q_PASS_PROFILER
+
+#include "../dependencies/glad/glad.h"
+#include "../include/draw_sort.hpp"
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace qrk {
+constexpr size_t Q_PASS_COUNT = 5;
+
+/// Name of a pass for reports
+const char *PassName(DrawPass pass);
+
+struct PassTiming {
+    /// Milliseconds the renderer spent on the pass, sorting included
+    float cpu = 0.f;
+    /// Milliseconds between the GPU timestamps around the pass
+    float gpu = 0.f;
+    /// Samples that passed the depth test during the pass. Over the
+    /// covered samples this is the overdraw the pass shaded
+    uint64_t samples = 0;
+};
+struct FrameTiming {
+    uint64_t frame = 0;
+    /// Whole Draw call, merging the submitted lists included
+    PassTiming total;
+    PassTiming passes[Q_PASS_COUNT];
+    /// False when the GPU had not finished the frame by the time its
+    /// queries were reused, its gpu times and samples are 0 then
+    bool gpuValid = false;
+};
+
+///////////////////////////////////////////////////////////////////////////
+// CPU and GPU timers around the passes of a frame. Every frame writes
+// GL_TIMESTAMP queries into its own query set, one set per frame in
+// flight, and counts the samples every pass draws with GL_SAMPLES_PASSED.
+// A set is read back when it comes around again, so the results arrive a
+// few frames late and reading them never stalls the pipeline.
+// Finished frames go into a rolling history that can be read from any
+// thread, a ring allocated once by Create.
+///////////////////////////////////////////////////////////////////////////
+class PassProfiler {
+public:
+    PassProfiler()
+        : current(0), frameCount(0), historyStart(0), historyCount(0) {}
+    ~PassProfiler() { Delete(); }
+
+    PassProfiler(const PassProfiler &) = delete;
+    PassProfiler &operator=(const PassProfiler &) = delete;
+
+    /// latency is the number of frames before a query set is read back
+    void Create(int latency = 4, size_t _historySize = 240);
+    void Delete();
+    bool IsCreated() const { return !sets.empty(); }
+
+    /// Collect the oldest query set and start timing a new frame
+    void BeginFrame();
+    void EndFrame();
+    /// Passes must not overlap. A pass can be ended and begun again
+    /// around another one, its cpu time adds up while its gpu time and
+    /// samples cover the last part
+    void BeginPass(DrawPass pass);
+    void EndPass(DrawPass pass);
+
+    /// Finished frames, oldest first
+    std::vector<FrameTiming> GetHistory() const;
+    /// Last finished frame
+    FrameTiming GetLatest() const;
+    /// Average over the history, gpu times and samples only over frames
+    /// with results
+    FrameTiming GetAverage() const;
+
+private:
+    using clock = std::chrono::steady_clock;
+    //frame begin and end timestamps, then begin and end of every pass
+    static constexpr size_t queryCount = (Q_PASS_COUNT + 1) * 2;
+
+    struct QuerySet {
+        GLuint queries[queryCount] = {};
+        GLuint samples[Q_PASS_COUNT] = {};
+        bool passUsed[Q_PASS_COUNT] = {};
+        bool pending = false;
+        FrameTiming timing;
+    };
+    std::vector<QuerySet> sets;
+    int current;
+    uint64_t frameCount;
+    clock::time_point frameStart;
+    clock::time_point passStart[Q_PASS_COUNT];
+
+    mutable std::mutex historyMutex;
+    //ring of finished frames, historyStart is the oldest
+    std::vector<FrameTiming> history;
+    size_t historyStart;
+    size_t historyCount;
+
+    void Collect(QuerySet &set);
+    const FrameTiming &GetHistoryFrame(size_t age) const {
+        return history[(historyStart + age) % history.size()];
+    }
+};
+}// namespace qrk
+
+#endif// !Q_PASS_PROFILER
\ No newline at end of file
@@ -3,10 +3,15 @@
 
 #define _CRT_SECURE_NO_WARNINGS // NOLINT(*-reserved-identifier)
 
+#ifdef _WIN32
 #include <Windows.h>
+#else
+#include <iostream>
+#endif
 #include <chrono>
 #include <filesystem>
 #include <fstream>
+#include <stdexcept>
 #include <string>
 
 namespace qrk::debug {
@@ -34,17 +39,26 @@ void Log(const std::string &log);
 void LogWarning(const std::string &warning);
 void LogError(const std::string &error);
 
+//without message boxes the errors go to the console
 inline void ShowErrorBox(const std::string &error) {
+#ifdef _WIN32
     MessageBox(nullptr, error.c_str(), "Error", MB_OK | MB_ICONERROR);
+#else
+    std::cerr << "Error: " << error << std::endl;
+#endif
 }
 inline void ShowWarningBox(const std::string &error) {
+#ifdef _WIN32
     MessageBox(nullptr, error.c_str(), "Warning", MB_OK | MB_ICONEXCLAMATION);
+#else
+    std::cerr << "Warning: " << error << std::endl;
+#endif
 }
 inline void Error(const std::string &error,
                   int code = qrk::debug::Q_DEFAULT_ERROR) {
     LogError(error);
     ShowErrorBox(error);
-    throw std::exception(std::to_string(code).c_str());
+    throw std::runtime_error(std::to_string(code));
 }
 inline void Warning(const std::string &error) {
     LogWarning(error);
@@ -53,12 +67,16 @@ inline void Warning(const std::string &error) {
 #endif// _DEBUG
 }
 inline void set_cursor(int x = 0, int y = 0) {
+#ifdef _WIN32
     HANDLE handle;
     COORD coordinates;
     handle = GetStdHandle(STD_OUTPUT_HANDLE);
     coordinates.X = x;
     coordinates.Y = y;
     SetConsoleCursorPosition(handle, coordinates);
+#else
+    std::cout << "\033[" << y + 1 << ";" << x + 1 << "H";
+#endif
 }
 
 inline std::ofstream logFile;
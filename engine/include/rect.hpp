@@ -4,6 +4,7 @@
 #include "../include/color.hpp"
 #include "../include/draw.hpp"
 #include "../include/texture.hpp"
+#include "../include/texture_atlas.hpp"
 #include "../include/vector.hpp"
 #include <vector>
 
@@ -13,31 +14,73 @@ public:
     Rect();
     Rect(const qrk::vec2f &_size);
 
-    void SetSize(float x, float y) { this->size = qrk::vec2f({x, y}); }
+    void SetSize(float x, float y) {
+        this->size = qrk::vec2f({x, y});
+        SendChanges();
+    }
     qrk::vec2f GetSize() { return this->size; }
 
-    void SetPosition(float x, float y) { this->position = qrk::vec2f({x, y}); }
+    void SetPosition(float x, float y) {
+        this->position = qrk::vec2f({x, y});
+        SendChanges();
+    }
     qrk::vec2f GetPosition() { return this->position; }
 
-    void SetOffset(float x, float y) { this->offset = qrk::vec2f({x, y}); }
+    void SetOffset(float x, float y) {
+        this->offset = qrk::vec2f({x, y});
+        SendChanges();
+    }
     qrk::vec2f GetOffset() { return this->offset; }
 
-    void SetRotation(float _rotation) { this->rotation = _rotation; }
+    void SetRotation(float _rotation) {
+        this->rotation = _rotation;
+        SendChanges();
+    }
     float GetRotation() { return this->rotation; }
 
-    void SetColor(qrk::Color _color) { color = _color; }
+    void SetColor(qrk::Color _color) {
+        color = _color;
+        SendChanges();
+    }
     qrk::Color GetColor() { return this->color; }
 
-    void SetTexture(qrk::Texture2D &_texture) { texture = &_texture; }
-    void RemoveTexture() { texture = nullptr; }
+    void SetTexture(qrk::Texture2D &_texture) {
+        texture = &_texture;
+        SendChanges();
+    }
+    /// Use the page and part of it an atlas packed an image into
+    void SetTexture(const qrk::AtlasRegion &region) {
+        texture = region.texture;
+        textureRect = region.uvRect;
+        SendChanges();
+    }
+    void RemoveTexture() {
+        texture = nullptr;
+        SendChanges();
+    }
+    /// Sample only part of the texture, offset and size are normalized
+    void SetTextureRect(float x, float y, float width, float height) {
+        textureRect = qrk::vec4f({x, y, width, height});
+        SendChanges();
+    }
+    qrk::vec4f GetTextureRect() { return this->textureRect; }
 
     /// Set z layer betwen -1 and 1
     void SetLayer(const float layer) {
         zLayer = -std::clamp(layer, -0.999f, 0.999f);
+        SendChanges();
     }
 
     qrk::DrawData_2D GetDrawData();
 
+    /// Keep drawing the rect with the renderer until Unregister, instead
+    /// of queueing it every frame. The setters mark the rect changed from
+    /// then on, the renderer takes it once per recorded frame
+    void Register(qrk::qb_GL_Renderer &renderer, bool UI = false) {
+        retained.Register(renderer, *this, UI);
+    }
+    void Unregister() { retained.Release(); }
+
 private:
     qrk::vec2f size;
     qrk::vec2f position;
@@ -46,14 +89,10 @@ private:
     float zLayer = 0.f;
     qrk::Color color;
     qrk::Texture2D *texture;
+    qrk::vec4f textureRect = qrk::vec4f({0, 0, 1, 1});
+    qrk::RetainedDraw retained;
 
-    const std::vector<GLfloat> vertices = {
-            1,  1,  1, 0, -1, 1,  0, 0, -1, -1, 0, 1,
-            -1, -1, 0, 1, 1,  -1, 1, 1, 1,  1,  1, 0,
-    };
-
-    GLuint VAO;
-    GLuint VBO;
+    void SendChanges() { retained.MarkDirty(); }
 };
 }// namespace qrk
 
@@ -0,0 +1,20 @@
+#ifndef Q_RENDER_SURFACE
+#define Q_RENDER_SURFACE
+
+#ifdef Q_HEADLESS
+#include "../include/headless_surface.hpp"
+#else
+#include "../include/window.hpp"
+#endif
+
+namespace qrk {
+/// Target the renderer draws to, a Win32 window or an offscreen EGL context
+/// in headless builds
+#ifdef Q_HEADLESS
+using RenderSurface = qrk::HeadlessSurface;
+#else
+using RenderSurface = qrk::glWindow;
+#endif
+}// namespace qrk
+
+#endif// !Q_RENDER_SURFACE
\ No newline at end of file
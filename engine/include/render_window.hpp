@@ -2,7 +2,10 @@
 #define Q_RENDER_WINDOW
 
 #include "../include/draw.hpp"
-#include "../include/window.hpp"
+#include "../include/render_surface.hpp"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 namespace qrk {
 struct RenderWindowSettings {
@@ -12,6 +15,9 @@ struct RenderWindowSettings {
                                           4,
                                           6};
     qrk::RendererSettings renderSettings = {true, true, true, true};
+    /// Submit frames from a dedicated thread that owns the GL context.
+    /// GL work on other threads then has to hold a ScopedContext
+    bool renderThread = false;
 };
 
 class RenderWindow {
@@ -21,31 +27,92 @@ public:
                          {{Q_WINDOW_DEFAULT, 8, {255, 255, 255, 255}, 4, 6},
                           {true, true, true, true}})
         : window(windowName, windowSize, settings.windowSettings),
-          renderer(window, settings.renderSettings) {
+          renderer(window, settings.renderSettings),
+          threaded(settings.renderThread) {
         window.MakeContextCurrent();
+        if (threaded) { StartRenderThread(); }
     }
+    ~RenderWindow();
 
-    void ClearWindow() { window.Clear(); }
-    qrk::glWindow &GetWindow() { return window; }
+    void ClearWindow() {
+        if (threaded) {
+            clearRequested = true;
+        } else {
+            window.Clear();
+        }
+    }
+    qrk::RenderSurface &GetWindow() { return window; }
     qrk::qb_GL_Renderer &GetRenderer() { return renderer; }
 
     template<drawDataStruct draw_t>
     void QueueDraw(const draw_t &drawData, bool UI = false) {
-        renderer.QueueDraw(drawData, UI);
+        if (threaded) {
+            recording.QueueDraw(drawData, UI);
+        } else {
+            renderer.QueueDraw(drawData, UI);
+        }
     }
 
-    void Draw() {
-        renderer.Draw();
-        window.SwapWindowBuffers();
-    }
+    /// With a render thread this hands the queued draws over and returns
+    /// once the previous frame was submitted, so at most one frame is in
+    /// flight while the next one is recorded
+    void Draw();
 
-    void Close() { window.Close(); }
+    void Close();
     bool IsOpen() { return window.IsOpen(); }
 
 private:
-    qrk::glWindow window;
+    friend class ScopedContext;
+
+    qrk::RenderSurface window;
     qrk::qb_GL_Renderer renderer;
+
+    //render thread state, unused without a render thread
+    bool threaded;
+    std::thread renderThread;
+    std::mutex contextMutex;
+    std::mutex frameMutex;
+    std::condition_variable frameReady;
+    std::condition_variable frameDone;
+    bool framePending = false;
+    bool stopping = false;
+    //frame being recorded on the calling thread
+    qrk::DrawList recording;
+    bool clearRequested = false;
+    //frame handed to the render thread
+    bool frameClear = false;
+    qrk::vec2u frameSize = qrk::vec2u({0, 0});
+
+    void StartRenderThread();
+    void StopRenderThread();
+    void RenderLoop();
+};
+
+///////////////////////////////////////////////////////////////////////////
+// Makes the context of a threaded RenderWindow current on the calling
+// thread for the lifetime of the object, between two submitted frames.
+// Needed for any GL work outside the render thread, like creating
+// textures or objects. Must not be held across RenderWindow::Draw, which
+// waits for the render thread. Does nothing without a render thread.
+///////////////////////////////////////////////////////////////////////////
+class ScopedContext {
+public:
+    explicit ScopedContext(qrk::RenderWindow &_window) : window(&_window) {
+        if (!window->threaded) { return; }
+        lock = std::unique_lock<std::mutex>(window->contextMutex);
+        window->window.MakeContextCurrent();
+    }
+    ~ScopedContext() {
+        if (lock.owns_lock()) { window->window.ReleaseContext(); }
+    }
+
+    ScopedContext(const ScopedContext &) = delete;
+    ScopedContext &operator=(const ScopedContext &) = delete;
+
+private:
+    qrk::RenderWindow *window;
+    std::unique_lock<std::mutex> lock;
 };
 }// namespace qrk
 
-#endif// !Q_RENDER_WINDOW
+#endif// !Q_RENDER_WINDOW
\ No newline at end of file
@@ -0,0 +1,85 @@
+#ifndef Q_RING_BUFFER
+#define Q_RING_BUFFER
+
+#include "../dependencies/glad/glad.h"
+#include "../include/qrk_debug.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace qrk::assets {
+///////////////////////////////////////////////////////////////////////////
+// Persistently mapped buffer split into regions, one region per frame in
+// flight. Each frame writes its data contiguously into the current region
+// and binds it with glBindBufferRange. A fence guards every region, so the
+// CPU only waits when it catches up with a frame the GPU has not finished.
+// The buffer is only replaced between frames. A frame that outgrows its
+// region continues in overflow buffers, which like replaced buffers are
+// deleted once the GPU is done with them, so earlier writes stay valid.
+///////////////////////////////////////////////////////////////////////////
+class RingBuffer {
+public:
+    RingBuffer()
+        : buffer(0), mapped(nullptr), regionSize(0), regionCount(0),
+          region(0), head(0), target(0), frameSize(0) {}
+    RingBuffer(GLsizeiptr _regionSize, int _regionCount = 3)
+        : RingBuffer() {
+        Create(_regionSize, _regionCount);
+    }
+    ~RingBuffer() { Delete(); }
+
+    RingBuffer(const RingBuffer &) = delete;
+    RingBuffer &operator=(const RingBuffer &) = delete;
+
+    void Create(GLsizeiptr _regionSize, int _regionCount = 3);
+    void Delete();
+
+    /// Move to the next region and wait until the GPU is done with it.
+    /// reserve is the number of bytes the frame is expected to write, the
+    /// regions grow to fit it or what the last frame wrote
+    void BeginFrame(GLsizeiptr reserve = 0);
+    /// Fence the region and overflow buffers written this frame
+    void EndFrame();
+
+    /// Copy data into the current region, or an overflow buffer once the
+    /// region is full. Returns the offset in the buffer GetHandle names
+    GLintptr Write(const void *data, GLsizeiptr size, GLint alignment = 1);
+
+    /// Buffer the last Write copied into
+    GLuint GetHandle() const { return target; }
+    bool IsCreated() const { return buffer != 0; }
+
+private:
+    GLuint buffer;
+    unsigned char *mapped;
+    GLsizeiptr regionSize;
+    int regionCount;
+    int region;
+    GLsizeiptr head;
+    std::vector<GLsync> fences;
+    GLuint target;
+    //bytes written this frame, including the overflow buffers
+    GLsizeiptr frameSize;
+
+    struct Overflow {
+        GLuint buffer;
+        unsigned char *mapped;
+        GLsizeiptr size;
+        GLsizeiptr head;
+    };
+    //buffers the GPU may still read, deleted once their fence signals
+    struct Retired {
+        GLuint buffer;
+        GLsync fence;
+    };
+    std::vector<Overflow> overflows;
+    std::vector<Retired> retired;
+
+    void WaitForRegion(int index);
+    void Retire(GLuint retiredBuffer);
+    void ReleaseRetired();
+    static unsigned char *CreateMapped(GLuint &handle, GLsizeiptr size);
+};
+}// namespace qrk::assets
+
+#endif// !Q_RING_BUFFER
@@ -0,0 +1,102 @@
+#ifndef Q_SCENE_GRAPH
+#define Q_SCENE_GRAPH
+
+#include "../dependencies/glad/glad.h"
+#include "../include/handle_pool.hpp"
+#include "../include/job_pool.hpp"
+#include "../include/vector.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace qrk {
+using SceneNode = PoolHandle;
+
+///////////////////////////////////////////////////////////////////////////
+// Parent and child transforms for large scenes. Every node has a local
+// position, rotation and scale, its world matrix is the world matrix of
+// its parent times its local matrix. Nodes are stored as structure of
+// arrays sorted by depth, so parents always come before their children and
+// Update computes every world matrix in one linear pass, level by level.
+// Only nodes whose transform or any ancestor changed are recomputed, a
+// level can be split across a job pool since its nodes only read the
+// levels above. Changing the hierarchy is cheap, the arrays are sorted
+// again by the next Update. Not synchronized.
+///////////////////////////////////////////////////////////////////////////
+class SceneGraph {
+public:
+    /// A node at the root without a parent, or a child of parent
+    SceneNode Add(SceneNode parent = SceneNode());
+    /// Remove the node, its children are removed with it by the next
+    /// Update unless they were moved to another parent before
+    void Remove(SceneNode node);
+    /// Move the node under parent, or to the root with an invalid parent.
+    /// False when this would make the node its own ancestor
+    bool SetParent(SceneNode node, SceneNode parent);
+    /// Invalid for root nodes
+    SceneNode GetParent(SceneNode node) const;
+    bool Contains(SceneNode node) const {
+        return node.slot < generations.size() &&
+               generations[node.slot] == node.generation;
+    }
+
+    void SetPosition(SceneNode node, const qrk::vec3f &position);
+    void SetRotation(SceneNode node, const qrk::vec3f &rotation);
+    void SetScale(SceneNode node, const qrk::vec3f &scale);
+    qrk::vec3f GetPosition(SceneNode node) const;
+    qrk::vec3f GetRotation(SceneNode node) const;
+    qrk::vec3f GetScale(SceneNode node) const;
+
+    /// Recompute the world matrices of changed subtrees. jobs splits large
+    /// levels across its threads, nullptr runs on the calling thread
+    void Update(qrk::JobPool *jobs = nullptr);
+    /// World matrix as of the last Update, nullptr when removed
+    const qrk::mat4 *GetWorldMatrix(SceneNode node) const;
+    /// True when the last Update changed the world matrix of the node
+    bool IsChanged(SceneNode node) const;
+
+    size_t Size() const { return nodeSlots.size(); }
+    size_t GetDepth() const {
+        return levelStarts.empty() ? 0 : levelStarts.size() - 1;
+    }
+
+private:
+    static constexpr uint32_t noParent = UINT32_MAX;
+
+    //slot of every handle, generations are bumped by Remove
+    std::vector<uint32_t> slotNodes;
+    std::vector<uint32_t> generations;
+    std::vector<uint32_t> freeSlots;
+
+    //nodes by dense index, sorted by depth once the order is valid
+    std::vector<uint32_t> nodeSlots;
+    std::vector<uint32_t> parents;
+    std::vector<uint32_t> depths;
+    std::vector<qrk::vec3f> positions;
+    std::vector<qrk::vec3f> rotations;
+    std::vector<qrk::vec3f> scales;
+    std::vector<qrk::mat4> localMatrices;
+    std::vector<qrk::mat4> worldMatrices;
+    std::vector<uint8_t> localDirty;
+    std::vector<uint8_t> worldDirty;
+    std::vector<uint8_t> removed;
+    std::vector<uint8_t> changed;
+    //first dense index of every depth, and one past the last node
+    std::vector<size_t> levelStarts;
+
+    //set by hierarchy changes, Update sorts the nodes again
+    bool orderDirty = false;
+    bool anyDirty = false;
+    bool anyChanged = false;
+
+    //scratch of Reorder
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> newIndices;
+    std::vector<uint32_t> walk;
+
+    uint32_t GetIndex(SceneNode node) const { return slotNodes[node.slot]; }
+    void Reorder();
+    void UpdateRange(size_t begin, size_t end);
+};
+}// namespace qrk
+
+#endif// !Q_SCENE_GRAPH
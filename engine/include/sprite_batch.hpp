@@ -0,0 +1,65 @@
+#ifndef Q_SPRITE_BATCH
+#define Q_SPRITE_BATCH
+
+#include "../dependencies/glad/glad.h"
+#include "../include/GL_assets.hpp"
+#include "../include/color.hpp"
+#include "../include/draw_sort.hpp"
+#include "../include/job_pool.hpp"
+#include "../include/ring_buffer.hpp"
+#include "../include/texture.hpp"
+#include "../include/vector.hpp"
+#include <vector>
+
+namespace qrk {
+struct DrawData_2D;
+
+/// Per sprite vertex data of the 2d pass, fed to the shared quad with an
+/// instance divisor of 1. Positions and sizes are in pixels
+struct SpriteInstance {
+    qrk::vec2f position;
+    qrk::vec2f size;
+    qrk::vec4f uvRect;
+    qrk::vec4f color;
+    float rotation;
+    float zLayer;
+    char padding[8];
+};
+static_assert(sizeof(SpriteInstance) == 64,
+              "SpriteInstance must match the 2d instance attribute layout");
+
+///////////////////////////////////////////////////////////////////////////
+// Draws a whole 2d queue with one shared quad. All sprites of the queue
+// are written into a single instance buffer, consecutive sprites with the
+// same texture are then drawn with one instanced call. The sort keeps
+// the submission order within a layer, sprites sharing a texture atlas
+// page stay in one call. Sprites without a texture sample a white one, so
+// the whole queue is drawn with a single program.
+///////////////////////////////////////////////////////////////////////////
+class SpriteBatch {
+public:
+    SpriteBatch() : VAO(0), quadVBO(0), instanceVBO(0), instanceCapacity(0) {}
+    ~SpriteBatch() = default;
+
+    void Create();
+
+    /// Draw the queue in the order given by the sort keys with program,
+    /// screenSize is in pixels. The instances are built on the job pool,
+    /// when a ring buffer is given they are streamed through it
+    void Draw(std::vector<qrk::DrawData_2D> &queue,
+              const std::vector<qrk::SortKey> &order,
+              qrk::assets::Program &program, qrk::vec2f screenSize,
+              qrk::JobPool &jobs, qrk::assets::RingBuffer *stream = nullptr);
+
+private:
+    GLuint VAO;
+    GLuint quadVBO;
+    GLuint instanceVBO;
+    GLsizeiptr instanceCapacity;
+    std::vector<SpriteInstance> instances;
+    //1x1 white texture bound for sprites without one
+    qrk::Texture2D whiteTexture;
+};
+}// namespace qrk
+
+#endif// !Q_SPRITE_BATCH
@@ -50,8 +50,19 @@ public:
     void LoadFromImage(qrk::Image &image,
                        const qrk::Texture2DSettings &settings = {
                                GL_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT});
+    /// Empty RGBA texture, filled with Update. levels past the first are
+    /// built from it by GenerateMipmaps
+    void Create(int width, int height,
+                const qrk::Texture2DSettings &settings = {
+                        GL_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT},
+                int levels = 1);
+    /// Write RGBA pixels to the first level, rows from the top
+    void Update(int x, int y, int width, int height,
+                const unsigned char *pixels);
+    void GenerateMipmaps();
     void DeleteTexture();
     void BindTexture();
+    GLuint GetTextureHandle() const { return texture; }
 
 private:
     GLuint texture;
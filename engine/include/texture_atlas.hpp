@@ -0,0 +1,99 @@
+#ifndef Q_TEXTURE_ATLAS
+#define Q_TEXTURE_ATLAS
+
+#include "../dependencies/glad/glad.h"
+#include "../include/stb_rectPack.hpp"
+#include "../include/texture.hpp"
+#include "../include/vector.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace qrk {
+/// Part of an atlas page an image was packed into
+struct AtlasRegion {
+    /// Page the image is on, shared with every image packed next to it
+    qrk::Texture2D *texture = nullptr;
+    /// Offset and size on the page, normalized like Rect::SetTextureRect
+    qrk::vec4f uvRect = qrk::vec4f({0, 0, 1, 1});
+    /// Size of the image in pixels
+    int width = 0;
+    int height = 0;
+
+    bool IsValid() const { return texture != nullptr; }
+};
+
+struct TextureAtlasSettings {
+    /// Width and height of every page in pixels
+    int pageSize = 1024;
+    /// Pixels around every image repeating its edge pixels, widened to
+    /// a pixel of the smallest mip level
+    int padding = 1;
+    /// Mip levels of the pages. Images are aligned to the pixels of the
+    /// smallest level, so no level mixes two images
+    int mipLevels = 1;
+    qrk::Texture2DSettings filtering = {GL_LINEAR, GL_LINEAR,
+                                        GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE};
+};
+
+///////////////////////////////////////////////////////////////////////////
+// Packs many small images into a few shared textures, so sprites and UI
+// images using them draw without changing textures in between. Images are
+// packed with the stb_rect_pack skyline packer as they are added, into the
+// first page with room or a new one. Every image gets a cell of whole
+// pixels of the smallest mip level, and the gutter around the image fills
+// the cell with its edge pixels, so filtering near its edges never reaches
+// a neighbor on any level. Pages are never repacked, the regions handed
+// out stay valid until the atlas is destroyed.
+///////////////////////////////////////////////////////////////////////////
+class TextureAtlas {
+public:
+    explicit TextureAtlas(const qrk::TextureAtlasSettings &_settings = {});
+    TextureAtlas(const TextureAtlas &) = delete;
+    TextureAtlas &operator=(const TextureAtlas &) = delete;
+
+    /// Pack and upload the image, it can be freed afterwards
+    qrk::AtlasRegion Add(const qrk::Image &image);
+    /// Pack the images together, larger ones first, which wastes less
+    /// room than adding them one by one. Regions are in the order given
+    std::vector<qrk::AtlasRegion>
+    Add(const std::vector<const qrk::Image *> &images);
+    qrk::AtlasRegion AddFromFile(const std::string &path);
+    /// Rebuild the mip levels of the pages images were added to, has to
+    /// be called before drawing them with more than one level
+    void GenerateMipmaps();
+
+    size_t GetPageCount() const { return pages.size(); }
+    size_t GetImageCount() const { return imageCount; }
+    /// Share of the page area covered by images, without their gutters
+    float GetOccupancy() const;
+
+private:
+    struct Page {
+        qrk::Texture2D texture;
+        stbrp_context context;
+        std::vector<stbrp_node> nodes;
+        bool mipmapsDirty = false;
+    };
+
+    qrk::TextureAtlasSettings settings;
+    //pages do not move, regions point at their textures
+    std::vector<std::unique_ptr<Page>> pages;
+    //images are packed in units of this many pixels, a pixel of the
+    //smallest mip level
+    int cellSize;
+    //pixels between the edges of a cell and its image
+    int gutter;
+    size_t imageCount = 0;
+    size_t imageArea = 0;
+    //border extended copy of an image, reused between uploads
+    std::vector<unsigned char> staging;
+
+    Page &AddPage();
+    //the cell of the image starts at x, y and is width by height pixels
+    void Upload(Page &page, const qrk::Image &image, int x, int y,
+                int width, int height);
+};
+}// namespace qrk
+
+#endif// !Q_TEXTURE_ATLAS
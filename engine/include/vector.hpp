@@ -2,6 +2,8 @@
 #define QRK_VECTOR
 
 #include "../include/matrix.hpp"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <stdint.h>
 #include <vector>
@@ -401,60 +403,75 @@ inline qrk::vec4f Mat4xVec4(qrk::mat4 &matrix, qrk::vec4f &vector) {
                      matrix.data[3][3] * vector.w()});
 }
 
+//the builders list the rows flat, which fills the matrix array directly
+//instead of going through nested vectors on the heap
 inline mat4 CreateTranslationMatrix(float x, float y, float z) {
-    return mat4({{1, 0, 0, x}, {0, 1, 0, y}, {0, 0, 1, z}, {0, 0, 0, 1}});
+    return mat4({1, 0, 0, x, 0, 1, 0, y, 0, 0, 1, z, 0, 0, 0, 1});
 }
 
 inline mat4 CreateScaleMatrix(float x, float y, float z) {
-    return mat4({{x, 0, 0, 0}, {0, y, 0, 0}, {0, 0, z, 0}, {0, 0, 0, 1}});
+    return mat4({x, 0, 0, 0, 0, y, 0, 0, 0, 0, z, 0, 0, 0, 0, 1});
 }
 
 inline mat4 CreateRotationMatrix(float x, float y, float z) {
-    mat4 rotationX({{1, 0, 0, 0},
-                    {0, std::cos(x), -std::sin(x), 0},
-                    {0, std::sin(x), std::cos(x), 0},
-                    {0, 0, 0, 1}});
-    mat4 rotationY({{std::cos(y), 0, -std::sin(y), 0},
-                    {0, 1, 0, 0},
-                    {std::sin(y), 0, std::cos(y), 0},
-                    {0, 0, 0, 1}});
-    mat4 rotationZ({{std::cos(z), -std::sin(z), 0, 0},
-                    {std::sin(z), std::cos(z), 0, 0},
-                    {0, 0, 1, 0},
-                    {0, 0, 0, 1}});
+    mat4 rotationX({1, 0, 0, 0,
+                    0, std::cos(x), -std::sin(x), 0,
+                    0, std::sin(x), std::cos(x), 0,
+                    0, 0, 0, 1});
+    mat4 rotationY({std::cos(y), 0, -std::sin(y), 0,
+                    0, 1, 0, 0,
+                    std::sin(y), 0, std::cos(y), 0,
+                    0, 0, 0, 1});
+    mat4 rotationZ({std::cos(z), -std::sin(z), 0, 0,
+                    std::sin(z), std::cos(z), 0, 0,
+                    0, 0, 1, 0,
+                    0, 0, 0, 1});
     return rotationZ * rotationY * rotationX;
 }
 
+/// Same result as translation * rotation * scale, without the products
+inline mat4 CreateModelMatrix(vec3f position, vec3f rotation, vec3f scale) {
+    mat4 model = CreateRotationMatrix(rotation.x(), rotation.y(), rotation.z());
+    for (int i = 0; i < 3; i++) {
+        model.data[i][0] *= scale.x();
+        model.data[i][1] *= scale.y();
+        model.data[i][2] *= scale.z();
+    }
+    model.data[0][3] = position.x();
+    model.data[1][3] = position.y();
+    model.data[2][3] = position.z();
+    return model;
+}
+
 inline mat4 CreateOrthographicProjectionMatrix(float left, float right,
                                                float top, float bottom,
                                                float _near, float _far) {
-    return mat4(
-            {{(2 / (right - left)), 0, 0, ((right + left) / (right - left))},
-             {0, (2 / (top - bottom)), 0, ((top + bottom) / (top - bottom))},
-             {0, 0, (2 / (_far - _near)), ((_far + _near) / (_far - _near))},
-             {0, 0, 0, 1}});
+    return mat4({(2 / (right - left)), 0, 0, ((right + left) / (right - left)),
+                 0, (2 / (top - bottom)), 0, ((top + bottom) / (top - bottom)),
+                 0, 0, (2 / (_far - _near)), ((_far + _near) / (_far - _near)),
+                 0, 0, 0, 1});
 }
 
 inline mat4 CreatePerspectiveProjectionMatrix(float fov, float aspect,
                                               float _near, float _far) {
-    return mat4({{(2 * _near / (aspect * std::tan(fov / 2))), 0, 0, 0},
-                 {0, (2 * _near / std::tan(fov / 2)), 0, 0},
-                 {0, 0, (-(_far + _near) / (_far - _near)),
-                  (-(2 * _far * _near) / (_far - _near))},
-                 {0, 0, -1, 0}});
+    return mat4({(2 * _near / (aspect * std::tan(fov / 2))), 0, 0, 0,
+                 0, (2 * _near / std::tan(fov / 2)), 0, 0,
+                 0, 0, (-(_far + _near) / (_far - _near)),
+                 (-(2 * _far * _near) / (_far - _near)),
+                 0, 0, -1, 0});
 }
 
 inline qrk::mat4 LookAtMatrix(vec3f position, vec3f target, vec3f up) {
     qrk::vec3f direction = qrk::normalize(position - target);
     qrk::vec3f right = qrk::normalize(qrk::CrossProduct(direction, up));
-    qrk::mat4 first({{right.x(), right.y(), right.z(), 0},
-                     {up.x(), up.y(), up.z(), 0},
-                     {direction.x(), direction.y(), direction.z(), 0},
-                     {0, 0, 0, 1}});
-    qrk::mat4 second({{1, 0, 0, -position.x()},
-                      {0, 1, 0, -position.y()},
-                      {0, 0, 1, -position.z()},
-                      {0, 0, 0, 1}});
+    qrk::mat4 first({right.x(), right.y(), right.z(), 0,
+                     up.x(), up.y(), up.z(), 0,
+                     direction.x(), direction.y(), direction.z(), 0,
+                     0, 0, 0, 1});
+    qrk::mat4 second({1, 0, 0, -position.x(),
+                      0, 1, 0, -position.y(),
+                      0, 0, 1, -position.z(),
+                      0, 0, 0, 1});
     return first * second;
 }
 inline qrk::mat4 identity4() {
@@ -33,7 +33,8 @@ public:
     glWindow(const std::string &windowName, qrk::vec2u size,
              qrk::WindowSettings settings =
                      {Q_WINDOW_DEFAULT, 8, {255, 255, 255, 255}, 4, 6})
-        : Open(true), windowSize(size), mouseMovedCallback(nullptr) {
+        : Open(true), windowSize(size), mouseMovedCallback(nullptr),
+          contextDetached(false) {
         Create(windowName, size, settings.windowStyle,
                settings.multisamplingLevel, settings.clearColor,
                settings.glMajorVersion, settings.glMinorVersion);
@@ -56,6 +57,10 @@ public:
     void MakeContextCurrent() const {
         wglMakeCurrent(deviceContext, glContext);
     }
+    void ReleaseContext() const { wglMakeCurrent(deviceContext, nullptr); }
+    /// A detached context is owned by another thread, window messages then
+    /// leave the context and the viewport alone
+    void SetContextDetached(bool detached) { contextDetached = detached; }
     void SetClearColor(qrk::Color _clearColor) {
         qrk::ColorF fColor = qrk::ConvertToFloat(_clearColor);
         glClearColor(fColor.r, fColor.g, fColor.b, fColor.a);
@@ -138,6 +143,8 @@ protected:
     //callback functions
     void (*mouseMovedCallback)(qrk::vec2i mousePosition);
 
+    bool contextDetached;
+
     static LRESULT CALLBACK Process(HWND hwnd, UINT uMsg, WPARAM wParam,
                                     LPARAM lParam);
     static LRESULT CALLBACK DummyProcess(HWND hwnd, UINT uMsg, WPARAM wParam,
@@ -1,22 +1,206 @@
 #include "../include/GL_assets.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
 
-bool qrk::assets::Program::Compile(const std::string &vertexPath,
-                                   const std::string &fragmentPath) {
-    if (!std::filesystem::exists(vertexPath)) {
-        std::string error = "Invalid vertex shader path: " + vertexPath;
-        qrk::debug::LogError(error);
-        qrk::debug::ShowErrorBox(error);
-        return false;
+namespace {
+//start of every cache file, the binary follows
+struct BinaryHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;
+    uint32_t length;
+    float compileTime;
+};
+constexpr char binaryMagic[4] = {'Q', 'P', 'R', 'G'};
+constexpr uint32_t binaryVersion = 1;
+
+//64 bit FNV-1a, strings are separated so moving text between them changes
+//the hash
+void HashString(uint64_t &hash, const std::string &string) {
+    for (unsigned char character : string) {
+        hash ^= character;
+        hash *= 1099511628211ull;
     }
-    if (!std::filesystem::exists(fragmentPath)) {
-        std::string error = "Invalid fragment shader path: " + fragmentPath;
-        qrk::debug::LogError(error);
-        qrk::debug::ShowErrorBox(error);
+    hash ^= 0xff;
+    hash *= 1099511628211ull;
+}
+
+std::string GetString(GLenum name) {
+    const GLubyte *string = glGetString(name);
+    return string == nullptr ? "" : reinterpret_cast<const char *>(string);
+}
+
+//glad is generated without extensions, so these are looked up by hand
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void(APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+MaxShaderCompilerThreadsProc maxShaderCompilerThreads = nullptr;
+
+float MillisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<float, std::milli>(
+                   std::chrono::steady_clock::now() - start)
+            .count();
+}
+
+//defines have to follow the #version line, nothing may come before it
+void InsertDefines(std::string &code, const std::string &defines) {
+    size_t version = code.find("#version");
+    size_t position = 0;
+    if (version != std::string::npos) {
+        position = code.find('\n', version);
+        position = position == std::string::npos ? code.size() : position + 1;
+    }
+    code.insert(position, defines);
+}
+}// namespace
+
+qrk::assets::ProgramCache::ProgramCache(std::filesystem::path _directory)
+    : directory(std::move(_directory)) {
+    if (directory.empty()) { return; }
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats <= 0) {
+        qrk::debug::LogWarning("The driver can not save program binaries, "
+                               "programs are compiled every launch");
+        return;
+    }
+    enabled = true;
+    driver = GetString(GL_VENDOR) + "\n" + GetString(GL_RENDERER) + "\n" +
+             GetString(GL_VERSION);
+}
+
+uint64_t qrk::assets::ProgramCache::GetKey(const std::string &vertexCode,
+                                           const std::string &fragmentCode,
+                                           const std::string &defines) const {
+    uint64_t hash = 14695981039346656037ull;
+    HashString(hash, driver);
+    HashString(hash, defines);
+    HashString(hash, vertexCode);
+    HashString(hash, fragmentCode);
+    return hash;
+}
+
+std::filesystem::path qrk::assets::ProgramCache::GetPath(uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin",
+                  static_cast<unsigned long long>(key));
+    return directory / name;
+}
+
+bool qrk::assets::ProgramCache::Load(GLuint program, uint64_t key) {
+    if (!enabled) { return false; }
+    auto start = std::chrono::steady_clock::now();
+    std::filesystem::path path = GetPath(key);
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) { return false; }
+
+    BinaryHeader header;
+    std::vector<char> binary;
+    bool valid = static_cast<bool>(
+            file.read(reinterpret_cast<char *>(&header), sizeof(header)));
+    valid = valid &&
+            std::equal(header.magic, header.magic + 4, binaryMagic) &&
+            header.version == binaryVersion && header.key == key;
+    if (valid) {
+        binary.resize(header.length);
+        valid = static_cast<bool>(file.read(binary.data(), header.length));
+    }
+    file.close();
+
+    GLint linkStatus = GL_FALSE;
+    if (valid) {
+        glProgramBinary(program, header.format, binary.data(),
+                        static_cast<GLsizei>(binary.size()));
+        glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+    }
+    if (linkStatus != GL_TRUE) {
+        qrk::debug::LogWarning("Discarding invalid program binary: " +
+                               path.string());
+        std::error_code error;
+        std::filesystem::remove(path, error);
         return false;
     }
+    loadedCount++;
+    timeSaved += header.compileTime - MillisecondsSince(start);
+    return true;
+}
+
+void qrk::assets::ProgramCache::Store(GLuint program, uint64_t key,
+                                      float compileTime) {
+    compiledCount++;
+    if (!enabled) { return; }
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) { return; }
+    BinaryHeader header;
+    std::copy(binaryMagic, binaryMagic + 4, header.magic);
+    header.version = binaryVersion;
+    header.key = key;
+    header.compileTime = compileTime;
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+    header.format = format;
+    header.length = static_cast<uint32_t>(length);
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    std::filesystem::path path = GetPath(key);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(binary.data(), length);
+    if (!file) {
+        qrk::debug::LogWarning("Failed to write program binary: " +
+                               path.string());
+    }
+}
 
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+void qrk::assets::LoadParallelShaderCompile(
+        void *(*getProcAddress)(const char *)) {
+    maxShaderCompilerThreads = nullptr;
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const GLubyte *name = glGetStringi(GL_EXTENSIONS, i);
+        if (name == nullptr) { continue; }
+        std::string extension = reinterpret_cast<const char *>(name);
+        if (extension == "GL_KHR_parallel_shader_compile") {
+            maxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)
+                    getProcAddress("glMaxShaderCompilerThreadsKHR");
+        } else if (extension == "GL_ARB_parallel_shader_compile" &&
+                   maxShaderCompilerThreads == nullptr) {
+            maxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)
+                    getProcAddress("glMaxShaderCompilerThreadsARB");
+        }
+    }
+    //let the driver pick as many threads as it likes
+    if (maxShaderCompilerThreads != nullptr) {
+        maxShaderCompilerThreads(0xFFFFFFFF);
+    }
+}
+
+bool qrk::assets::HasParallelShaderCompile() {
+    return maxShaderCompilerThreads != nullptr;
+}
+
+void qrk::assets::Program::Submit(const std::string &_vertexPath,
+                                  const std::string &_fragmentPath,
+                                  ProgramCache *_cache,
+                                  const std::string &defines) {
+    vertexPath = _vertexPath;
+    fragmentPath = _fragmentPath;
+    cache = _cache;
+    programHandle = glCreateProgram();
+    uniformBlockIndex = NULL;
+    if (!std::filesystem::exists(vertexPath)) {
+        Fail("Invalid vertex shader path: " + vertexPath);
+    }
+    if (!std::filesystem::exists(fragmentPath)) {
+        Fail("Invalid fragment shader path: " + fragmentPath);
+    }
 
     std::string vertexCode;
     std::string fragmentCode;
@@ -29,17 +213,39 @@ bool qrk::assets::Program::Compile(const std::string &vertexPath,
         vertexBuffer << vertexShaderFile.rdbuf();
         vertexCode = vertexBuffer.str();
         vertexShaderFile.close();
-    } else
-        return false;
+    } else {
+        Fail("Failed to open vertex shader: " + vertexPath);
+    }
 
     if (fragmentShaderFile.is_open()) {
         std::stringstream fragmentBuffer;
         fragmentBuffer << fragmentShaderFile.rdbuf();
         fragmentCode = fragmentBuffer.str();
         fragmentShaderFile.close();
-    } else
-        return false;
+    } else {
+        Fail("Failed to open fragment shader: " + fragmentPath);
+    }
+    if (!defines.empty()) {
+        InsertDefines(vertexCode, defines);
+        InsertDefines(fragmentCode, defines);
+    }
+
+    pending = true;
+    vertexShader = 0;
+    fragmentShader = 0;
+    if (cache != nullptr) {
+        key = cache->GetKey(vertexCode, fragmentCode, defines);
+        if (cache->Load(programHandle, key)) {
+            cache = nullptr;
+            return;
+        }
+    }
+    compileStart = std::chrono::steady_clock::now();
 
+    //no status is read here, the driver is free to compile in the
+    //background until Finish asks for the link
+    vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
     char const *sourcePtr = vertexCode.c_str();
     glShaderSource(vertexShader, 1, &sourcePtr, NULL);
     glCompileShader(vertexShader);
@@ -48,72 +254,133 @@ bool qrk::assets::Program::Compile(const std::string &vertexPath,
     glShaderSource(fragmentShader, 1, &sourcePtr, NULL);
     glCompileShader(fragmentShader);
 
-    GLint compileStatus = GL_FALSE;
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &compileStatus);
-    if (compileStatus != GL_TRUE) {
-        GLsizei log_length = 0;
-        GLchar message[1024];
-        glGetShaderInfoLog(vertexShader, 1024, &log_length, message);
-        std::stringstream error;
-        error << "Failed to compile vertex shader: " << message;
-        qrk::debug::LogError(error.str());
-        qrk::debug::ShowErrorBox(error.str());
-        return false;
+    glAttachShader(programHandle, vertexShader);
+    glAttachShader(programHandle, fragmentShader);
+    if (cache != nullptr && cache->IsEnabled()) {
+        glProgramParameteri(programHandle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                            GL_TRUE);
     }
+    glLinkProgram(programHandle);
+}
 
-    glGetShaderiv(vertexShader, GL_VALIDATE_STATUS, &compileStatus);
-    if (compileStatus != GL_TRUE) {
-        GLsizei log_length = 0;
-        GLchar message[1024];
-        glGetShaderInfoLog(vertexShader, 1024, &log_length, message);
-        std::stringstream error;
-        error << "Failed to compile vertex shader: " << message;
-        qrk::debug::LogError(error.str());
-        qrk::debug::ShowErrorBox(error.str());
-        return false;
-    }
+bool qrk::assets::Program::IsReady() const {
+    if (!pending || vertexShader == 0) { return true; }
+    if (!HasParallelShaderCompile()) { return false; }
+    GLint completed = GL_FALSE;
+    glGetProgramiv(programHandle, GL_COMPLETION_STATUS_KHR, &completed);
+    return completed == GL_TRUE;
+}
 
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &compileStatus);
-    if (compileStatus != GL_TRUE) {
-        GLsizei log_length = 0;
-        GLchar message[1024];
-        glGetShaderInfoLog(fragmentShader, 1024, &log_length, message);
-        std::stringstream error;
-        error << "Failed to compile fragment shader: " << message;
-        qrk::debug::LogError(error.str());
-        qrk::debug::ShowErrorBox(error.str());
-        return false;
+void qrk::assets::Program::Finish() {
+    if (!pending) { return; }
+    //programs loaded from the cache are already linked
+    if (vertexShader != 0) {
+        GLint compileStatus = GL_FALSE;
+        glGetProgramiv(programHandle, GL_LINK_STATUS, &compileStatus);
+        if (compileStatus != GL_TRUE) {
+            //the shader logs say more than the link log when one of them
+            //did not compile
+            GLsizei log_length = 0;
+            GLchar message[1024];
+            glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &compileStatus);
+            if (compileStatus != GL_TRUE) {
+                glGetShaderInfoLog(vertexShader, 1024, &log_length, message);
+                Fail(std::string("Failed to compile vertex shader: ") +
+                     message);
+            }
+            glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &compileStatus);
+            if (compileStatus != GL_TRUE) {
+                glGetShaderInfoLog(fragmentShader, 1024, &log_length,
+                                   message);
+                Fail(std::string("Failed to compile fragment shader: ") +
+                     message);
+            }
+            glGetProgramInfoLog(programHandle, 1024, &log_length, message);
+            Fail(std::string("Failed to link program: ") + message);
+        }
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        vertexShader = 0;
+        fragmentShader = 0;
+        //the time includes whatever ran between Submit and Finish, so it
+        //is the most the cache can save
+        if (cache != nullptr) {
+            cache->Store(programHandle, key, MillisecondsSince(compileStart));
+        }
     }
+    pending = false;
+    cache = nullptr;
+    uniformBlockIndex = glGetUniformBlockIndex(programHandle, "uniformBlock");
+}
 
-    glGetShaderiv(fragmentShader, GL_VALIDATE_STATUS, &compileStatus);
-    if (compileStatus != GL_TRUE) {
-        GLsizei log_length = 0;
-        GLchar message[1024];
-        glGetShaderInfoLog(fragmentShader, 1024, &log_length, message);
-        std::stringstream error;
-        error << "Failed to compile fragment shader: " << message;
-        qrk::debug::LogError(error.str());
-        qrk::debug::ShowErrorBox(error.str());
-        return false;
-    }
+void qrk::assets::Program::Fail(const std::string &message) const {
+    qrk::debug::LogError(message);
+    qrk::debug::ShowErrorBox(message);
+    qrk::debug::Error("Failed to compile shader. Vertex path: " + vertexPath +
+                              " Fragment shader: " + fragmentPath,
+                      qrk::debug::Q_FAILED_TO_COMPILE_SHADER);
+}
 
-    glAttachShader(programHandle, vertexShader);
-    glAttachShader(programHandle, fragmentShader);
-    glLinkProgram(programHandle);
-    glGetProgramiv(programHandle, GL_LINK_STATUS, &compileStatus);
-
-    if (compileStatus != GL_TRUE) {
-        GLsizei log_length = 0;
-        GLchar message[1024];
-        glGetProgramInfoLog(programHandle, 1024, &log_length, message);
-        std::stringstream error;
-        error << "Failed to link program: " << message;
-        qrk::debug::LogError(error.str());
-        qrk::debug::ShowErrorBox(error.str());
-        return false;
+qrk::assets::ProgramBuilder::ProgramBuilder(ProgramCache *_cache)
+    : cache(_cache) {}
+
+void qrk::assets::ProgramBuilder::Add(Program &program,
+                                      const std::string &vertexPath,
+                                      const std::string &fragmentPath,
+                                      const std::string &defines) {
+    program.Submit(vertexPath, fragmentPath, cache, defines);
+    programs.push_back(&program);
+}
+
+bool qrk::assets::ProgramBuilder::Poll() {
+    bool parallel = HasParallelShaderCompile();
+    auto done = [parallel](Program *program) {
+        if (parallel && !program->IsReady()) { return false; }
+        program->Finish();
+        return true;
+    };
+    programs.erase(std::remove_if(programs.begin(), programs.end(), done),
+                   programs.end());
+    return programs.empty();
+}
+
+void qrk::assets::ProgramBuilder::Finish() {
+    //in submission order, the driver works through them in that order
+    for (Program *program : programs) { program->Finish(); }
+    programs.clear();
+}
+
+void qrk::assets::ProgramVariants::Prepare(uint32_t variant,
+                                           ProgramBuilder &builder) {
+    if (variants.count(variant) != 0) { return; }
+    auto &program = variants[variant] = std::make_unique<Program>();
+    builder.Add(*program, vertexPath, fragmentPath, GetDefines(variant));
+}
+
+qrk::assets::Program &qrk::assets::ProgramVariants::Get(uint32_t variant) {
+    auto found = variants.find(variant);
+    if (found != variants.end()) { return *found->second; }
+    auto &program = variants[variant] = std::make_unique<Program>();
+    program->Submit(vertexPath, fragmentPath, cache, GetDefines(variant));
+    return *program;
+}
+
+std::string
+qrk::assets::ProgramVariants::GetDefines(uint32_t variant) const {
+    std::string defines;
+    for (size_t i = 0; i < features.size(); i++) {
+        bool enabled = (variant >> i & 1) != 0;
+        defines += "#define " + features[i] + (enabled ? " 1\n" : " 0\n");
     }
+    return defines;
+}
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-    return true;
+void qrk::assets::SetVertexFormat(
+        GLuint VAO, std::initializer_list<VertexAttribute> attributes) {
+    for (const VertexAttribute &attribute : attributes) {
+        glEnableVertexArrayAttrib(VAO, attribute.index);
+        glVertexArrayAttribFormat(VAO, attribute.index, attribute.size,
+                                  GL_FLOAT, GL_FALSE, attribute.offset);
+        glVertexArrayAttribBinding(VAO, attribute.index, attribute.binding);
+    }
 }
\ No newline at end of file
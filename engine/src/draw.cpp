@@ -1,290 +1,786 @@
 #include "../include/draw.hpp"
+#include <algorithm>
 
-qrk::qb_GL_Renderer::qb_GL_Renderer(qrk::glWindow &_targetWindow,
+qrk::qb_GL_Renderer::qb_GL_Renderer(qrk::RenderSurface &_targetWindow,
                                     qrk::RendererSettings _settings)
-    : targetWindow(&_targetWindow) {
+    : jobs(_settings.workerThreads),
+      programCache(_settings.programCacheDirectory),
+      q_3dDraw("resources/shaders/3d_vertex_shader.vert",
+               "resources/shaders/3d_fragment_shader.frag",
+               {"TEXTURED", "NUM_LIGHTS", "VERTEX_FORMAT"}, &programCache),
+      targetWindow(&_targetWindow), settings(_settings) {
     if (_settings.depthTest == true) {
-        glEnable(GL_DEPTH_TEST);
-        glDepthFunc(GL_LESS);
+        qrk::glState.Enable(GL_DEPTH_TEST);
+        qrk::glState.DepthFunc(GL_LESS);
     } else {
-        glDisable(GL_DEPTH_TEST);
+        qrk::glState.Disable(GL_DEPTH_TEST);
     }
     if (_settings.cullFaces == true) {
-        glEnable(GL_CULL_FACE);
-        glCullFace(GL_BACK);
+        qrk::glState.Enable(GL_CULL_FACE);
+        qrk::glState.CullFace(GL_BACK);
     } else {
-        glDisable(GL_CULL_FACE);
+        qrk::glState.Disable(GL_CULL_FACE);
     }
     if (_settings.alpha == true) {
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        qrk::glState.Enable(GL_BLEND);
+        qrk::glState.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     } else {
-        glDisable(GL_BLEND);
+        qrk::glState.Disable(GL_BLEND);
     }
     if (_settings.multisample == true) {
-        glEnable(GL_MULTISAMPLE);
+        qrk::glState.Enable(GL_MULTISAMPLE);
         glSampleCoverage(1, GL_FALSE);
     } else {
-        glDisable(GL_MULTISAMPLE);
-    }
-    //compile the 3d program
-    q_3dDraw =
-            qrk::assets::Program("resources/shaders/3d_vertex_shader.vert",
-                                 "resources/shaders/3d_fragment_shader.frag");
-    textureID_3d = glGetUniformLocation(q_3dDraw.programHandle, "inTexture");
-    texturedID_3d = glGetUniformLocation(q_3dDraw.programHandle, "textured");
+        qrk::glState.Disable(GL_MULTISAMPLE);
+    }
+    //submit every program before waiting on any of them, the driver
+    //compiles while the buffers are created. Only the variants most draws
+    //use are built up front, the others are compiled on their first draw
+    qrk::assets::ProgramBuilder programBuilder(&programCache);
+    q_3dDraw.Prepare(Q_FEATURE_LIGHTS, programBuilder);
+    q_3dDraw.Prepare(Q_FEATURE_LIGHTS | Q_FEATURE_TEXTURED, programBuilder);
+    if (settings.depthPrepass) {
+        q_3dDraw.Prepare(Q_FEATURE_POSITION_ONLY, programBuilder);
+    }
+    programBuilder.Add(q_2dDraw, "resources/shaders/2d_vertex_shader.vert",
+                       "resources/shaders/2d_fragment_shader.frag");
+    programBuilder.Add(q_textDraw, "resources/shaders/text_vertex_shader.vert",
+                       "resources/shaders/text_fragment_shader.frag");
     //create the 3d UBO
     glGenBuffers(1, &UBO3D);
-    glBindBuffer(GL_UNIFORM_BUFFER, UBO3D);
+    qrk::glState.BindBuffer(GL_UNIFORM_BUFFER, UBO3D);
     glBufferData(GL_UNIFORM_BUFFER, sizeof(UniformData3D), nullptr,
                  GL_DYNAMIC_COPY);
-    glBindBufferBase(GL_UNIFORM_BUFFER, 3, UBO3D);
+    qrk::glState.BindBufferBase(GL_UNIFORM_BUFFER, 3, UBO3D);
+
+    //create the light source SSBO, grown and filled by Draw
+    lightPool.Create(4);
+    //create the 3d instance SSBO, filled once per frame
+    glGenBuffers(1, &instance_SSBO);
+    qrk::glState.BindBuffer(GL_SHADER_STORAGE_BUFFER, instance_SSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(InstanceData3D), nullptr,
+                 GL_STREAM_DRAW);
+    qrk::glState.BindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, instance_SSBO);
+    qrk::glState.BindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    //create the material SSBO and the indirect command buffer, both
+    //refilled every frame
+    glCreateBuffers(1, &material_SSBO);
+    glNamedBufferData(material_SSBO, sizeof(Material), nullptr,
+                      GL_STREAM_DRAW);
+    qrk::glState.BindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, material_SSBO);
+    glCreateBuffers(1, &indirectBuffer);
+    //create the buffers the retained 3d draws stay resident in
+    glCreateBuffers(1, &retainedInstanceBuffer);
+    glCreateBuffers(1, &retainedMaterialBuffer);
+    glCreateBuffers(1, &retainedCommandBuffer);
+    meshPool.Create();
+    //create the light cluster SSBOs, filled by the first Draw
+    lightClusters.Create();
+    lightClusters.Bind();
+    //create the shared quad all 2d draws are instanced from
+    spriteBatch.Create();
 
-    //create the light source SSBO
-    glGenBuffers(1, &lightSource_SSBO);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, lightSource_SSBO);
-    glBufferData(GL_SHADER_STORAGE_BUFFER,
-                 q_3dLightSources.size() * sizeof(LightSource), nullptr,
-                 GL_DYNAMIC_COPY);
-    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0,
-                    q_3dLightSources.size() * sizeof(LightSource),
-                    q_3dLightSources.data());
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, lightSource_SSBO);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
-    //compile the 2d program
-    q_2dDraw =
-            qrk::assets::Program("resources/shaders/2d_vertex_shader.vert",
-                                 "resources/shaders/2d_fragment_shader.frag");
-    textureID_2d = glGetUniformLocation(q_2dDraw.programHandle, "f_texture");
-    texturedID_2d = glGetUniformLocation(q_2dDraw.programHandle, "textured");
-    //create the 2d UBO
-    glGenBuffers(1, &UBO2D);
-    glBindBuffer(GL_UNIFORM_BUFFER, UBO2D);
-    glBufferData(GL_UNIFORM_BUFFER, sizeof(UniformData2D), &UBO2D_Data,
-                 GL_DYNAMIC_COPY);
-    glBindBufferBase(GL_UNIFORM_BUFFER, 2, UBO2D);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-
-    //compile the text program
-    q_textDraw =
-            qrk::assets::Program("resources/shaders/text_vertex_shader.vert",
-                                 "resources/shaders/text_fragment_shader.frag");
-    textureID_Text =
-            glGetUniformLocation(q_textDraw.programHandle, "f_texture");
     //create the text UBO
     glGenBuffers(1, &UBO_Text);
-    glBindBuffer(GL_UNIFORM_BUFFER, UBO_Text);
+    qrk::glState.BindBuffer(GL_UNIFORM_BUFFER, UBO_Text);
     glBufferData(GL_UNIFORM_BUFFER, sizeof(UniformDataText), nullptr,
                  GL_DYNAMIC_COPY);
-    glBindBufferBase(GL_UNIFORM_BUFFER, 1, UBO_Text);
+    qrk::glState.BindBufferBase(GL_UNIFORM_BUFFER, 1, UBO_Text);
+
+    qrk::glState.BindBuffer(GL_UNIFORM_BUFFER, 0);
 
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    //create the ring buffer the per draw data is streamed through
+    if (settings.persistentMapping) {
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT,
+                      &storageAlignment);
+        uniformRing.Create(1 << 20);
+    }
+    //wait for the programs, their samplers and uniform locations are
+    //fixed by the shaders
+    programBuilder.Finish();
+    if (programCache.IsEnabled()) {
+        qrk::debug::Log(
+                "Program cache: " +
+                std::to_string(programCache.GetLoadedCount()) + " loaded, " +
+                std::to_string(programCache.GetCompiledCount()) +
+                " compiled, " +
+                std::to_string(static_cast<int>(programCache.GetTimeSaved())) +
+                " ms of startup saved");
+    }
+    if (settings.profilePasses) { profiler.Create(); }
 }
 
-void qrk::qb_GL_Renderer::Draw() {
-    if (!targetWindow->IsOpen()) { return; }
-    if (!targetWindow->IsContextCurrent()) {
-        targetWindow->MakeContextCurrent();
+GLsizeiptr qrk::qb_GL_Renderer::EstimateFrameUpload() const {
+    auto aligned = [](GLsizeiptr size, GLint alignment) {
+        return (size + alignment - 1) / alignment * alignment;
+    };
+    GLsizeiptr size = aligned(q_3dObjects.size() * sizeof(InstanceData3D),
+                              storageAlignment);
+    size += aligned(q_3dObjects.size() * sizeof(Material), storageAlignment);
+    size += q_3dObjects.size() * sizeof(DrawArraysIndirectCommand);
+    size += aligned(sizeof(UniformData3D), uniformAlignment);
+    size += aligned(q_2dObjects.size() * sizeof(SpriteInstance),
+                    sizeof(SpriteInstance));
+    size += aligned(q_UIObjects.size() * sizeof(SpriteInstance),
+                    sizeof(SpriteInstance));
+    size += q_Text.size() * aligned(sizeof(UniformDataText), uniformAlignment);
+    return size;
+}
+
+void qrk::qb_GL_Renderer::RemoveRenderable(qrk::RenderHandle handle) {
+    std::lock_guard<std::mutex> lock(submitMutex);
+    bool removed = false;
+    switch (handle.pass) {
+        case qrk::Q_PASS_OPAQUE:
+            removed = retained3d.Remove(handle.handle);
+            retainedResized = true;
+            if (removed) {
+                uint32_t &proxy = retainedBounds[handle.handle.slot].proxy;
+                retainedBVH.Remove(proxy);
+                proxy = qrk::DynamicBVH::nullNode;
+            }
+            break;
+        case qrk::Q_PASS_2D:
+            removed = retained2d.Remove(handle.handle);
+            break;
+        case qrk::Q_PASS_UI:
+            removed = retainedUI.Remove(handle.handle);
+            break;
+        case qrk::Q_PASS_TEXT:
+            removed = retainedText.Remove(handle.handle);
+            if (removed) { retainedTextMeshes[handle.handle.slot].clear(); }
+            break;
+        default:
+            break;
     }
-    //3d draw
-    if (qrk::GetBoundProgram() != this->q_3dDraw.programHandle) {
-        this->q_3dDraw.UseProgram();
+    if (!removed) {
+        qrk::debug::Warning("Removing a draw that is not retained");
     }
+}
 
-    qrk::vec2u screenSize = targetWindow->GetSize();
-    qrk::mat4 projectionMatrix = qrk::CreatePerspectiveProjectionMatrix(
-            70.f, (float) screenSize.x() / (float) screenSize.y(), 1.f, 100.f);
-    UBO3D_Data.projection = projectionMatrix;
-    qrk::mat4 identity = qrk::identity4();
-    UBO3D_Data.view = identity; //temporary hack. The view matrix comes from the camera, don't write some stupidass function in the renderer, okay?
+qrk::RenderHandle qrk::qb_GL_Renderer::PickRenderable(qrk::vec3f origin,
+                                                     qrk::vec3f direction,
+                                                     float maxDistance,
+                                                     float *distance) {
+    std::lock_guard<std::mutex> lock(submitMutex);
+    float start[3] = {origin.x(), origin.y(), origin.z()};
+    float inverse[3] = {1.f / direction.x(), 1.f / direction.y(),
+                        1.f / direction.z()};
+    qrk::RenderHandle closest;
+    float closestDistance = maxDistance;
+    //the tree holds enlarged boxes, hits are confirmed on the exact ones
+    retainedBVH.QueryRay(origin, direction, maxDistance, [&](uint32_t proxy) {
+        qrk::PoolHandle handle = GetRetainedHandle(proxy);
+        float hit;
+        if (qrk::IntersectRay(retainedBounds[handle.slot].box, start, inverse,
+                              closestDistance, hit) &&
+            hit < closestDistance) {
+            closest = {handle, qrk::Q_PASS_OPAQUE};
+            closestDistance = hit;
+        }
+        return closestDistance;
+    });
+    if (closest.IsValid() && distance != nullptr) {
+        *distance = closestDistance;
+    }
+    return closest;
+}
+
+void qrk::qb_GL_Renderer::IndexRetained3d(qrk::PoolHandle handle,
+                                          const DrawData_3D &drawData) {
+    if (handle.slot >= retainedBounds.size()) {
+        retainedBounds.resize(handle.slot + 1);
+    }
+    RetainedBounds &bounds = retainedBounds[handle.slot];
+    bounds.box = qrk::TransformAABB(drawData.bounds, drawData.model);
+    if (bounds.proxy == qrk::DynamicBVH::nullNode) {
+        uint64_t packed =
+                (static_cast<uint64_t>(handle.generation) << 32) | handle.slot;
+        bounds.proxy = retainedBVH.Insert(bounds.box, packed);
+    } else {
+        retainedBVH.Move(bounds.proxy, bounds.box);
+    }
+}
+
+void qrk::qb_GL_Renderer::StoreRetainedText(qrk::PoolHandle handle,
+                                            const DrawData_Text &drawData) {
+    if (handle.slot >= retainedTextMeshes.size()) {
+        retainedTextMeshes.resize(handle.slot + 1);
+    }
+    std::vector<GLfloat> &mesh = retainedTextMeshes[handle.slot];
+    const GLfloat *vertices = drawData.vertices;
+    if (vertices != nullptr) {
+        mesh.assign(vertices, vertices + drawData.vertexCount * 4);
+        vertices = mesh.data();
+    }
+    DrawData_Text update = drawData;
+    update.vertices = vertices;
+    retainedText.Update(handle, update);
+}
+
+void qrk::qb_GL_Renderer::MarkRetainedDirty(qrk::RetainedDraw &retained) {
+    std::lock_guard<std::mutex> lock(submitMutex);
+    retained.dirtyIndex = static_cast<uint32_t>(retainedDirty.size());
+    retainedDirty.push_back(&retained);
+}
+
+void qrk::qb_GL_Renderer::UnmarkRetainedDirty(qrk::RetainedDraw &retained) {
+    std::lock_guard<std::mutex> lock(submitMutex);
+    RetainedDraw *last = retainedDirty.back();
+    retainedDirty[retained.dirtyIndex] = last;
+    last->dirtyIndex = retained.dirtyIndex;
+    retainedDirty.pop_back();
+    retained.dirtyIndex = RetainedDraw::notDirty;
+}
+
+void qrk::qb_GL_Renderer::MoveRetainedDirty(qrk::RetainedDraw &from,
+                                            qrk::RetainedDraw &to) {
+    std::lock_guard<std::mutex> lock(submitMutex);
+    to.dirtyIndex = from.dirtyIndex;
+    retainedDirty[to.dirtyIndex] = &to;
+    from.dirtyIndex = RetainedDraw::notDirty;
+}
 
-    for (int i = 0; i < q_3dObjects.size(); i++) {
-        UBO3D_Data.position = q_3dObjects[i].position;
-        UBO3D_Data.rotation = q_3dObjects[i].rotation;
-        UBO3D_Data.scale = q_3dObjects[i].scale;
-        UBO3D_Data.color =
-                qrk::vec4f({q_3dObjects[i].color.r, q_3dObjects[i].color.g,
-                            q_3dObjects[i].color.b, q_3dObjects[i].color.a});
-        if (q_3dObjects[i].textured && q_3dObjects[i].texture != nullptr) {
-            glUniform1i(texturedID_3d, GL_TRUE);
-            q_3dObjects[i].texture->BindTexture();
-            glUniform1i(textureID_3d, 0);
-        } else {
-            glUniform1i(texturedID_3d, GL_FALSE);
+void qrk::qb_GL_Renderer::FlushRetained() {
+    {
+        std::lock_guard<std::mutex> lock(submitMutex);
+        retainedFlushing.swap(retainedDirty);
+        for (RetainedDraw *retained : retainedFlushing) {
+            retained->dirtyIndex = RetainedDraw::notDirty;
         }
+    }
+    //the owners are read without the lock, UpdateRenderable takes it
+    for (RetainedDraw *retained : retainedFlushing) {
+        retained->send(*retained);
+    }
+    retainedFlushing.clear();
+}
 
-        glBindBuffer(GL_UNIFORM_BUFFER, UBO3D);
-        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(UniformData3D),
-                        &UBO3D_Data);
-        glUniformBlockBinding(q_3dDraw.programHandle,
-                              q_3dDraw.uniformBlockIndex, 3);
+void qrk::qb_GL_Renderer::SubmitDrawList(qrk::DrawList &list,
+                                         uint32_t sequence) {
+    std::lock_guard<std::mutex> lock(submitMutex);
+    submittedLists.emplace_back(sequence, std::move(list));
+    if (recycledLists.empty()) {
+        list = DrawList();
+    } else {
+        list = std::move(recycledLists.back());
+        recycledLists.pop_back();
+    }
+}
 
-        glBindVertexArray(q_3dObjects[i].VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, q_3dObjects[i].VBO);
+void qrk::qb_GL_Renderer::EndRecording() {
+    FlushRetained();
+    std::lock_guard<std::mutex> lock(submitMutex);
+    for (auto &list : submittedLists) {
+        recordedLists.push_back(std::move(list));
+    }
+    submittedLists.clear();
+    drawingArena = recordingArena;
+    recordingArena ^= 1;
+}
 
-        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat),
-                              (void *) 0);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat),
-                              (void *) (4 * sizeof(GLfloat)));
-        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat),
-                              (void *) (6 * sizeof(GLfloat)));
+void qrk::qb_GL_Renderer::MergeDrawLists() {
+    std::pmr::vector<std::pair<uint32_t, DrawList>> lists(
+            &frameArenas[drawingArena]);
+    auto append = [](auto &queue, const auto &list) {
+        queue.reserve(queue.size() + list.size());
+        for (const auto &drawData : list) { queue.push_back(drawData); }
+    };
+    {
+        std::lock_guard<std::mutex> lock(submitMutex);
+        lists.reserve(recordedLists.size());
+        for (auto &list : recordedLists) { lists.push_back(std::move(list)); }
+        recordedLists.clear();
+        if (lightsDirty) {
+            lightPool.Upload();
+            clusteredLights = lightPool.GetLights();
+            clustersDirty = true;
+            lightsDirty = false;
+        }
+        //only the retained 3d draws that changed are copied
+        const std::vector<DrawData_3D> &draws = retained3d.GetElements();
+        retained3dDraws.resize(draws.size());
+        for (uint32_t index : retained3d.GetDirty()) {
+            if (index >= draws.size()) { continue; }
+            retained3dDraws[index] = draws[index];
+            retainedChanges.push_back(index);
+        }
+        retained3d.ClearDirty();
+        if (retainedResized) {
+            retainedSorted = false;
+            retainedResized = false;
+        }
+        append(q_2dObjects, retained2d.GetElements());
+        append(q_UIObjects, retainedUI.GetElements());
+        size_t firstText = q_Text.size();
+        append(q_Text, retainedText.GetElements());
+        //text vertices are uploaded once, by the frame after the change.
+        //They are copied into the drawing arena, the copy held by the
+        //renderer can be replaced as soon as the lock is released
+        for (uint32_t index : retainedText.GetDirty()) {
+            if (index >= retainedText.Size()) { continue; }
+            DrawData_Text &text = retainedText.GetElements()[index];
+            if (text.vertices == nullptr) { continue; }
+            size_t count = text.vertexCount * 4;
+            GLfloat *vertices =
+                    static_cast<GLfloat *>(frameArenas[drawingArena].allocate(
+                            count * sizeof(GLfloat), alignof(GLfloat)));
+            std::copy(text.vertices, text.vertices + count, vertices);
+            q_Text[firstText + index].vertices = vertices;
+            text.vertices = nullptr;
+        }
+        retainedText.ClearDirty();
+    }
+    //insertion sort is stable without the buffer std::stable_sort takes
+    //from the heap, and there are only ever a few lists
+    for (size_t i = 1; i < lists.size(); i++) {
+        for (size_t j = i; j > 0 && lists[j].first < lists[j - 1].first; j--) {
+            std::swap(lists[j], lists[j - 1]);
+        }
+    }
+    for (auto &[sequence, list] : lists) {
+        append(q_3dObjects, list.objects3d);
+        append(q_2dObjects, list.objects2d);
+        append(q_UIObjects, list.objectsUI);
+        append(q_Text, list.text);
+        list.Clear();
+    }
+    std::lock_guard<std::mutex> lock(submitMutex);
+    for (auto &[sequence, list] : lists) {
+        recycledLists.push_back(std::move(list));
+    }
+}
 
-        glEnableVertexAttribArray(0);
-        glEnableVertexAttribArray(1);
-        glEnableVertexAttribArray(2);
+GLuint qrk::qb_GL_Renderer::FindMaterial(Batch3D &batch,
+                                         const Material &material, bool add) {
+    std::vector<GLuint> &table = batch.materialTable;
+    if (add && (batch.materials.size() + 1) * 2 > table.size()) {
+        //the table keeps its size between frames, so it rarely grows
+        table.assign(std::max<size_t>(16, table.size() * 2), 0);
+        size_t mask = table.size() - 1;
+        for (size_t i = 0; i < batch.materials.size(); i++) {
+            size_t slot = MaterialHash()(batch.materials[i]) & mask;
+            while (table[slot] != 0) { slot = (slot + 1) & mask; }
+            table[slot] = static_cast<GLuint>(i + 1);
+        }
+    }
+    if (table.empty()) { return noMaterial; }
+    size_t mask = table.size() - 1;
+    for (size_t slot = MaterialHash()(material) & mask;;
+         slot = (slot + 1) & mask) {
+        if (table[slot] == 0) {
+            if (!add) { return noMaterial; }
+            batch.materials.push_back(material);
+            table[slot] = static_cast<GLuint>(batch.materials.size());
+            return table[slot] - 1;
+        }
+        if (batch.materials[table[slot] - 1] == material) {
+            return table[slot] - 1;
+        }
+    }
+}
+
+uint64_t
+qrk::qb_GL_Renderer::Create3dSortKey(const DrawData_3D &object) const {
+    const qrk::mat4 &view = UBO3D_Data.view;
+    GLuint texture = 0;
+    if (object.textured && object.texture != nullptr) {
+        texture = object.texture->GetTextureHandle();
+    }
+    //view depth of the object origin. The camera looks down -z, so front
+    //to back is ascending -z
+    float depth = -(view.data[2][0] * object.model.data[0][3] +
+                    view.data[2][1] * object.model.data[1][3] +
+                    view.data[2][2] * object.model.data[2][3] +
+                    view.data[2][3]) /
+                  farPlane;
+    //lighting is the same for every draw of a frame, only the texture
+    //splits the pass into variants
+    uint32_t features = texture != 0 ? Q_FEATURE_TEXTURED : 0;
+    return qrk::CreateSortKey(qrk::Q_PASS_OPAQUE, features, texture,
+                              object.VAO, depth);
+}
 
-        glDrawArrays(GL_TRIANGLES, 0, q_3dObjects[i].vertexCount);
+void qrk::qb_GL_Renderer::Build3dBatch(const std::vector<DrawData_3D> &queue,
+                                       Batch3D &batch) {
+    sortKeys.resize(queue.size());
+    jobs.ParallelFor(queue.size(), 1024, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            sortKeys[i] = {Create3dSortKey(queue[i]),
+                           static_cast<uint32_t>(i)};
+        }
+    });
+    qrk::RadixSort(sortKeys, sortScratch);
 
-        glDisableVertexAttribArray(0);
-        glDisableVertexAttribArray(1);
-        glDisableVertexAttribArray(2);
+    //one command per run of the same mesh, one multi draw per run of the
+    //same texture. Materials are deduplicated into a per batch array the
+    //instances index into, so they no longer split the draws
+    batch.commands.clear();
+    batch.textureRuns.clear();
+    batch.runTextures.clear();
+    batch.materials.clear();
+    std::fill(batch.materialTable.begin(), batch.materialTable.end(), 0);
+    batch.instances.resize(sortKeys.size());
+    batch.keys.resize(sortKeys.size());
+    batch.instanceCommands.resize(sortKeys.size());
+    batch.positions.resize(sortKeys.size());
+    GLuint runTexture = 0;
+    uint32_t commandMesh = 0;
+    GLuint material = 0;
+    for (size_t i = 0; i < sortKeys.size(); i++) {
+        const DrawData_3D &object = queue[sortKeys[i].index];
+        GLuint texture = 0;
+        if (object.textured && object.texture != nullptr) {
+            texture = object.texture->GetTextureHandle();
+        }
+        if (batch.textureRuns.empty() || texture != runTexture) {
+            batch.textureRuns.push_back(batch.commands.size());
+            batch.runTextures.push_back(texture != 0 ? object.texture
+                                                     : nullptr);
+            runTexture = texture;
+            commandMesh = 0;
+        }
+        if (commandMesh != object.mesh) {
+            GLint first = meshPool.Register(object.mesh, object.VBO,
+                                            object.vertexCount);
+            batch.commands.push_back(
+                    {static_cast<GLuint>(object.vertexCount), 0,
+                     static_cast<GLuint>(first), static_cast<GLuint>(i)});
+            commandMesh = object.mesh;
+        }
+        batch.commands.back().instanceCount++;
+        batch.keys[i] = sortKeys[i].key;
+        batch.instanceCommands[i] =
+                static_cast<GLuint>(batch.commands.size() - 1);
+        batch.positions[sortKeys[i].index] = static_cast<uint32_t>(i);
+
+        //draws of one mesh mostly share their material
+        if (batch.materials.empty() ||
+            !(batch.materials[material] == object.material)) {
+            material = FindMaterial(batch, object.material, true);
+        }
+        batch.instances[i].material = material;
     }
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    //2d draw
-    this->q_2dDraw.UseProgram();
-
-    for (int i = 0; i < q_2dObjects.size(); i++) {
-        UBO2D_Data.position = qrk::vec2f(
-                {(q_2dObjects[i].position.x() - ((float) screenSize.x() / 2)) /
-                         ((float) screenSize.x() / 2),
-                 -(q_2dObjects[i].position.y() - ((float) screenSize.y()) / 2) /
-                         ((float) screenSize.y() / 2)});
-        UBO2D_Data.size =
-                qrk::vec2f({q_2dObjects[i].size.x() / (float) screenSize.x(),
-                            q_2dObjects[i].size.y() / (float) screenSize.y()});
-        qrk::mat4 rotMatrix =
-                qrk::CreateRotationMatrix(q_2dObjects[i].rotation, 0.f, 0.f);
-        UBO2D_Data.rotation = rotMatrix;
-        UBO2D_Data.zLayer = q_2dObjects[i].zLayer;
-        UBO2D_Data.color =
-                qrk::vec4f({q_2dObjects[i].color.r, q_2dObjects[i].color.b,
-                            q_2dObjects[i].color.g, q_2dObjects[i].color.a});
-        glBindBuffer(GL_UNIFORM_BUFFER, UBO2D);
-        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(UniformData2D),
-                        &UBO2D_Data);
-        glUniformBlockBinding(q_2dDraw.programHandle,
-                              q_2dDraw.uniformBlockIndex, 2);
-
-        if (q_2dObjects[i].texture != nullptr) {
-            glUniform1i(texturedID_2d, GL_TRUE);
-            q_2dObjects[i].texture->BindTexture();
-            glUniform1i(textureID_2d, 0);
-        } else {
-            glUniform1i(texturedID_2d, GL_FALSE);
+    batch.colorCommands = batch.commands.size();
+    if (settings.depthTest && settings.depthPrepass) {
+        //the pre-pass has no state to group by, so it draws strictly front
+        //to back. Its commands follow the color pass commands and only
+        //merge neighbours that are also neighbours in the instance data
+        depthKeys.resize(sortKeys.size());
+        for (size_t i = 0; i < sortKeys.size(); i++) {
+            depthKeys[i] = {sortKeys[i].key & qrk::Q_KEY_DEPTH_MAX,
+                            static_cast<uint32_t>(i)};
+        }
+        qrk::RadixSort(depthKeys, sortScratch);
+        for (const qrk::SortKey &key : depthKeys) {
+            DrawArraysIndirectCommand mesh =
+                    batch.commands[batch.instanceCommands[key.index]];
+            DrawArraysIndirectCommand &last = batch.commands.back();
+            if (batch.commands.size() > batch.colorCommands &&
+                last.first == mesh.first && last.count == mesh.count &&
+                last.baseInstance + last.instanceCount == key.index) {
+                last.instanceCount++;
+            } else {
+                batch.commands.push_back(
+                        {mesh.count, 1, mesh.first, key.index});
+            }
         }
+    }
 
-        glBindVertexArray(q_2dObjects[i].VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, q_2dObjects[i].VBO);
+    jobs.ParallelFor(sortKeys.size(), 512, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const DrawData_3D &object = queue[sortKeys[i].index];
+            InstanceData3D &instance = batch.instances[i];
+            instance.model = object.model;
+            instance.color = qrk::vec4f({object.color.r, object.color.g,
+                                         object.color.b, object.color.a});
+        }
+    });
+}
 
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat),
-                              (void *) 0);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat),
-                              (void *) (2 * sizeof(GLfloat)));
+void qrk::qb_GL_Renderer::Upload3dBatch(Batch3D &batch) {
+    GLsizeiptr instanceBytes = batch.instances.size() * sizeof(InstanceData3D);
+    GLsizeiptr materialBytes = batch.materials.size() * sizeof(Material);
+    GLsizeiptr commandBytes =
+            batch.commands.size() * sizeof(DrawArraysIndirectCommand);
+    if (settings.persistentMapping) {
+        //a write can land in an overflow buffer, the handle is only known
+        //after it
+        batch.instanceOffset = uniformRing.Write(
+                batch.instances.data(), instanceBytes, storageAlignment);
+        batch.instanceBuffer = uniformRing.GetHandle();
+        batch.materialOffset = uniformRing.Write(
+                batch.materials.data(), materialBytes, storageAlignment);
+        batch.materialBuffer = uniformRing.GetHandle();
+        batch.commandOffset = uniformRing.Write(batch.commands.data(),
+                                                commandBytes, sizeof(GLuint));
+        batch.commandBuffer = uniformRing.GetHandle();
+    } else {
+        glNamedBufferData(instance_SSBO, instanceBytes, batch.instances.data(),
+                          GL_STREAM_DRAW);
+        glNamedBufferData(material_SSBO, materialBytes, batch.materials.data(),
+                          GL_STREAM_DRAW);
+        glNamedBufferData(indirectBuffer, commandBytes, batch.commands.data(),
+                          GL_STREAM_DRAW);
+        batch.instanceBuffer = instance_SSBO;
+        batch.materialBuffer = material_SSBO;
+        batch.commandBuffer = indirectBuffer;
+        batch.instanceOffset = 0;
+        batch.materialOffset = 0;
+        batch.commandOffset = 0;
+    }
+}
 
-        glEnableVertexAttribArray(0);
-        glEnableVertexAttribArray(1);
-        glDrawArrays(GL_TRIANGLES, 0, q_2dObjects[i].vertexCount);
-        glDisableVertexAttribArray(0);
-        glDisableVertexAttribArray(1);
+void qrk::qb_GL_Renderer::UpdateRetainedBatch() {
+    Batch3D &batch = retainedBatch;
+    //a change that keeps the draw in its command and texture run only
+    //rewrites its instance. Moved draws are not sorted again, the pre-pass
+    //order goes stale until the next sort but the image stays the same
+    retainedUploads.clear();
+    for (size_t i = 0; i < retainedChanges.size() && retainedSorted; i++) {
+        const DrawData_3D &object = retained3dDraws[retainedChanges[i]];
+        uint32_t position = batch.positions[retainedChanges[i]];
+        const DrawArraysIndirectCommand &command =
+                batch.commands[batch.instanceCommands[position]];
+        GLuint material = FindMaterial(batch, object.material, false);
+        uint64_t state = Create3dSortKey(object) ^ batch.keys[position];
+        if ((state & ~qrk::Q_KEY_DEPTH_MAX) != 0 ||
+            command.count != static_cast<GLuint>(object.vertexCount) ||
+            static_cast<GLint>(command.first) !=
+                    meshPool.Register(object.mesh, object.VBO,
+                                      object.vertexCount) ||
+            material == noMaterial) {
+            retainedSorted = false;
+            break;
+        }
+        InstanceData3D &instance = batch.instances[position];
+        instance.model = object.model;
+        instance.color = qrk::vec4f({object.color.r, object.color.g,
+                                     object.color.b, object.color.a});
+        instance.material = material;
+        retainedUploads.push_back(position);
     }
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    retainedChanges.clear();
 
-    //UI draw
-    glClear(GL_DEPTH_BUFFER_BIT);
-    for (int i = 0; i < q_UIObjects.size(); i++) {
-        UBO2D_Data.position = qrk::vec2f(
-                {(q_UIObjects[i].position.x() - ((float) screenSize.x() / 2)) /
-                         ((float) screenSize.x() / 2),
-                 -(q_UIObjects[i].position.y() - ((float) screenSize.y()) / 2) /
-                         ((float) screenSize.y() / 2)});
-        UBO2D_Data.size =
-                qrk::vec2f({q_UIObjects[i].size.x() / (float) screenSize.x(),
-                            q_UIObjects[i].size.y() / (float) screenSize.y()});
-        qrk::mat4 rotMatrix =
-                qrk::CreateRotationMatrix(q_UIObjects[i].rotation, 0.f, 0.f);
-        UBO2D_Data.rotation = rotMatrix;
-        UBO2D_Data.zLayer = q_UIObjects[i].zLayer;
-        UBO2D_Data.color =
-                qrk::vec4f({q_UIObjects[i].color.r, q_UIObjects[i].color.b,
-                            q_UIObjects[i].color.g, q_UIObjects[i].color.a});
-        glBindBuffer(GL_UNIFORM_BUFFER, UBO2D);
-        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(UniformData2D),
-                        &UBO2D_Data);
-        glUniformBlockBinding(q_2dDraw.programHandle,
-                              q_2dDraw.uniformBlockIndex, 2);
-
-        if (q_UIObjects[i].texture != nullptr) {
-            glUniform1i(texturedID_2d, GL_TRUE);
-            q_UIObjects[i].texture->BindTexture();
-            glUniform1i(textureID_2d, 0);
-        } else {
-            glUniform1i(texturedID_2d, GL_FALSE);
+    if (!retainedSorted) {
+        //the batch is resident, it is only uploaded whole after sorting
+        Build3dBatch(retained3dDraws, batch);
+        batch.instanceBuffer = retainedInstanceBuffer;
+        batch.materialBuffer = retainedMaterialBuffer;
+        batch.commandBuffer = retainedCommandBuffer;
+        retainedSorted = true;
+        if (batch.instances.empty()) { return; }
+        glNamedBufferData(retainedInstanceBuffer,
+                          batch.instances.size() * sizeof(InstanceData3D),
+                          batch.instances.data(), GL_DYNAMIC_DRAW);
+        glNamedBufferData(retainedMaterialBuffer,
+                          batch.materials.size() * sizeof(Material),
+                          batch.materials.data(), GL_DYNAMIC_DRAW);
+        glNamedBufferData(retainedCommandBuffer,
+                          batch.commands.size() *
+                                  sizeof(DrawArraysIndirectCommand),
+                          batch.commands.data(), GL_DYNAMIC_DRAW);
+        return;
+    }
+    //changed instances close to each other are sent in one range
+    std::sort(retainedUploads.begin(), retainedUploads.end());
+    auto run = retainedUploads.begin();
+    while (run != retainedUploads.end()) {
+        uint32_t first = *run;
+        uint32_t last = first;
+        for (run++; run != retainedUploads.end() && *run - last <= 4; run++) {
+            last = *run;
         }
+        glNamedBufferSubData(retainedInstanceBuffer,
+                             first * sizeof(InstanceData3D),
+                             (last - first + 1) * sizeof(InstanceData3D),
+                             &batch.instances[first]);
+    }
+}
 
-        glBindVertexArray(q_UIObjects[i].VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, q_UIObjects[i].VBO);
+void qrk::qb_GL_Renderer::Bind3dBatch(const Batch3D &batch) const {
+    qrk::glState.BindBufferRange(
+            GL_SHADER_STORAGE_BUFFER, 5, batch.instanceBuffer,
+            batch.instanceOffset,
+            batch.instances.size() * sizeof(InstanceData3D));
+    qrk::glState.BindBufferRange(GL_SHADER_STORAGE_BUFFER, 6,
+                                 batch.materialBuffer, batch.materialOffset,
+                                 batch.materials.size() * sizeof(Material));
+    qrk::glState.BindBuffer(GL_DRAW_INDIRECT_BUFFER, batch.commandBuffer);
+}
 
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat),
-                              (void *) 0);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat),
-                              (void *) (2 * sizeof(GLfloat)));
+void qrk::qb_GL_Renderer::Draw3dQueue() {
+    Build3dBatch(q_3dObjects, frameBatch);
+    if (!frameBatch.instances.empty()) { Upload3dBatch(frameBatch); }
+    UpdateRetainedBatch();
+    //retained draws first, then the ones queued for this frame
+    const Batch3D *batches[] = {&retainedBatch, &frameBatch};
+    if (retainedBatch.instances.empty() && frameBatch.instances.empty()) {
+        return;
+    }
 
-        glEnableVertexAttribArray(0);
-        glEnableVertexAttribArray(1);
-        glDrawArrays(GL_TRIANGLES, 0, q_UIObjects[i].vertexCount);
-        glDisableVertexAttribArray(0);
-        glDisableVertexAttribArray(1);
+    bool depthPrepass = settings.depthTest && settings.depthPrepass;
+    UploadUniformBlock(3, UBO3D, UBO3D_Data);
+    if (depthPrepass) {
+        profiler.EndPass(qrk::Q_PASS_OPAQUE);
+        profiler.BeginPass(qrk::Q_PASS_DEPTH);
+        qrk::assets::Program &depthDraw =
+                q_3dDraw.Get(Q_FEATURE_POSITION_ONLY);
+        depthDraw.UseProgram();
+        qrk::glState.UniformBlockBinding(depthDraw.programHandle,
+                                         depthDraw.uniformBlockIndex, 3);
+        qrk::glState.ColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        qrk::glState.BindVertexArray(meshPool.GetPositionVAO());
+        for (const Batch3D *batch : batches) {
+            if (batch->instances.empty()) { continue; }
+            Bind3dBatch(*batch);
+            glMultiDrawArraysIndirect(
+                    GL_TRIANGLES,
+                    reinterpret_cast<const void *>(
+                            batch->commandOffset +
+                            batch->colorCommands *
+                                    sizeof(DrawArraysIndirectCommand)),
+                    static_cast<GLsizei>(batch->commands.size() -
+                                         batch->colorCommands),
+                    0);
+        }
+        qrk::glState.ColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        //only the fragments that won the pre-pass are shaded
+        qrk::glState.DepthFunc(GL_EQUAL);
+        qrk::glState.DepthMask(GL_FALSE);
+        profiler.EndPass(qrk::Q_PASS_DEPTH);
+        profiler.BeginPass(qrk::Q_PASS_OPAQUE);
     }
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    //the clusters are empty without point lights, those frames are unlit
+    uint32_t lighting = clusteredLights.empty() ? 0 : Q_FEATURE_LIGHTS;
+    qrk::glState.BindVertexArray(meshPool.GetVAO());
+
+    for (const Batch3D *batch : batches) {
+        if (batch->instances.empty()) { continue; }
+        Bind3dBatch(*batch);
+        for (size_t run = 0; run < batch->textureRuns.size(); run++) {
+            size_t first = batch->textureRuns[run];
+            size_t end = run + 1 < batch->textureRuns.size()
+                                 ? batch->textureRuns[run + 1]
+                                 : batch->colorCommands;
+            qrk::Texture2D *texture = batch->runTextures[run];
+            uint32_t features = lighting;
+            if (texture != nullptr) { features |= Q_FEATURE_TEXTURED; }
+            qrk::assets::Program &program = q_3dDraw.Get(features);
+            program.UseProgram();
+            qrk::glState.UniformBlockBinding(program.programHandle,
+                                             program.uniformBlockIndex, 3);
+            if (texture != nullptr) { texture->BindTexture(); }
+
+            glMultiDrawArraysIndirect(
+                    GL_TRIANGLES,
+                    reinterpret_cast<const void *>(
+                            batch->commandOffset +
+                            first * sizeof(DrawArraysIndirectCommand)),
+                    static_cast<GLsizei>(end - first), 0);
+        }
+    }
+    if (depthPrepass) {
+        qrk::glState.DepthFunc(GL_LESS);
+        qrk::glState.DepthMask(GL_TRUE);
+    }
+}
+
+void qrk::qb_GL_Renderer::Draw(qrk::vec2u screenSize) {
+    if (!targetWindow->IsOpen()) { return; }
+    if (!targetWindow->IsContextCurrent()) {
+        targetWindow->MakeContextCurrent();
+    }
+    profiler.BeginFrame();
+    MergeDrawLists();
+    uniformRing.BeginFrame(EstimateFrameUpload());
+    //meshes deleted since the last frame leave their range to new ones
+    meshPool.CollectReleased();
+    //3d draw
+    profiler.BeginPass(qrk::Q_PASS_OPAQUE);
+
+    float aspect = (float) screenSize.x() / (float) screenSize.y();
+    qrk::mat4 projectionMatrix = qrk::CreatePerspectiveProjectionMatrix(
+            70.f, aspect, nearPlane, farPlane);
+    UBO3D_Data.projection = projectionMatrix;
+    if (clustersDirty || aspect != clusterAspect) {
+        lightClusters.Build(clusteredLights, projectionMatrix, nearPlane,
+                            farPlane);
+        qrk::vec2f depthMapping = lightClusters.GetDepthMapping();
+        UBO3D_Data.clusterDepth =
+                qrk::vec4f({depthMapping.x(), depthMapping.y(), 0, 0});
+        clustersDirty = false;
+        clusterAspect = aspect;
+    }
+    qrk::mat4 identity = qrk::identity4();
+    UBO3D_Data.view = identity; //temporary hack. The view matrix comes from the camera, don't write some stupidass function in the renderer, okay?
+
+    Draw3dQueue();
+    profiler.EndPass(qrk::Q_PASS_OPAQUE);
+
+    //2d draw
+    profiler.BeginPass(qrk::Q_PASS_2D);
+    Draw2dQueue(q_2dObjects, qrk::Q_PASS_2D, screenSize);
+    profiler.EndPass(qrk::Q_PASS_2D);
+
+    //UI draw
+    profiler.BeginPass(qrk::Q_PASS_UI);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    Draw2dQueue(q_UIObjects, qrk::Q_PASS_UI, screenSize);
+    profiler.EndPass(qrk::Q_PASS_UI);
 
     //text drawing
+    profiler.BeginPass(qrk::Q_PASS_TEXT);
     q_textDraw.UseProgram();
     float screenSizeX = static_cast<float>(screenSize.x());
     float screenSizeY = static_cast<float>(screenSize.y());
     UBO_Text_data.screenSize = qrk::vec2f({screenSizeX, screenSizeY});
-    for (int i = 0; i < q_Text.size(); i++) {
-        UBO_Text_data.zLayer = q_Text[i].zLayer;
-        UBO_Text_data.color =
-                qrk::vec4f({q_Text[i].color.r, q_Text[i].color.b,
-                            q_Text[i].color.g, q_Text[i].color.a});
-        glBindBuffer(GL_UNIFORM_BUFFER, UBO_Text);
-        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(UniformDataText),
-                        &UBO_Text_data);
-        glUniformBlockBinding(q_textDraw.programHandle,
-                              q_textDraw.uniformBlockIndex, 1);
-        glBindBuffer(GL_UNIFORM_BUFFER, UBO2D);
-        q_Text[i].texture->BindTexture();
-        glUniform1i(textureID_Text, 0);
-
-        glBindVertexArray(q_Text[i].VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, q_Text[i].VBO);
-
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat),
-                              (void *) 0);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat),
-                              (void *) (2 * sizeof(GLfloat)));
-
-        glEnableVertexAttribArray(0);
-        glEnableVertexAttribArray(1);
-        glDrawArrays(GL_TRIANGLES, 0, q_Text[i].vertexCount);
-        glDisableVertexAttribArray(0);
-        glDisableVertexAttribArray(1);
+    SortLayeredQueue(q_Text, qrk::Q_PASS_TEXT);
+    for (const qrk::SortKey &sortKey : sortKeys) {
+        DrawData_Text &text = q_Text[sortKey.index];
+        UBO_Text_data.zLayer = text.zLayer;
+        UBO_Text_data.color = qrk::vec4f(
+                {text.color.r, text.color.b, text.color.g, text.color.a});
+        UploadUniformBlock(1, UBO_Text, UBO_Text_data);
+        qrk::glState.UniformBlockBinding(q_textDraw.programHandle,
+                                         q_textDraw.uniformBlockIndex, 1);
+        text.texture->BindTexture();
+
+        //text meshes are built on the recording thread, uploaded here
+        if (text.vertices != nullptr) {
+            glNamedBufferData(text.VBO,
+                              text.vertexCount * 4 * sizeof(GLfloat),
+                              text.vertices, GL_STATIC_DRAW);
+        }
+        qrk::glState.BindVertexArray(text.VAO);
+        glDrawArrays(GL_TRIANGLES, 0, text.vertexCount);
     }
+    profiler.EndPass(qrk::Q_PASS_TEXT);
 
     //clean up
+    uniformRing.EndFrame();
+    frameArenas[drawingArena].Reset();
     q_3dObjects.clear();
     q_2dObjects.clear();
     q_UIObjects.clear();
     q_Text.clear();
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    qrk::glState.BindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    qrk::glState.BindBuffer(GL_UNIFORM_BUFFER, 0);
+    qrk::glState.BindVertexArray(0);
+    qrk::glState.BindBuffer(GL_ARRAY_BUFFER, 0);
     qrk::UnbindProgram();
+    qrk::glState.EndFrame();
+    profiler.EndFrame();
+}
+
+void qrk::qb_GL_Renderer::Draw2dQueue(std::vector<DrawData_2D> &queue,
+                                      qrk::DrawPass pass,
+                                      qrk::vec2u screenSize) {
+    SortLayeredQueue(queue, pass);
+    qrk::vec2f size({static_cast<float>(screenSize.x()),
+                     static_cast<float>(screenSize.y())});
+    spriteBatch.Draw(queue, sortKeys, q_2dDraw, size, jobs,
+                     settings.persistentMapping ? &uniformRing : nullptr);
 }
\ No newline at end of file
@@ -0,0 +1,33 @@
+#include "../include/draw_sort.hpp"
+
+void qrk::RadixSort(std::vector<SortKey> &keys,
+                    std::vector<SortKey> &scratch) {
+    if (keys.size() < 2) { return; }
+    scratch.resize(keys.size());
+
+    SortKey *source = keys.data();
+    SortKey *destination = scratch.data();
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t histogram[256] = {};
+        for (size_t i = 0; i < keys.size(); i++) {
+            histogram[(source[i].key >> shift) & 0xFF]++;
+        }
+        //every key has the same digit, nothing to reorder
+        if (histogram[(source[0].key >> shift) & 0xFF] == keys.size()) {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (size_t &bucket : histogram) {
+            size_t count = bucket;
+            bucket = offset;
+            offset += count;
+        }
+        for (size_t i = 0; i < keys.size(); i++) {
+            destination[histogram[(source[i].key >> shift) & 0xFF]++] =
+                    source[i];
+        }
+        std::swap(source, destination);
+    }
+    if (source != keys.data()) { keys.swap(scratch); }
+}
@@ -0,0 +1,296 @@
+#include "../include/dynamic_bvh.hpp"
+#include <cfloat>
+#include <cmath>
+
+qrk::AABB qrk::TransformAABB(const AABB &box, const qrk::mat4 &model) {
+    //transform the center and project the extents onto the new axes
+    AABB result;
+    for (int i = 0; i < 3; i++) {
+        float center = model.data[i][3];
+        float extent = 0.f;
+        for (int j = 0; j < 3; j++) {
+            float boxCenter = (box.min[j] + box.max[j]) * 0.5f;
+            float boxExtent = (box.max[j] - box.min[j]) * 0.5f;
+            center += model.data[i][j] * boxCenter;
+            extent += std::abs(model.data[i][j]) * boxExtent;
+        }
+        result.min[i] = center - extent;
+        result.max[i] = center + extent;
+    }
+    return result;
+}
+
+bool qrk::IntersectRay(const AABB &box, const float origin[3],
+                       const float inverseDirection[3], float maxDistance,
+                       float &distance) {
+    float enter = 0.f;
+    float exit = maxDistance;
+    for (int i = 0; i < 3; i++) {
+        float near = (box.min[i] - origin[i]) * inverseDirection[i];
+        float far = (box.max[i] - origin[i]) * inverseDirection[i];
+        if (near > far) { std::swap(near, far); }
+        //a ray parallel to the slab gives nan when it starts on its border
+        if (!(near <= far)) { continue; }
+        enter = std::max(enter, near);
+        exit = std::min(exit, far);
+        if (enter > exit) { return false; }
+    }
+    distance = enter;
+    return true;
+}
+
+qrk::Frustum qrk::CreateFrustum(const qrk::mat4 &viewProjection) {
+    //left, right, bottom, top, near and far from the rows of the matrix
+    const auto &m = viewProjection.data;
+    Frustum frustum;
+    for (int axis = 0; axis < 3; axis++) {
+        for (int j = 0; j < 4; j++) {
+            frustum.planes[axis * 2][j] = m[3][j] + m[axis][j];
+            frustum.planes[axis * 2 + 1][j] = m[3][j] - m[axis][j];
+        }
+    }
+    return frustum;
+}
+
+qrk::FrustumTest qrk::TestFrustum(const Frustum &frustum, const AABB &box) {
+    FrustumTest result = Q_INSIDE;
+    for (const float *plane : frustum.planes) {
+        //corners furthest along and against the plane normal
+        float inner = plane[3];
+        float outer = plane[3];
+        for (int i = 0; i < 3; i++) {
+            bool positive = plane[i] >= 0.f;
+            inner += plane[i] * (positive ? box.max[i] : box.min[i]);
+            outer += plane[i] * (positive ? box.min[i] : box.max[i]);
+        }
+        if (inner < 0.f) { return Q_OUTSIDE; }
+        if (outer < 0.f) { result = Q_INTERSECTING; }
+    }
+    return result;
+}
+
+uint32_t qrk::DynamicBVH::Insert(const AABB &box, uint64_t userData) {
+    uint32_t leaf = AllocateNode();
+    Node &node = nodes[leaf];
+    for (int i = 0; i < 3; i++) {
+        node.box.min[i] = box.min[i] - margin;
+        node.box.max[i] = box.max[i] + margin;
+    }
+    node.userData = userData;
+    node.height = 0;
+    InsertLeaf(leaf);
+    proxyCount++;
+    return leaf;
+}
+
+void qrk::DynamicBVH::Remove(uint32_t proxy) {
+    RemoveLeaf(proxy);
+    FreeNode(proxy);
+    proxyCount--;
+}
+
+bool qrk::DynamicBVH::Move(uint32_t proxy, const AABB &box) {
+    if (Contains(nodes[proxy].box, box)) { return false; }
+    RemoveLeaf(proxy);
+    Node &node = nodes[proxy];
+    for (int i = 0; i < 3; i++) {
+        node.box.min[i] = box.min[i] - margin;
+        node.box.max[i] = box.max[i] + margin;
+    }
+    InsertLeaf(proxy);
+    return true;
+}
+
+float qrk::DynamicBVH::GetAreaRatio() const {
+    if (root == nullNode) { return 0.f; }
+    float rootArea = SurfaceArea(nodes[root].box);
+    if (rootArea == 0.f) { return 0.f; }
+    float totalArea = 0.f;
+    for (const Node &node : nodes) {
+        if (node.height > 0) { totalArea += SurfaceArea(node.box); }
+    }
+    return totalArea / rootArea;
+}
+
+uint32_t qrk::DynamicBVH::AllocateNode() {
+    if (freeList == nullNode) {
+        nodes.emplace_back();
+        return static_cast<uint32_t>(nodes.size() - 1);
+    }
+    uint32_t index = freeList;
+    freeList = nodes[index].parent;
+    nodes[index] = Node();
+    return index;
+}
+
+void qrk::DynamicBVH::FreeNode(uint32_t index) {
+    nodes[index].parent = freeList;
+    nodes[index].height = -1;
+    freeList = index;
+}
+
+void qrk::DynamicBVH::InsertLeaf(uint32_t leaf) {
+    if (root == nullNode) {
+        root = leaf;
+        nodes[leaf].parent = nullNode;
+        return;
+    }
+    uint32_t sibling = FindBestSibling(nodes[leaf].box);
+
+    //the new parent takes the place of the sibling
+    uint32_t newParent = AllocateNode();
+    uint32_t oldParent = nodes[sibling].parent;
+    Node &parent = nodes[newParent];
+    parent.parent = oldParent;
+    parent.box = Union(nodes[leaf].box, nodes[sibling].box);
+    parent.height = nodes[sibling].height + 1;
+    parent.child1 = sibling;
+    parent.child2 = leaf;
+    if (oldParent == nullNode) {
+        root = newParent;
+    } else if (nodes[oldParent].child1 == sibling) {
+        nodes[oldParent].child1 = newParent;
+    } else {
+        nodes[oldParent].child2 = newParent;
+    }
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+    Refit(newParent, true);
+}
+
+void qrk::DynamicBVH::RemoveLeaf(uint32_t leaf) {
+    if (leaf == root) {
+        root = nullNode;
+        return;
+    }
+    uint32_t parent = nodes[leaf].parent;
+    uint32_t grandParent = nodes[parent].parent;
+    uint32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2
+                                                    : nodes[parent].child1;
+    //the sibling takes the place of the parent
+    nodes[sibling].parent = grandParent;
+    if (grandParent == nullNode) {
+        root = sibling;
+    } else if (nodes[grandParent].child1 == parent) {
+        nodes[grandParent].child1 = sibling;
+    } else {
+        nodes[grandParent].child2 = sibling;
+    }
+    FreeNode(parent);
+    Refit(grandParent, false);
+}
+
+uint32_t qrk::DynamicBVH::FindBestSibling(const AABB &box) const {
+    //the cost of a sibling is the area of the new parent plus the area
+    //every ancestor grows by. Descending only pays off while the lower
+    //bound of a subtree beats the best cost found so far
+    float boxArea = SurfaceArea(box);
+    uint32_t index = root;
+    float area = SurfaceArea(nodes[root].box);
+    float directCost = SurfaceArea(Union(nodes[root].box, box));
+    float inheritedCost = 0.f;
+    uint32_t bestSibling = root;
+    float bestCost = directCost;
+    while (!nodes[index].IsLeaf()) {
+        float cost = directCost + inheritedCost;
+        if (cost < bestCost) {
+            bestSibling = index;
+            bestCost = cost;
+        }
+        inheritedCost += directCost - area;
+
+        uint32_t children[2] = {nodes[index].child1, nodes[index].child2};
+        float lowerCosts[2];
+        float childAreas[2] = {0.f, 0.f};
+        float directCosts[2];
+        bool leaves[2];
+        for (int i = 0; i < 2; i++) {
+            const Node &child = nodes[children[i]];
+            directCosts[i] = SurfaceArea(Union(child.box, box));
+            leaves[i] = child.IsLeaf();
+            lowerCosts[i] = FLT_MAX;
+            if (leaves[i]) {
+                float childCost = directCosts[i] + inheritedCost;
+                if (childCost < bestCost) {
+                    bestSibling = children[i];
+                    bestCost = childCost;
+                }
+            } else {
+                childAreas[i] = SurfaceArea(child.box);
+                lowerCosts[i] = inheritedCost + directCosts[i] +
+                                std::min(boxArea - childAreas[i], 0.f);
+            }
+        }
+        if (leaves[0] && leaves[1]) { break; }
+        if (bestCost <= lowerCosts[0] && bestCost <= lowerCosts[1]) { break; }
+        int next = lowerCosts[0] < lowerCosts[1] && !leaves[0] ? 0 : 1;
+        if (leaves[next]) { next = 1 - next; }
+        index = children[next];
+        area = childAreas[next];
+        directCost = directCosts[next];
+    }
+    return bestSibling;
+}
+
+void qrk::DynamicBVH::Rotate(uint32_t index) {
+    //swap a child with a grandchild on the other side when the node that
+    //takes the child shrinks. Only the area of that node changes
+    Node &node = nodes[index];
+    if (node.height < 2) { return; }
+    uint32_t b = node.child1;
+    uint32_t c = node.child2;
+    float bestCost = 0.f;
+    uint32_t swapChild = nullNode;
+    uint32_t swapGrandchild = nullNode;
+    for (int side = 0; side < 2; side++) {
+        uint32_t child = side == 0 ? b : c;
+        uint32_t other = side == 0 ? c : b;
+        if (nodes[other].IsLeaf()) { continue; }
+        float otherArea = SurfaceArea(nodes[other].box);
+        uint32_t grandchildren[2] = {nodes[other].child1, nodes[other].child2};
+        for (int i = 0; i < 2; i++) {
+            //other keeps the grandchild that is not swapped
+            const AABB &kept = nodes[grandchildren[1 - i]].box;
+            float cost = SurfaceArea(Union(nodes[child].box, kept)) -
+                         otherArea;
+            if (cost < bestCost) {
+                bestCost = cost;
+                swapChild = child;
+                swapGrandchild = grandchildren[i];
+            }
+        }
+    }
+    if (swapChild == nullNode) { return; }
+
+    uint32_t other = nodes[swapGrandchild].parent;
+    if (node.child1 == swapChild) {
+        node.child1 = swapGrandchild;
+    } else {
+        node.child2 = swapGrandchild;
+    }
+    Node &otherNode = nodes[other];
+    if (otherNode.child1 == swapGrandchild) {
+        otherNode.child1 = swapChild;
+    } else {
+        otherNode.child2 = swapChild;
+    }
+    nodes[swapChild].parent = other;
+    nodes[swapGrandchild].parent = index;
+    otherNode.box = Union(nodes[otherNode.child1].box,
+                          nodes[otherNode.child2].box);
+    otherNode.height = 1 + std::max(nodes[otherNode.child1].height,
+                                    nodes[otherNode.child2].height);
+    node.height = 1 + std::max(nodes[node.child1].height,
+                               nodes[node.child2].height);
+}
+
+void qrk::DynamicBVH::Refit(uint32_t index, bool rotate) {
+    while (index != nullNode) {
+        Node &node = nodes[index];
+        node.box = Union(nodes[node.child1].box, nodes[node.child2].box);
+        node.height = 1 + std::max(nodes[node.child1].height,
+                                   nodes[node.child2].height);
+        if (rotate) { Rotate(index); }
+        index = nodes[index].parent;
+    }
+}
@@ -0,0 +1,53 @@
+#include "../include/frame_arena.hpp"
+#include <algorithm>
+#include <cstdint>
+
+qrk::FrameArena::FrameArena(size_t initialSize)
+    : block(new std::byte[std::max<size_t>(initialSize, 1)]),
+      capacity(std::max<size_t>(initialSize, 1)), offset(0),
+      heapAllocations(1) {}
+
+void *qrk::FrameArena::do_allocate(size_t bytes, size_t alignment) {
+    //reserving the worst case padding keeps the bump one atomic add
+    size_t reserved = bytes + alignment - 1;
+    size_t start = offset.fetch_add(reserved, std::memory_order_relaxed);
+    if (start + reserved <= capacity) {
+        uintptr_t address = reinterpret_cast<uintptr_t>(block.get()) + start;
+        address = (address + alignment - 1) & ~(uintptr_t(alignment) - 1);
+        return reinterpret_cast<void *>(address);
+    }
+
+    void *memory = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    std::lock_guard<std::mutex> lock(overflowMutex);
+    overflow.push_back({memory, bytes, alignment});
+    overflowBytes += reserved;
+    heapAllocations++;
+    return memory;
+}
+
+size_t qrk::FrameArena::GetUsed() const {
+    return std::min(offset.load(std::memory_order_relaxed), capacity) +
+           overflowBytes;
+}
+
+void qrk::FrameArena::Reset() {
+    size_t used = GetUsed();
+    if (used > highWaterMark.load()) { highWaterMark.store(used); }
+    if (!overflow.empty()) {
+        ReleaseOverflow();
+        //one block for the whole frame, with room for it to grow a bit
+        capacity = std::max(capacity * 2, used + used / 2);
+        block.reset(new std::byte[capacity]);
+        heapAllocations++;
+    }
+    offset.store(0, std::memory_order_relaxed);
+}
+
+void qrk::FrameArena::ReleaseOverflow() {
+    for (const Overflow &memory : overflow) {
+        std::pmr::new_delete_resource()->deallocate(
+                memory.memory, memory.bytes, memory.alignment);
+    }
+    overflow.clear();
+    overflowBytes = 0;
+}
@@ -0,0 +1,291 @@
+#include "../include/gl_state.hpp"
+#include <cstring>
+
+const char *qrk::StateKindName(GLStateKind kind) {
+    switch (kind) {
+        case Q_STATE_PROGRAM:
+            return "program";
+        case Q_STATE_VERTEX_ARRAY:
+            return "vertex array";
+        case Q_STATE_BUFFER:
+            return "buffer";
+        case Q_STATE_TEXTURE:
+            return "texture";
+        case Q_STATE_UNIFORM_BLOCK:
+            return "uniform block";
+        case Q_STATE_UNIFORM:
+            return "uniform";
+        case Q_STATE_FIXED_FUNCTION:
+            return "fixed function";
+    }
+    return "unknown";
+}
+
+uint64_t qrk::GLStateStats::TotalIssued() const {
+    uint64_t total = 0;
+    for (uint64_t count : issued) { total += count; }
+    return total;
+}
+
+uint64_t qrk::GLStateStats::TotalElided() const {
+    uint64_t total = 0;
+    for (uint64_t count : elided) { total += count; }
+    return total;
+}
+
+int qrk::GLStateCache::BufferSlot(GLenum target) {
+    //the element array binding belongs to the vertex array, it is not
+    //cached
+    switch (target) {
+        case GL_ARRAY_BUFFER:
+            return 0;
+        case GL_COPY_READ_BUFFER:
+            return 1;
+        case GL_COPY_WRITE_BUFFER:
+            return 2;
+        case GL_DRAW_INDIRECT_BUFFER:
+            return 3;
+        case GL_DISPATCH_INDIRECT_BUFFER:
+            return 4;
+        case GL_PIXEL_PACK_BUFFER:
+            return 5;
+        case GL_PIXEL_UNPACK_BUFFER:
+            return 6;
+        case GL_UNIFORM_BUFFER:
+            return 7;
+        case GL_SHADER_STORAGE_BUFFER:
+            return 8;
+        default:
+            return -1;
+    }
+}
+
+void qrk::GLStateCache::UseProgram(GLuint _program) {
+    if (!Changed(Q_STATE_PROGRAM, program != _program)) { return; }
+    glUseProgram(_program);
+    program = _program;
+}
+
+void qrk::GLStateCache::BindVertexArray(GLuint _vertexArray) {
+    if (!Changed(Q_STATE_VERTEX_ARRAY, vertexArray != _vertexArray)) {
+        return;
+    }
+    glBindVertexArray(_vertexArray);
+    vertexArray = _vertexArray;
+}
+
+void qrk::GLStateCache::BindBuffer(GLenum target, GLuint buffer) {
+    int slot = BufferSlot(target);
+    bool changed = slot < 0 || buffers[slot] != buffer;
+    if (!Changed(Q_STATE_BUFFER, changed)) { return; }
+    glBindBuffer(target, buffer);
+    if (slot >= 0) { buffers[slot] = buffer; }
+}
+
+void qrk::GLStateCache::BindBufferBase(GLenum target, GLuint index,
+                                       GLuint buffer) {
+    SetIndexed(target, index, {buffer, 0, -1});
+}
+
+void qrk::GLStateCache::BindBufferRange(GLenum target, GLuint index,
+                                        GLuint buffer, GLintptr offset,
+                                        GLsizeiptr size) {
+    SetIndexed(target, index, {buffer, offset, size});
+}
+
+void qrk::GLStateCache::SetIndexed(GLenum target, GLuint index,
+                                   IndexedBinding binding) {
+    //binding an index binds the generic target as well, so both have to
+    //match for the call to be redundant
+    int set = target == GL_UNIFORM_BUFFER          ? 0
+              : target == GL_SHADER_STORAGE_BUFFER ? 1
+                                                   : -1;
+    bool cached = set >= 0 && index < indexedBindingCount;
+    int slot = BufferSlot(target);
+    bool changed = !cached || slot < 0 || buffers[slot] != binding.buffer;
+    if (cached) {
+        const IndexedBinding &current = indexedBuffers[set][index];
+        changed = changed || current.buffer != binding.buffer ||
+                  current.offset != binding.offset ||
+                  current.size != binding.size;
+    }
+    if (!Changed(Q_STATE_BUFFER, changed)) { return; }
+    if (binding.size < 0) {
+        glBindBufferBase(target, index, binding.buffer);
+    } else {
+        glBindBufferRange(target, index, binding.buffer, binding.offset,
+                          binding.size);
+    }
+    if (cached) { indexedBuffers[set][index] = binding; }
+    if (slot >= 0) { buffers[slot] = binding.buffer; }
+}
+
+void qrk::GLStateCache::ActiveTexture(GLenum unit) {
+    if (!Changed(Q_STATE_TEXTURE, activeUnit != unit)) { return; }
+    glActiveTexture(unit);
+    activeUnit = unit;
+}
+
+void qrk::GLStateCache::BindTexture(GLenum target, GLuint texture) {
+    //only 2d textures are cached, the engine binds no other kind
+    GLuint unit = activeUnit - GL_TEXTURE0;
+    bool cached = target == GL_TEXTURE_2D && activeUnit != unknown &&
+                  unit < textureUnitCount;
+    bool changed = !cached || textures[unit] != texture;
+    if (!Changed(Q_STATE_TEXTURE, changed)) { return; }
+    glBindTexture(target, texture);
+    if (cached) { textures[unit] = texture; }
+}
+
+void qrk::GLStateCache::UniformBlockBinding(GLuint _program,
+                                            GLuint blockIndex,
+                                            GLuint binding) {
+    auto [entry, added] =
+            blockBindings.try_emplace(Key(_program, blockIndex), binding);
+    if (!Changed(Q_STATE_UNIFORM_BLOCK, added || entry->second != binding)) {
+        return;
+    }
+    glUniformBlockBinding(_program, blockIndex, binding);
+    entry->second = binding;
+}
+
+bool qrk::GLStateCache::SetUniform(GLint location, uint64_t value) {
+    //GL ignores location -1, a uniform the compiler removed
+    if (location < 0) { return Changed(Q_STATE_UNIFORM, false); }
+    if (program == unknown || program == 0) {
+        return Changed(Q_STATE_UNIFORM, true);
+    }
+    auto [entry, added] = uniforms.try_emplace(
+            Key(program, static_cast<GLuint>(location)), value);
+    bool changed = added || entry->second != value;
+    entry->second = value;
+    return Changed(Q_STATE_UNIFORM, changed);
+}
+
+void qrk::GLStateCache::Uniform1i(GLint location, GLint value) {
+    if (SetUniform(location, static_cast<uint32_t>(value))) {
+        glUniform1i(location, value);
+    }
+}
+
+void qrk::GLStateCache::Uniform2f(GLint location, GLfloat x, GLfloat y) {
+    //compared by their bits, so -0 and nan are set like any change
+    uint32_t bits[2];
+    std::memcpy(&bits[0], &x, sizeof(float));
+    std::memcpy(&bits[1], &y, sizeof(float));
+    if (SetUniform(location, (uint64_t) bits[0] << 32 | bits[1])) {
+        glUniform2f(location, x, y);
+    }
+}
+
+void qrk::GLStateCache::SetCapability(GLenum capability, bool enabled) {
+    auto [entry, added] = capabilities.try_emplace(capability, enabled);
+    if (!Changed(Q_STATE_FIXED_FUNCTION, added || entry->second != enabled)) {
+        return;
+    }
+    if (enabled) {
+        glEnable(capability);
+    } else {
+        glDisable(capability);
+    }
+    entry->second = enabled;
+}
+
+void qrk::GLStateCache::DepthFunc(GLenum function) {
+    if (!Changed(Q_STATE_FIXED_FUNCTION, depthFunction != function)) {
+        return;
+    }
+    glDepthFunc(function);
+    depthFunction = function;
+}
+
+void qrk::GLStateCache::DepthMask(GLboolean mask) {
+    if (!Changed(Q_STATE_FIXED_FUNCTION, depthMask != mask)) { return; }
+    glDepthMask(mask);
+    depthMask = mask;
+}
+
+void qrk::GLStateCache::ColorMask(GLboolean red, GLboolean green,
+                                  GLboolean blue, GLboolean alpha) {
+    GLuint mask = (red ? 1 : 0) | (green ? 2 : 0) | (blue ? 4 : 0) |
+                  (alpha ? 8 : 0);
+    if (!Changed(Q_STATE_FIXED_FUNCTION, colorMask != mask)) { return; }
+    glColorMask(red, green, blue, alpha);
+    colorMask = mask;
+}
+
+void qrk::GLStateCache::BlendFunc(GLenum source, GLenum destination) {
+    bool changed =
+            blendSource != source || blendDestination != destination;
+    if (!Changed(Q_STATE_FIXED_FUNCTION, changed)) { return; }
+    glBlendFunc(source, destination);
+    blendSource = source;
+    blendDestination = destination;
+}
+
+void qrk::GLStateCache::CullFace(GLenum face) {
+    if (!Changed(Q_STATE_FIXED_FUNCTION, cullFace != face)) { return; }
+    glCullFace(face);
+    cullFace = face;
+}
+
+void qrk::GLStateCache::DeleteBuffers(GLsizei count, const GLuint *names) {
+    glDeleteBuffers(count, names);
+    //GL unbinds deleted buffers, the name can come back for a new one
+    for (GLsizei i = 0; i < count; i++) {
+        if (names[i] == 0) { continue; }
+        for (GLuint &buffer : buffers) {
+            if (buffer == names[i]) { buffer = unknown; }
+        }
+        for (auto &set : indexedBuffers) {
+            for (IndexedBinding &binding : set) {
+                if (binding.buffer == names[i]) { binding.buffer = unknown; }
+            }
+        }
+    }
+}
+
+void qrk::GLStateCache::DeleteTextures(GLsizei count, const GLuint *names) {
+    glDeleteTextures(count, names);
+    for (GLsizei i = 0; i < count; i++) {
+        if (names[i] == 0) { continue; }
+        for (GLuint &texture : textures) {
+            if (texture == names[i]) { texture = unknown; }
+        }
+    }
+}
+
+void qrk::GLStateCache::DeleteVertexArrays(GLsizei count,
+                                           const GLuint *names) {
+    glDeleteVertexArrays(count, names);
+    for (GLsizei i = 0; i < count; i++) {
+        if (names[i] != 0 && vertexArray == names[i]) {
+            vertexArray = unknown;
+        }
+    }
+}
+
+void qrk::GLStateCache::Invalidate() {
+    program = unknown;
+    vertexArray = unknown;
+    for (GLuint &buffer : buffers) { buffer = unknown; }
+    for (auto &set : indexedBuffers) {
+        for (IndexedBinding &binding : set) { binding = {unknown, 0, -1}; }
+    }
+    activeUnit = unknown;
+    for (GLuint &texture : textures) { texture = unknown; }
+    depthFunction = unknown;
+    blendSource = unknown;
+    blendDestination = unknown;
+    cullFace = unknown;
+    depthMask = unknown;
+    colorMask = unknown;
+    capabilities.clear();
+    blockBindings.clear();
+    uniforms.clear();
+}
+
+void qrk::GLStateCache::EndFrame() {
+    lastFrame = recorded;
+    recorded = GLStateStats();
+}
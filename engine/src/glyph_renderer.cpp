@@ -1,5 +1,6 @@
 #include "../include/glyph_renderer.hpp"
 #include "../include/stb_truetype.hpp"
+#include <cstdio>
 
 qrk::Font::Font(std::string path, int fontSize, int bitmapSize, int _firstGlyph,
                 int _glyphCount) {
@@ -11,13 +12,13 @@ qrk::Font::Font(std::string path, int fontSize, int bitmapSize, int _firstGlyph,
         qrk::debug::Error("File does not exist. Path: " + path,
                           qrk::debug::Q_FAILED_TO_FIND_FILE);
     }
-    FILE *f = nullptr;
-    fopen_s(&f, path.c_str(), "rb");
+    FILE *f = std::fopen(path.c_str(), "rb");
     if (f == nullptr) {
         qrk::debug::Error("Failed to open file at: " + path,
                           qrk::debug::Q_FAILED_TO_LOAD_FONT);
     }
-    fread_s(ttfBuffer, 1 << 20, 1, 1 << 20, f);
+    std::fread(ttfBuffer, 1, 1 << 20, f);
+    std::fclose(f);
 
     //read the font into a bitmap
     stbtt_packedchar *charData = new stbtt_packedchar[_glyphCount];
@@ -64,50 +65,28 @@ qrk::Font::Font(std::string path, int fontSize, int bitmapSize, int _firstGlyph,
 }
 
 qrk::DrawData_Text qrk::Text::GetDrawData() {
-    std::vector<GLfloat> vertexArray;
-    float totalShift = 0;
-
-    for (int i = 0; i < text.size(); i++) {
-        qrk::Font::GlyphData *glyph = font->GetGlyphData(text[i]);
-        //vertex 0
-        vertexArray.push_back(glyph->point_1.x() + totalShift + position.x() * 2);
-        vertexArray.push_back(glyph->point_0.y() + font->fontHeight / 2 + position.y() * 2);
-        vertexArray.push_back(glyph->texture_1.x());
-        vertexArray.push_back(glyph->texture_0.y());
-        //vertex 1
-        vertexArray.push_back(glyph->point_0.x() + totalShift + position.x() * 2);
-        vertexArray.push_back(glyph->point_0.y() + font->fontHeight / 2 + position.y() * 2);
-        vertexArray.push_back(glyph->texture_0.x());
-        vertexArray.push_back(glyph->texture_0.y());
-        //vertex 2
-        vertexArray.push_back(glyph->point_0.x() + totalShift + position.x() * 2);
-        vertexArray.push_back(glyph->point_1.y() + font->fontHeight / 2 + position.y() * 2);
-        vertexArray.push_back(glyph->texture_0.x());
-        vertexArray.push_back(glyph->texture_1.y());
-        //vertex 3
-        vertexArray.push_back(glyph->point_0.x() + totalShift + position.x() * 2);
-        vertexArray.push_back(glyph->point_1.y() + font->fontHeight / 2 + position.y() * 2);
-        vertexArray.push_back(glyph->texture_0.x());
-        vertexArray.push_back(glyph->texture_1.y());
-        //vertex 4
-        vertexArray.push_back(glyph->point_1.x() + totalShift + position.x() * 2);
-        vertexArray.push_back(glyph->point_1.y() + font->fontHeight / 2 + position.y() * 2);
-        vertexArray.push_back(glyph->texture_1.x());
-        vertexArray.push_back(glyph->texture_1.y());
-        //vertex 5
-        vertexArray.push_back(glyph->point_1.x() + totalShift + position.x() * 2);
-        vertexArray.push_back(glyph->point_0.y() + font->fontHeight / 2 + position.y() * 2);
-        vertexArray.push_back(glyph->texture_1.x());
-        vertexArray.push_back(glyph->texture_0.y());
+    qrk::DrawData_Text drawData = CreateDrawData();
+    if (!meshDirty) { return drawData; }
+    vertexArray.resize(text.size() * 24);
+    WriteMesh(vertexArray.data());
+    meshDirty = false;
+    drawData.vertices = vertexArray.data();
+    return drawData;
+}
 
-        totalShift += glyph->shift + spacing;
-    }
+qrk::DrawData_Text
+qrk::Text::GetDrawData(std::pmr::memory_resource *frameArena) {
+    qrk::DrawData_Text drawData = CreateDrawData();
+    if (!meshDirty || text.empty()) { return drawData; }
+    GLfloat *vertices = static_cast<GLfloat *>(frameArena->allocate(
+            text.size() * 24 * sizeof(GLfloat), alignof(GLfloat)));
+    WriteMesh(vertices);
+    meshDirty = false;
+    drawData.vertices = vertices;
+    return drawData;
+}
 
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertexArray.size() * sizeof(GLfloat), vertexArray.data(), GL_STATIC_DRAW);
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+qrk::DrawData_Text qrk::Text::CreateDrawData() const {
     qrk::DrawData_Text drawData;
     drawData.VAO = VAO;
     drawData.VBO = VBO;
@@ -116,4 +95,28 @@ qrk::DrawData_Text qrk::Text::GetDrawData() {
     drawData.vertexCount = 6 * text.size();
     drawData.zLayer = zLayer;
     return drawData;
-}
\ No newline at end of file
+}
+
+void qrk::Text::WriteMesh(GLfloat *vertices) {
+    float totalShift = 0;
+    for (int i = 0; i < text.size(); i++) {
+        qrk::Font::GlyphData *glyph = font->GetGlyphData(text[i]);
+        float left = glyph->point_0.x() + totalShift + position.x() * 2;
+        float right = glyph->point_1.x() + totalShift + position.x() * 2;
+        float top =
+                glyph->point_0.y() + font->fontHeight / 2 + position.y() * 2;
+        float bottom =
+                glyph->point_1.y() + font->fontHeight / 2 + position.y() * 2;
+        //two triangles, position then texture position of every vertex
+        const GLfloat quad[24] = {
+                right, top,    glyph->texture_1.x(), glyph->texture_0.y(),
+                left,  top,    glyph->texture_0.x(), glyph->texture_0.y(),
+                left,  bottom, glyph->texture_0.x(), glyph->texture_1.y(),
+                left,  bottom, glyph->texture_0.x(), glyph->texture_1.y(),
+                right, bottom, glyph->texture_1.x(), glyph->texture_1.y(),
+                right, top,    glyph->texture_1.x(), glyph->texture_0.y()};
+        std::copy(quad, quad + 24, vertices + i * 24);
+
+        totalShift += glyph->shift + spacing;
+    }
+}
@@ -0,0 +1,204 @@
+#include "../include/headless_surface.hpp"
+#include "../include/GL_assets.hpp"
+#include <algorithm>
+#ifdef Q_NULL_GL
+#include "../include/null_gl.hpp"
+#else
+//keep the platform headers from pulling in X11
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+qrk::HeadlessSurface::HeadlessSurface(const std::string &surfaceName,
+                                      qrk::vec2u _size,
+                                      qrk::WindowSettings settings)
+    : display(nullptr), context(nullptr), open(false), size(_size),
+      samples(settings.multisamplingLevel), framebuffer(0), colorBuffer(0),
+      depthBuffer(0), resolveFramebuffer(0), resolveBuffer(0) {
+    CreateContext(settings.glMajorVersion, settings.glMinorVersion);
+    open = true;
+    CreateFramebuffer();
+    glViewport(0, 0, size.x(), size.y());
+    SetClearColor(settings.clearColor);
+    qrk::debug::Log("Created headless surface " + surfaceName + ": " +
+                    reinterpret_cast<const char *>(glGetString(GL_RENDERER)));
+}
+
+void qrk::HeadlessSurface::CreateFramebuffer() {
+    GLsizei width = static_cast<GLsizei>(size.x());
+    GLsizei height = static_cast<GLsizei>(size.y());
+    GLint maxSamples = 0;
+    glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+    samples = std::min(samples, static_cast<int>(maxSamples));
+    glCreateRenderbuffers(1, &colorBuffer);
+    glCreateRenderbuffers(1, &depthBuffer);
+    if (samples > 1) {
+        glNamedRenderbufferStorageMultisample(colorBuffer, samples, GL_RGBA8,
+                                              width, height);
+        glNamedRenderbufferStorageMultisample(
+                depthBuffer, samples, GL_DEPTH24_STENCIL8, width, height);
+        //single sampled copy the frame is resolved into on readback
+        glCreateRenderbuffers(1, &resolveBuffer);
+        glNamedRenderbufferStorage(resolveBuffer, GL_RGBA8, width, height);
+        glCreateFramebuffers(1, &resolveFramebuffer);
+        glNamedFramebufferRenderbuffer(resolveFramebuffer,
+                                       GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+                                       resolveBuffer);
+    } else {
+        glNamedRenderbufferStorage(colorBuffer, GL_RGBA8, width, height);
+        glNamedRenderbufferStorage(depthBuffer, GL_DEPTH24_STENCIL8, width,
+                                   height);
+    }
+    glCreateFramebuffers(1, &framebuffer);
+    glNamedFramebufferRenderbuffer(framebuffer, GL_COLOR_ATTACHMENT0,
+                                   GL_RENDERBUFFER, colorBuffer);
+    glNamedFramebufferRenderbuffer(framebuffer, GL_DEPTH_STENCIL_ATTACHMENT,
+                                   GL_RENDERBUFFER, depthBuffer);
+    if (glCheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER) !=
+        GL_FRAMEBUFFER_COMPLETE) {
+        qrk::debug::Error("Headless framebuffer is incomplete",
+                          qrk::debug::Q_FAILED_TO_CREATE_CONTEXT);
+    }
+    //stays bound, everything drawn goes into it
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+void qrk::HeadlessSurface::Close() {
+    if (!open) { return; }
+    MakeContextCurrent();
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteFramebuffers(1, &resolveFramebuffer);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glDeleteRenderbuffers(1, &depthBuffer);
+    glDeleteRenderbuffers(1, &resolveBuffer);
+    DestroyContext();
+    open = false;
+}
+
+void qrk::HeadlessSurface::ReadPixels(std::vector<unsigned char> &pixels) {
+    GLint width = static_cast<GLint>(size.x());
+    GLint height = static_cast<GLint>(size.y());
+    pixels.resize(static_cast<size_t>(width) * height * 4);
+    GLuint source = framebuffer;
+    if (resolveFramebuffer != 0) {
+        glBlitNamedFramebuffer(framebuffer, resolveFramebuffer, 0, 0, width,
+                               height, 0, 0, width, height,
+                               GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        source = resolveFramebuffer;
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, source);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE,
+                 pixels.data());
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+}
+
+void qrk::HeadlessSurface::SwapWindowBuffers() const {
+    glFlush();
+#ifdef Q_NULL_GL
+    qrk::nullgl::EndFrame();
+#endif
+}
+
+#ifdef Q_NULL_GL
+//the null backend has no context to make current
+void qrk::HeadlessSurface::CreateContext(int glMajorVersion,
+                                         int glMinorVersion) {
+    qrk::nullgl::Load();
+    qrk::glState.Invalidate();
+}
+
+void qrk::HeadlessSurface::DestroyContext() {}
+
+bool qrk::HeadlessSurface::IsContextCurrent() { return true; }
+
+void qrk::HeadlessSurface::MakeContextCurrent() const {}
+
+void qrk::HeadlessSurface::ReleaseContext() const {}
+#else
+void qrk::HeadlessSurface::CreateContext(int glMajorVersion,
+                                         int glMinorVersion) {
+    //prefer the surfaceless platform, it needs neither a GPU nor a display
+    auto getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress(
+                    "eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay != nullptr) {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                     EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (display == EGL_NO_DISPLAY) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    if (display == EGL_NO_DISPLAY ||
+        !eglInitialize(display, nullptr, nullptr)) {
+        qrk::debug::Error("Failed to initialize EGL",
+                          qrk::debug::Q_FAILED_TO_CREATE_CONTEXT);
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        qrk::debug::Error("EGL does not support desktop OpenGL",
+                          qrk::debug::Q_FAILED_TO_CREATE_CONTEXT);
+    }
+
+    const EGLint configAttribs[] = {EGL_SURFACE_TYPE,
+                                    EGL_PBUFFER_BIT,
+                                    EGL_RENDERABLE_TYPE,
+                                    EGL_OPENGL_BIT,
+                                    EGL_NONE};
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &configCount) ||
+        configCount == 0) {
+        qrk::debug::Error("No EGL config supports desktop OpenGL",
+                          qrk::debug::Q_FAILED_TO_CREATE_CONTEXT);
+    }
+
+    const EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                     glMajorVersion,
+                                     EGL_CONTEXT_MINOR_VERSION,
+                                     glMinorVersion,
+                                     EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                     EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                     EGL_NONE};
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT,
+                               contextAttribs);
+    if (context == EGL_NO_CONTEXT) {
+        qrk::debug::Error("Failed to create an OpenGL " +
+                                  std::to_string(glMajorVersion) + "." +
+                                  std::to_string(glMinorVersion) +
+                                  " context through EGL",
+                          qrk::debug::Q_FAILED_TO_CREATE_CONTEXT);
+    }
+    if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        qrk::debug::Error("Failed to make the surfaceless context current",
+                          qrk::debug::Q_FAILED_TO_CREATE_CONTEXT);
+    }
+    if (!gladLoadGLLoader((GLADloadproc) eglGetProcAddress)) {
+        qrk::debug::Error("Could not initialize GLAD",
+                          qrk::debug::Q_FAILED_TO_CREATE_CONTEXT);
+    }
+    qrk::assets::LoadParallelShaderCompile(
+            [](const char *name) { return (void *) eglGetProcAddress(name); });
+    //nothing is bound in a new context
+    qrk::glState.Invalidate();
+}
+
+void qrk::HeadlessSurface::DestroyContext() {
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(display, context);
+    eglTerminate(display);
+}
+
+bool qrk::HeadlessSurface::IsContextCurrent() {
+    return eglGetCurrentContext() == context;
+}
+
+void qrk::HeadlessSurface::MakeContextCurrent() const {
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+}
+
+void qrk::HeadlessSurface::ReleaseContext() const {
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
+#endif
\ No newline at end of file
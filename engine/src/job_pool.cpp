@@ -0,0 +1,74 @@
+#include "../include/job_pool.hpp"
+#include <algorithm>
+
+qrk::JobPool::JobPool(unsigned int threadCount) {
+    if (threadCount == 0) {
+        unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+    } else {
+        threadCount--;
+    }
+    workers.reserve(threadCount);
+    for (unsigned int i = 0; i < threadCount; i++) {
+        workers.emplace_back(&JobPool::WorkerLoop, this);
+    }
+}
+
+qrk::JobPool::~JobPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers) { worker.join(); }
+}
+
+void qrk::JobPool::ParallelFor(size_t count, size_t grain, const Job &func) {
+    if (count == 0) { return; }
+    grain = std::max<size_t>(grain, 1);
+    //not worth waking the workers for a single chunk
+    if (workers.empty() || count <= grain) {
+        func(0, count);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &func;
+        jobCount = count;
+        jobGrain = grain;
+        nextChunk = 0;
+        activeWorkers = workers.size();
+        generation++;
+    }
+    wake.notify_all();
+    RunChunks();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return activeWorkers == 0; });
+    job = nullptr;
+}
+
+void qrk::JobPool::WorkerLoop() {
+    uint64_t seenGeneration = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] {
+                return stopping || generation != seenGeneration;
+            });
+            if (stopping) { return; }
+            seenGeneration = generation;
+        }
+        RunChunks();
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--activeWorkers == 0) { finished.notify_one(); }
+    }
+}
+
+void qrk::JobPool::RunChunks() {
+    size_t begin;
+    while ((begin = nextChunk.fetch_add(jobGrain)) < jobCount) {
+        (*job)(begin, std::min(begin + jobGrain, jobCount));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "../include/light_clusters.hpp"
+#include "../include/gl_state.hpp"
+#include "../include/light_pool.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+//view distance where a slice starts, slices are exponential in w
+float SliceStart(int slice, float nearPlane, float farPlane) {
+    return nearPlane * std::pow(farPlane / nearPlane,
+                                static_cast<float>(slice) / qrk::Q_CLUSTERS_Z);
+}
+float TileStart(int tile, int tiles) {
+    return -1.f + 2.f * static_cast<float>(tile) / static_cast<float>(tiles);
+}
+int Tile(float ndc, int tiles) {
+    int tile = static_cast<int>(std::floor((ndc * 0.5f + 0.5f) * tiles));
+    return std::clamp(tile, 0, tiles - 1);
+}
+float Distance(float value, float min, float max) {
+    if (value < min) { return min - value; }
+    if (value > max) { return value - max; }
+    return 0.f;
+}
+}// namespace
+
+float qrk::LightRange(const LightSource &light) {
+    //the shader attenuates by 1 / (c + l d + q d^2), the light stops
+    //mattering once that scales its brightest channel below 1/256
+    float brightest = 0.f;
+    for (const vec3f *color : {&light.ambient, &light.diffuse,
+                               &light.specular}) {
+        for (float channel : color->data) {
+            brightest = std::max(brightest, channel);
+        }
+    }
+    float cutoff = 256.f * brightest - light.constant;
+    if (cutoff <= 0.f) { return 0.f; }
+    if (light.quadratic > 0.f) {
+        return (-light.linear +
+                std::sqrt(light.linear * light.linear +
+                          4.f * light.quadratic * cutoff)) /
+               (2.f * light.quadratic);
+    }
+    if (light.linear > 0.f) { return cutoff / light.linear; }
+    return -1.f;
+}
+
+void qrk::LightClusters::Create() {
+    if (clusterBuffer != 0) { Delete(); }
+    glCreateBuffers(1, &clusterBuffer);
+    glNamedBufferData(clusterBuffer, Q_CLUSTER_COUNT * sizeof(ClusterRange),
+                      nullptr, GL_DYNAMIC_DRAW);
+    glCreateBuffers(1, &indexBuffer);
+    glNamedBufferData(indexBuffer, sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+}
+
+void qrk::LightClusters::Delete() {
+    if (clusterBuffer == 0) { return; }
+    qrk::glState.DeleteBuffers(1, &clusterBuffer);
+    qrk::glState.DeleteBuffers(1, &indexBuffer);
+    clusterBuffer = 0;
+    indexBuffer = 0;
+}
+
+void qrk::LightClusters::Build(const std::vector<LightSource> &lights,
+                               const qrk::mat4 &projection, float nearPlane,
+                               float farPlane) {
+    if (clusterBuffer == 0) { return; }
+    float logRatio = std::log(farPlane / nearPlane);
+    float scale = static_cast<float>(Q_CLUSTERS_Z) / logRatio;
+    depthMapping = qrk::vec2f({scale, -scale * std::log(nearPlane)});
+    //lights are compared to the clip space position the fragment shader
+    //lights, its z is B - A w for a perspective projection
+    float A = projection.data[2][2];
+    float B = projection.data[2][3];
+
+    hits.clear();
+    for (size_t light = 0; light < lights.size(); light++) {
+        const LightSource &source = lights[light];
+        if (source.lightType != Q_POINT) { continue; }
+        float range = LightRange(source);
+        if (range == 0.f) { continue; }
+        GLuint index = static_cast<GLuint>(light);
+        if (range < 0.f || A == 0.f) {
+            for (GLuint cluster = 0; cluster < Q_CLUSTER_COUNT; cluster++) {
+                hits.emplace_back(cluster, index);
+            }
+            continue;
+        }
+
+        const float *p = source.position.data.data();
+        float w0 = (B - (p[2] - range)) / A;
+        float w1 = (B - (p[2] + range)) / A;
+        float wMin = std::max(std::min(w0, w1), nearPlane);
+        float wMax = std::min(std::max(w0, w1), farPlane);
+        if (wMin > wMax) { continue; }
+        //x / w and y / w are monotonic for positive w, the corners of the
+        //box around the light bound its screen rectangle
+        int tileMin[2], tileMax[2];
+        const int tiles[2] = {Q_CLUSTERS_X, Q_CLUSTERS_Y};
+        bool visible = true;
+        for (int axis = 0; axis < 2; axis++) {
+            float lo = p[axis] - range, hi = p[axis] + range;
+            float ndcMin = std::min(lo / wMin, lo / wMax);
+            float ndcMax = std::max(hi / wMin, hi / wMax);
+            if (ndcMax < -1.f || ndcMin > 1.f) { visible = false; }
+            tileMin[axis] = Tile(ndcMin, tiles[axis]);
+            tileMax[axis] = Tile(ndcMax, tiles[axis]);
+        }
+        if (!visible) { continue; }
+        int sliceMin = std::clamp(
+                static_cast<int>(std::floor(std::log(wMin) * depthMapping.x() +
+                                            depthMapping.y())),
+                0, Q_CLUSTERS_Z - 1);
+        int sliceMax = std::clamp(
+                static_cast<int>(std::floor(std::log(wMax) * depthMapping.x() +
+                                            depthMapping.y())),
+                0, Q_CLUSTERS_Z - 1);
+
+        //refine with the distance from the light to the box around every
+        //candidate cluster
+        float rangeSquared = range * range;
+        for (int z = sliceMin; z <= sliceMax; z++) {
+            float sliceNear = SliceStart(z, nearPlane, farPlane);
+            float sliceFar = SliceStart(z + 1, nearPlane, farPlane);
+            float zNear = B - A * sliceNear, zFar = B - A * sliceFar;
+            float dz = Distance(p[2], std::min(zNear, zFar),
+                                std::max(zNear, zFar));
+            for (int y = tileMin[1]; y <= tileMax[1]; y++) {
+                float y0 = TileStart(y, Q_CLUSTERS_Y);
+                float y1 = TileStart(y + 1, Q_CLUSTERS_Y);
+                float dy = Distance(p[1],
+                                    std::min(y0 * sliceNear, y0 * sliceFar),
+                                    std::max(y1 * sliceNear, y1 * sliceFar));
+                for (int x = tileMin[0]; x <= tileMax[0]; x++) {
+                    float x0 = TileStart(x, Q_CLUSTERS_X);
+                    float x1 = TileStart(x + 1, Q_CLUSTERS_X);
+                    float dx = Distance(
+                            p[0], std::min(x0 * sliceNear, x0 * sliceFar),
+                            std::max(x1 * sliceNear, x1 * sliceFar));
+                    if (dx * dx + dy * dy + dz * dz > rangeSquared) {
+                        continue;
+                    }
+                    hits.emplace_back(
+                            (z * Q_CLUSTERS_Y + y) * Q_CLUSTERS_X + x, index);
+                }
+            }
+        }
+    }
+
+    //counting sort of the hits by cluster, lights stay in ascending order
+    clusters.assign(Q_CLUSTER_COUNT, {0, 0});
+    for (const auto &[cluster, light] : hits) { clusters[cluster].count++; }
+    GLuint offset = 0;
+    for (ClusterRange &cluster : clusters) {
+        cluster.offset = offset;
+        offset += cluster.count;
+        cluster.count = 0;
+    }
+    indices.resize(hits.size());
+    for (const auto &[cluster, light] : hits) {
+        ClusterRange &range = clusters[cluster];
+        indices[range.offset + range.count++] = light;
+    }
+
+    glNamedBufferSubData(clusterBuffer, 0,
+                         Q_CLUSTER_COUNT * sizeof(ClusterRange),
+                         clusters.data());
+    //an empty SSBO cannot be bound, keep at least one index around
+    glNamedBufferData(indexBuffer,
+                      std::max<size_t>(indices.size(), 1) * sizeof(GLuint),
+                      indices.empty() ? nullptr : indices.data(),
+                      GL_DYNAMIC_DRAW);
+}
+
+void qrk::LightClusters::Bind() const {
+    if (clusterBuffer == 0) { return; }
+    qrk::glState.BindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, clusterBuffer);
+    qrk::glState.BindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, indexBuffer);
+}
@@ -0,0 +1,83 @@
+#include "../include/light_pool.hpp"
+#include "../include/gl_state.hpp"
+#include "../include/qrk_debug.hpp"
+#include <algorithm>
+
+void qrk::LightPool::Create(GLuint _binding, size_t initialCapacity) {
+    if (buffer != 0) { Delete(); }
+    binding = _binding;
+    capacity = std::max<size_t>(initialCapacity, 1);
+    glCreateBuffers(1, &buffer);
+    glNamedBufferData(buffer, capacity * sizeof(LightSource), nullptr,
+                      GL_DYNAMIC_DRAW);
+    qrk::glState.BindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffer);
+    //lights added before the buffer existed are sent by the next upload
+    reallocate = lights.Size() != 0;
+}
+
+void qrk::LightPool::Delete() {
+    if (buffer == 0) { return; }
+    qrk::glState.DeleteBuffers(1, &buffer);
+    buffer = 0;
+    capacity = 0;
+}
+
+qrk::LightHandle qrk::LightPool::Add(const LightSource &light) {
+    return lights.Add(light);
+}
+
+bool qrk::LightPool::Contains(LightHandle handle) const {
+    return lights.Contains(handle);
+}
+
+const qrk::LightSource *qrk::LightPool::Get(LightHandle handle) const {
+    return lights.Get(handle);
+}
+
+void qrk::LightPool::Update(LightHandle handle, const LightSource &light) {
+    if (!lights.Update(handle, light)) {
+        qrk::debug::Warning("Updating a light that is not in the pool");
+    }
+}
+
+void qrk::LightPool::Remove(LightHandle handle) {
+    if (!lights.Remove(handle)) {
+        qrk::debug::Warning("Removing a light that is not in the pool");
+    }
+}
+
+size_t qrk::LightPool::Upload() {
+    if (buffer == 0) { return 0; }
+    size_t uploaded = 0;
+    const std::vector<LightSource> &data = lights.GetElements();
+    std::vector<uint32_t> &dirtyLights = lights.GetDirty();
+    if (data.size() > capacity || reallocate) {
+        //the old contents are dropped with the old storage, send everything
+        capacity = std::max(data.size(), capacity * 2);
+        glNamedBufferData(buffer, capacity * sizeof(LightSource), nullptr,
+                          GL_DYNAMIC_DRAW);
+        glNamedBufferSubData(buffer, 0, data.size() * sizeof(LightSource),
+                             data.data());
+        uploaded = data.size() * sizeof(LightSource);
+        reallocate = false;
+    } else {
+        std::sort(dirtyLights.begin(), dirtyLights.end());
+        //lights removed after being marked are past the end now
+        auto end = std::lower_bound(dirtyLights.begin(), dirtyLights.end(),
+                                    static_cast<uint32_t>(data.size()));
+        auto run = dirtyLights.begin();
+        while (run != end) {
+            uint32_t first = *run;
+            uint32_t last = first;
+            for (run++; run != end && *run - last <= mergeDistance; run++) {
+                last = *run;
+            }
+            size_t count = last - first + 1;
+            glNamedBufferSubData(buffer, first * sizeof(LightSource),
+                                 count * sizeof(LightSource), &data[first]);
+            uploaded += count * sizeof(LightSource);
+        }
+    }
+    lights.ClearDirty();
+    return uploaded;
+}
@@ -0,0 +1,138 @@
+#include "../include/mesh_pool.hpp"
+#include "../include/gl_state.hpp"
+#include <algorithm>
+#include <atomic>
+
+std::mutex qrk::assets::MeshPool::poolsMutex;
+std::vector<qrk::assets::MeshPool *> qrk::assets::MeshPool::pools;
+
+void qrk::assets::MeshPool::Create(GLsizei initialVertices) {
+    if (VAO != 0) { Delete(); }
+    capacity = initialVertices;
+    size = 0;
+    glCreateBuffers(1, &buffer);
+    glNamedBufferData(buffer, static_cast<GLsizeiptr>(capacity) * vertexStride,
+                      nullptr, GL_STATIC_DRAW);
+    glCreateVertexArrays(1, &VAO);
+    glVertexArrayVertexBuffer(VAO, 0, buffer, 0, vertexStride);
+    qrk::assets::SetVertexFormat(VAO, {{0, 4, 0},
+                                       {1, 2, 4 * sizeof(GLfloat)},
+                                       {2, 3, 6 * sizeof(GLfloat)}});
+    glCreateVertexArrays(1, &positionVAO);
+    glVertexArrayVertexBuffer(positionVAO, 0, buffer, 0, vertexStride);
+    qrk::assets::SetVertexFormat(positionVAO, {{0, 4, 0}});
+
+    std::lock_guard<std::mutex> lock(poolsMutex);
+    pools.push_back(this);
+}
+
+void qrk::assets::MeshPool::Delete() {
+    if (VAO == 0) { return; }
+    {
+        std::lock_guard<std::mutex> lock(poolsMutex);
+        pools.erase(std::find(pools.begin(), pools.end(), this));
+        released.clear();
+    }
+    qrk::glState.DeleteVertexArrays(1, &VAO);
+    qrk::glState.DeleteVertexArrays(1, &positionVAO);
+    qrk::glState.DeleteBuffers(1, &buffer);
+    VAO = 0;
+    positionVAO = 0;
+    buffer = 0;
+    capacity = 0;
+    size = 0;
+    meshes.clear();
+    freeRanges.clear();
+}
+
+uint32_t qrk::assets::MeshPool::CreateId() {
+    static std::atomic<uint32_t> nextId = 1;
+    return nextId.fetch_add(1, std::memory_order_relaxed);
+}
+
+void qrk::assets::MeshPool::Release(uint32_t mesh) {
+    std::lock_guard<std::mutex> lock(poolsMutex);
+    for (MeshPool *pool : pools) { pool->released.push_back(mesh); }
+}
+
+GLint qrk::assets::MeshPool::Register(uint32_t mesh, GLuint VBO,
+                                      GLsizei vertexCount) {
+    auto found = meshes.find(mesh);
+    if (found != meshes.end()) { return found->second.first; }
+    GLint first = Allocate(vertexCount);
+    glCopyNamedBufferSubData(VBO, buffer, 0,
+                             static_cast<GLintptr>(first) * vertexStride,
+                             static_cast<GLsizeiptr>(vertexCount) *
+                                     vertexStride);
+    meshes[mesh] = {first, vertexCount};
+    return first;
+}
+
+void qrk::assets::MeshPool::Unregister(uint32_t mesh) {
+    auto found = meshes.find(mesh);
+    if (found == meshes.end()) { return; }
+    Free(found->second);
+    meshes.erase(found);
+}
+
+void qrk::assets::MeshPool::CollectReleased() {
+    std::lock_guard<std::mutex> lock(poolsMutex);
+    for (uint32_t mesh : released) { Unregister(mesh); }
+    released.clear();
+}
+
+GLint qrk::assets::MeshPool::Allocate(GLsizei count) {
+    //first fit. Draws still reading a released range were submitted
+    //before the copy overwriting it, GL keeps them in order
+    for (auto range = freeRanges.begin(); range != freeRanges.end();
+         range++) {
+        if (range->count < count) { continue; }
+        GLint first = range->first;
+        range->first += count;
+        range->count -= count;
+        if (range->count == 0) { freeRanges.erase(range); }
+        return first;
+    }
+    if (size + count > capacity) { Grow(size + count); }
+    GLint first = size;
+    size += count;
+    return first;
+}
+
+void qrk::assets::MeshPool::Free(Mesh range) {
+    auto next = std::lower_bound(
+            freeRanges.begin(), freeRanges.end(), range,
+            [](const Mesh &a, const Mesh &b) { return a.first < b.first; });
+    next = freeRanges.insert(next, range);
+    //merge with the neighbors, a range ending at size shrinks the pool
+    if (next + 1 != freeRanges.end() &&
+        next->first + next->count == (next + 1)->first) {
+        next->count += (next + 1)->count;
+        freeRanges.erase(next + 1);
+    }
+    if (next != freeRanges.begin() &&
+        (next - 1)->first + (next - 1)->count == next->first) {
+        (next - 1)->count += next->count;
+        next = freeRanges.erase(next) - 1;
+    }
+    if (next->first + next->count == size) {
+        size = next->first;
+        freeRanges.erase(next);
+    }
+}
+
+void qrk::assets::MeshPool::Grow(GLsizei required) {
+    GLsizei newCapacity = std::max(capacity * 2, required);
+    GLuint newBuffer = 0;
+    glCreateBuffers(1, &newBuffer);
+    glNamedBufferData(newBuffer,
+                      static_cast<GLsizeiptr>(newCapacity) * vertexStride,
+                      nullptr, GL_STATIC_DRAW);
+    glCopyNamedBufferSubData(buffer, newBuffer, 0, 0,
+                             static_cast<GLsizeiptr>(size) * vertexStride);
+    glVertexArrayVertexBuffer(VAO, 0, newBuffer, 0, vertexStride);
+    glVertexArrayVertexBuffer(positionVAO, 0, newBuffer, 0, vertexStride);
+    qrk::glState.DeleteBuffers(1, &buffer);
+    buffer = newBuffer;
+    capacity = newCapacity;
+}
\ No newline at end of file
@@ -0,0 +1,576 @@
+#include "../include/null_gl.hpp"
+#include "../dependencies/glad/glad.h"
+#include <array>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+//every stubbed entry point, without the gl prefix
+#define Q_NULL_GL_CALLS(X)                                                     \
+    X(ActiveTexture)                                                           \
+    X(AttachShader)                                                            \
+    X(BeginQuery)                                                              \
+    X(BindBuffer)                                                              \
+    X(BindBufferBase)                                                          \
+    X(BindBufferRange)                                                         \
+    X(BindFramebuffer)                                                         \
+    X(BindTexture)                                                             \
+    X(BindVertexArray)                                                         \
+    X(BlendFunc)                                                               \
+    X(BlitNamedFramebuffer)                                                    \
+    X(BufferData)                                                              \
+    X(BufferStorage)                                                           \
+    X(BufferSubData)                                                           \
+    X(CheckNamedFramebufferStatus)                                             \
+    X(Clear)                                                                   \
+    X(ClearColor)                                                              \
+    X(ClientWaitSync)                                                          \
+    X(ColorMask)                                                               \
+    X(CompileShader)                                                           \
+    X(CopyNamedBufferSubData)                                                  \
+    X(CreateBuffers)                                                           \
+    X(CreateFramebuffers)                                                      \
+    X(CreateProgram)                                                           \
+    X(CreateQueries)                                                           \
+    X(CreateRenderbuffers)                                                     \
+    X(CreateShader)                                                            \
+    X(CreateVertexArrays)                                                      \
+    X(CullFace)                                                                \
+    X(DeleteBuffers)                                                           \
+    X(DeleteFramebuffers)                                                      \
+    X(DeleteQueries)                                                           \
+    X(DeleteRenderbuffers)                                                     \
+    X(DeleteShader)                                                            \
+    X(DeleteSync)                                                              \
+    X(DeleteTextures)                                                          \
+    X(DeleteVertexArrays)                                                      \
+    X(DepthFunc)                                                               \
+    X(DepthMask)                                                               \
+    X(Disable)                                                                 \
+    X(DrawArrays)                                                              \
+    X(DrawArraysInstancedBaseInstance)                                         \
+    X(Enable)                                                                  \
+    X(EnableVertexArrayAttrib)                                                 \
+    X(EndQuery)                                                                \
+    X(FenceSync)                                                               \
+    X(Flush)                                                                   \
+    X(GenBuffers)                                                              \
+    X(GenTextures)                                                             \
+    X(GenerateMipmap)                                                          \
+    X(GetIntegerv)                                                             \
+    X(GetProgramBinary)                                                        \
+    X(GetProgramInfoLog)                                                       \
+    X(GetProgramiv)                                                            \
+    X(GetQueryObjectiv)                                                        \
+    X(GetQueryObjectui64v)                                                     \
+    X(GetShaderInfoLog)                                                        \
+    X(GetShaderiv)                                                             \
+    X(GetString)                                                               \
+    X(GetUniformBlockIndex)                                                    \
+    X(GetUniformLocation)                                                      \
+    X(LinkProgram)                                                             \
+    X(MapBufferRange)                                                          \
+    X(MultiDrawArraysIndirect)                                                 \
+    X(NamedBufferData)                                                         \
+    X(NamedBufferStorage)                                                      \
+    X(NamedBufferSubData)                                                      \
+    X(NamedFramebufferRenderbuffer)                                            \
+    X(NamedRenderbufferStorage)                                                \
+    X(NamedRenderbufferStorageMultisample)                                     \
+    X(PixelStorei)                                                             \
+    X(ProgramBinary)                                                           \
+    X(ProgramParameteri)                                                       \
+    X(QueryCounter)                                                            \
+    X(ReadPixels)                                                              \
+    X(SampleCoverage)                                                          \
+    X(ShaderSource)                                                            \
+    X(TexImage2D)                                                              \
+    X(TexParameteri)                                                           \
+    X(TexSubImage2D)                                                           \
+    X(Uniform1i)                                                               \
+    X(Uniform2f)                                                               \
+    X(UniformBlockBinding)                                                     \
+    X(UseProgram)                                                              \
+    X(VertexArrayAttribBinding)                                                \
+    X(VertexArrayAttribFormat)                                                 \
+    X(VertexArrayBindingDivisor)                                               \
+    X(VertexArrayVertexBuffer)                                                 \
+    X(Viewport)
+
+enum Call {
+#define Q_NULL_GL_ENUM(name) call_##name,
+    Q_NULL_GL_CALLS(Q_NULL_GL_ENUM)
+#undef Q_NULL_GL_ENUM
+            callCount
+};
+
+const char *callNames[] = {
+#define Q_NULL_GL_NAME(name) "gl" #name,
+        Q_NULL_GL_CALLS(Q_NULL_GL_NAME)
+#undef Q_NULL_GL_NAME
+};
+
+//counters of the frame being recorded, only touched by the thread that
+//currently owns the context
+struct Counters {
+    std::array<uint64_t, callCount> calls{};
+    uint64_t stateChanges = 0;
+    uint64_t drawCalls = 0;
+    uint64_t instances = 0;
+    uint64_t indirectCommands = 0;
+    uint64_t bytesUploaded = 0;
+};
+Counters frame;
+//the stats of the last frame are only built when asked for, so ending a
+//frame does not allocate
+std::mutex lastFrameMutex;
+Counters lastFrame;
+
+//object names and the memory behind immutable buffers, so mapping works
+GLuint nextName = 1;
+std::unordered_map<GLenum, GLuint> boundBuffers;
+std::unordered_map<GLuint, std::vector<unsigned char>> bufferStorage;
+
+void Record(Call call) { frame.calls[call]++; }
+void RecordState(Call call) {
+    frame.calls[call]++;
+    frame.stateChanges++;
+}
+void RecordUpload(Call call, GLsizeiptr size, const void *data) {
+    frame.calls[call]++;
+    if (data != nullptr) { frame.bytesUploaded += size; }
+}
+void CreateNames(GLsizei n, GLuint *names) {
+    for (GLsizei i = 0; i < n; i++) { names[i] = nextName++; }
+}
+size_t PixelSize(GLenum format, GLenum type) {
+    size_t components = 4;
+    switch (format) {
+        case GL_RED:
+            components = 1;
+            break;
+        case GL_RG:
+            components = 2;
+            break;
+        case GL_RGB:
+            components = 3;
+            break;
+        default:
+            break;
+    }
+    return components * (type == GL_FLOAT ? 4 : 1);
+}
+
+qrk::nullgl::FrameStats ToStats(const Counters &counters) {
+    qrk::nullgl::FrameStats stats;
+    for (int i = 0; i < callCount; i++) {
+        if (counters.calls[i] == 0) { continue; }
+        stats.calls += counters.calls[i];
+        stats.callCounts[callNames[i]] = counters.calls[i];
+    }
+    stats.stateChanges = counters.stateChanges;
+    stats.drawCalls = counters.drawCalls;
+    stats.instances = counters.instances;
+    stats.indirectCommands = counters.indirectCommands;
+    stats.bytesUploaded = counters.bytesUploaded;
+    return stats;
+}
+
+//state
+void APIENTRY NullActiveTexture(GLenum) { RecordState(call_ActiveTexture); }
+void APIENTRY NullBindBuffer(GLenum target, GLuint buffer) {
+    RecordState(call_BindBuffer);
+    boundBuffers[target] = buffer;
+}
+void APIENTRY NullBindBufferBase(GLenum, GLuint, GLuint) {
+    RecordState(call_BindBufferBase);
+}
+void APIENTRY NullBindBufferRange(GLenum, GLuint, GLuint, GLintptr,
+                                  GLsizeiptr) {
+    RecordState(call_BindBufferRange);
+}
+void APIENTRY NullBindFramebuffer(GLenum, GLuint) {
+    RecordState(call_BindFramebuffer);
+}
+void APIENTRY NullBindTexture(GLenum, GLuint) {
+    RecordState(call_BindTexture);
+}
+void APIENTRY NullBindVertexArray(GLuint) {
+    RecordState(call_BindVertexArray);
+}
+void APIENTRY NullBlendFunc(GLenum, GLenum) { RecordState(call_BlendFunc); }
+void APIENTRY NullClearColor(GLfloat, GLfloat, GLfloat, GLfloat) {
+    RecordState(call_ClearColor);
+}
+void APIENTRY NullCullFace(GLenum) { RecordState(call_CullFace); }
+void APIENTRY NullColorMask(GLboolean, GLboolean, GLboolean, GLboolean) {
+    RecordState(call_ColorMask);
+}
+void APIENTRY NullDepthFunc(GLenum) { RecordState(call_DepthFunc); }
+void APIENTRY NullDepthMask(GLboolean) { RecordState(call_DepthMask); }
+void APIENTRY NullDisable(GLenum) { RecordState(call_Disable); }
+void APIENTRY NullEnable(GLenum) { RecordState(call_Enable); }
+void APIENTRY NullPixelStorei(GLenum, GLint) { RecordState(call_PixelStorei); }
+void APIENTRY NullSampleCoverage(GLfloat, GLboolean) {
+    RecordState(call_SampleCoverage);
+}
+void APIENTRY NullTexParameteri(GLenum, GLenum, GLint) {
+    RecordState(call_TexParameteri);
+}
+void APIENTRY NullUniform1i(GLint, GLint) { RecordState(call_Uniform1i); }
+void APIENTRY NullUniform2f(GLint, GLfloat, GLfloat) {
+    RecordState(call_Uniform2f);
+}
+void APIENTRY NullUniformBlockBinding(GLuint, GLuint, GLuint) {
+    RecordState(call_UniformBlockBinding);
+}
+void APIENTRY NullUseProgram(GLuint) { RecordState(call_UseProgram); }
+void APIENTRY NullViewport(GLint, GLint, GLsizei, GLsizei) {
+    RecordState(call_Viewport);
+}
+
+//object creation and destruction
+void APIENTRY NullAttachShader(GLuint, GLuint) { Record(call_AttachShader); }
+void APIENTRY NullCompileShader(GLuint) { Record(call_CompileShader); }
+void APIENTRY NullCopyNamedBufferSubData(GLuint, GLuint, GLintptr, GLintptr,
+                                         GLsizeiptr) {
+    Record(call_CopyNamedBufferSubData);
+}
+void APIENTRY NullCreateBuffers(GLsizei n, GLuint *buffers) {
+    Record(call_CreateBuffers);
+    CreateNames(n, buffers);
+}
+void APIENTRY NullCreateFramebuffers(GLsizei n, GLuint *framebuffers) {
+    Record(call_CreateFramebuffers);
+    CreateNames(n, framebuffers);
+}
+GLuint APIENTRY NullCreateProgram() {
+    Record(call_CreateProgram);
+    return nextName++;
+}
+void APIENTRY NullCreateQueries(GLenum, GLsizei n, GLuint *ids) {
+    Record(call_CreateQueries);
+    CreateNames(n, ids);
+}
+void APIENTRY NullCreateRenderbuffers(GLsizei n, GLuint *renderbuffers) {
+    Record(call_CreateRenderbuffers);
+    CreateNames(n, renderbuffers);
+}
+GLuint APIENTRY NullCreateShader(GLenum) {
+    Record(call_CreateShader);
+    return nextName++;
+}
+void APIENTRY NullCreateVertexArrays(GLsizei n, GLuint *arrays) {
+    Record(call_CreateVertexArrays);
+    CreateNames(n, arrays);
+}
+void APIENTRY NullDeleteBuffers(GLsizei n, const GLuint *buffers) {
+    Record(call_DeleteBuffers);
+    for (GLsizei i = 0; i < n; i++) { bufferStorage.erase(buffers[i]); }
+}
+void APIENTRY NullDeleteFramebuffers(GLsizei, const GLuint *) {
+    Record(call_DeleteFramebuffers);
+}
+void APIENTRY NullDeleteQueries(GLsizei, const GLuint *) {
+    Record(call_DeleteQueries);
+}
+void APIENTRY NullDeleteRenderbuffers(GLsizei, const GLuint *) {
+    Record(call_DeleteRenderbuffers);
+}
+void APIENTRY NullDeleteShader(GLuint) { Record(call_DeleteShader); }
+void APIENTRY NullDeleteSync(GLsync) { Record(call_DeleteSync); }
+void APIENTRY NullDeleteTextures(GLsizei, const GLuint *) {
+    Record(call_DeleteTextures);
+}
+void APIENTRY NullDeleteVertexArrays(GLsizei, const GLuint *) {
+    Record(call_DeleteVertexArrays);
+}
+void APIENTRY NullEnableVertexArrayAttrib(GLuint, GLuint) {
+    Record(call_EnableVertexArrayAttrib);
+}
+GLsync APIENTRY NullFenceSync(GLenum, GLbitfield) {
+    Record(call_FenceSync);
+    //never dereferenced, only has to be distinct from null
+    return reinterpret_cast<GLsync>(static_cast<uintptr_t>(nextName++));
+}
+void APIENTRY NullGenBuffers(GLsizei n, GLuint *buffers) {
+    Record(call_GenBuffers);
+    CreateNames(n, buffers);
+}
+void APIENTRY NullGenTextures(GLsizei n, GLuint *textures) {
+    Record(call_GenTextures);
+    CreateNames(n, textures);
+}
+void APIENTRY NullGenerateMipmap(GLenum) { Record(call_GenerateMipmap); }
+void APIENTRY NullLinkProgram(GLuint) { Record(call_LinkProgram); }
+void APIENTRY NullProgramBinary(GLuint, GLenum, const void *, GLsizei) {
+    Record(call_ProgramBinary);
+}
+void APIENTRY NullProgramParameteri(GLuint, GLenum, GLint) {
+    Record(call_ProgramParameteri);
+}
+void APIENTRY NullNamedFramebufferRenderbuffer(GLuint, GLenum, GLenum,
+                                               GLuint) {
+    Record(call_NamedFramebufferRenderbuffer);
+}
+void APIENTRY NullNamedRenderbufferStorage(GLuint, GLenum, GLsizei, GLsizei) {
+    Record(call_NamedRenderbufferStorage);
+}
+void APIENTRY NullNamedRenderbufferStorageMultisample(GLuint, GLsizei, GLenum,
+                                                      GLsizei, GLsizei) {
+    Record(call_NamedRenderbufferStorageMultisample);
+}
+void APIENTRY NullShaderSource(GLuint, GLsizei, const GLchar *const *,
+                               const GLint *) {
+    Record(call_ShaderSource);
+}
+void APIENTRY NullVertexArrayAttribBinding(GLuint, GLuint, GLuint) {
+    Record(call_VertexArrayAttribBinding);
+}
+void APIENTRY NullVertexArrayAttribFormat(GLuint, GLuint, GLint, GLenum,
+                                          GLboolean, GLuint) {
+    Record(call_VertexArrayAttribFormat);
+}
+void APIENTRY NullVertexArrayBindingDivisor(GLuint, GLuint, GLuint) {
+    Record(call_VertexArrayBindingDivisor);
+}
+void APIENTRY NullVertexArrayVertexBuffer(GLuint, GLuint, GLuint, GLintptr,
+                                          GLsizei) {
+    Record(call_VertexArrayVertexBuffer);
+}
+
+//uploads
+void APIENTRY NullBufferData(GLenum, GLsizeiptr size, const void *data,
+                             GLenum) {
+    RecordUpload(call_BufferData, size, data);
+}
+void APIENTRY NullBufferStorage(GLenum target, GLsizeiptr size,
+                                const void *data, GLbitfield) {
+    RecordUpload(call_BufferStorage, size, data);
+    bufferStorage[boundBuffers[target]].resize(size);
+}
+void APIENTRY NullBufferSubData(GLenum, GLintptr, GLsizeiptr size,
+                                const void *data) {
+    RecordUpload(call_BufferSubData, size, data);
+}
+void APIENTRY NullNamedBufferData(GLuint, GLsizeiptr size, const void *data,
+                                  GLenum) {
+    RecordUpload(call_NamedBufferData, size, data);
+}
+void APIENTRY NullNamedBufferStorage(GLuint buffer, GLsizeiptr size,
+                                     const void *data, GLbitfield) {
+    RecordUpload(call_NamedBufferStorage, size, data);
+    bufferStorage[buffer].resize(size);
+}
+void APIENTRY NullNamedBufferSubData(GLuint, GLintptr, GLsizeiptr size,
+                                     const void *data) {
+    RecordUpload(call_NamedBufferSubData, size, data);
+}
+void APIENTRY NullTexImage2D(GLenum, GLint, GLint, GLsizei width,
+                             GLsizei height, GLint, GLenum format, GLenum type,
+                             const void *pixels) {
+    RecordUpload(call_TexImage2D,
+                 static_cast<GLsizeiptr>(width) * height *
+                         PixelSize(format, type),
+                 pixels);
+}
+void APIENTRY NullTexSubImage2D(GLenum, GLint, GLint, GLint, GLsizei width,
+                                GLsizei height, GLenum format, GLenum type,
+                                const void *pixels) {
+    RecordUpload(call_TexSubImage2D,
+                 static_cast<GLsizeiptr>(width) * height *
+                         PixelSize(format, type),
+                 pixels);
+}
+void *APIENTRY NullMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr,
+                                  GLbitfield) {
+    Record(call_MapBufferRange);
+    auto storage = bufferStorage.find(boundBuffers[target]);
+    if (storage == bufferStorage.end()) { return nullptr; }
+    return storage->second.data() + offset;
+}
+
+//draws and frame work
+void APIENTRY NullBlitNamedFramebuffer(GLuint, GLuint, GLint, GLint, GLint,
+                                       GLint, GLint, GLint, GLint, GLint,
+                                       GLbitfield, GLenum) {
+    Record(call_BlitNamedFramebuffer);
+}
+void APIENTRY NullClear(GLbitfield) { Record(call_Clear); }
+void APIENTRY NullDrawArrays(GLenum, GLint, GLsizei) {
+    Record(call_DrawArrays);
+    frame.drawCalls++;
+    frame.instances++;
+}
+void APIENTRY NullDrawArraysInstancedBaseInstance(GLenum, GLint, GLsizei,
+                                                  GLsizei instanceCount,
+                                                  GLuint) {
+    Record(call_DrawArraysInstancedBaseInstance);
+    frame.drawCalls++;
+    frame.instances += instanceCount;
+}
+void APIENTRY NullMultiDrawArraysIndirect(GLenum, const void *indirect,
+                                          GLsizei drawCount, GLsizei stride) {
+    Record(call_MultiDrawArraysIndirect);
+    frame.drawCalls++;
+    frame.indirectCommands += drawCount;
+    //the commands can only be read back from host backed storage
+    auto storage = bufferStorage.find(boundBuffers[GL_DRAW_INDIRECT_BUFFER]);
+    if (storage == bufferStorage.end()) { return; }
+    const GLsizei commandSize = 4 * sizeof(GLuint);
+    const unsigned char *command =
+            storage->second.data() + reinterpret_cast<uintptr_t>(indirect);
+    for (GLsizei i = 0; i < drawCount; i++) {
+        GLuint instanceCount;
+        std::memcpy(&instanceCount, command + sizeof(GLuint), sizeof(GLuint));
+        frame.instances += instanceCount;
+        command += stride == 0 ? commandSize : stride;
+    }
+}
+void APIENTRY NullFlush() { Record(call_Flush); }
+void APIENTRY NullQueryCounter(GLuint, GLenum) { Record(call_QueryCounter); }
+void APIENTRY NullBeginQuery(GLenum, GLuint) { Record(call_BeginQuery); }
+void APIENTRY NullEndQuery(GLenum) { Record(call_EndQuery); }
+GLenum APIENTRY NullClientWaitSync(GLsync, GLbitfield, GLuint64) {
+    Record(call_ClientWaitSync);
+    return GL_ALREADY_SIGNALED;
+}
+void APIENTRY NullReadPixels(GLint, GLint, GLsizei width, GLsizei height,
+                             GLenum format, GLenum type, void *pixels) {
+    Record(call_ReadPixels);
+    std::memset(pixels, 0,
+                static_cast<size_t>(width) * height * PixelSize(format, type));
+}
+
+//queries
+GLenum APIENTRY NullCheckNamedFramebufferStatus(GLuint, GLenum) {
+    Record(call_CheckNamedFramebufferStatus);
+    return GL_FRAMEBUFFER_COMPLETE;
+}
+void APIENTRY NullGetIntegerv(GLenum pname, GLint *data) {
+    Record(call_GetIntegerv);
+    switch (pname) {
+        case GL_MAX_SAMPLES:
+            *data = 8;
+            break;
+        case GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT:
+        case GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT:
+            *data = 256;
+            break;
+        case GL_MAJOR_VERSION:
+            *data = 4;
+            break;
+        case GL_MINOR_VERSION:
+            *data = 6;
+            break;
+        default:
+            *data = 0;
+            break;
+    }
+}
+//no binary formats are reported, so the program cache stays off
+void APIENTRY NullGetProgramBinary(GLuint, GLsizei, GLsizei *length, GLenum *,
+                                   void *) {
+    Record(call_GetProgramBinary);
+    if (length != nullptr) { *length = 0; }
+}
+void APIENTRY NullGetProgramInfoLog(GLuint, GLsizei bufSize, GLsizei *length,
+                                    GLchar *infoLog) {
+    Record(call_GetProgramInfoLog);
+    if (length != nullptr) { *length = 0; }
+    if (bufSize > 0) { infoLog[0] = '\0'; }
+}
+void APIENTRY NullGetProgramiv(GLuint, GLenum pname, GLint *params) {
+    Record(call_GetProgramiv);
+    if (pname == GL_LINK_STATUS) { *params = GL_TRUE; }
+    if (pname == GL_INFO_LOG_LENGTH) { *params = 0; }
+}
+void APIENTRY NullGetQueryObjectiv(GLuint, GLenum pname, GLint *params) {
+    Record(call_GetQueryObjectiv);
+    if (pname == GL_QUERY_RESULT_AVAILABLE) { *params = GL_TRUE; }
+}
+//no time passes on the null backend
+void APIENTRY NullGetQueryObjectui64v(GLuint, GLenum, GLuint64 *params) {
+    Record(call_GetQueryObjectui64v);
+    *params = 0;
+}
+void APIENTRY NullGetShaderInfoLog(GLuint, GLsizei bufSize, GLsizei *length,
+                                   GLchar *infoLog) {
+    Record(call_GetShaderInfoLog);
+    if (length != nullptr) { *length = 0; }
+    if (bufSize > 0) { infoLog[0] = '\0'; }
+}
+void APIENTRY NullGetShaderiv(GLuint, GLenum pname, GLint *params) {
+    Record(call_GetShaderiv);
+    //other names are left untouched, like a driver raising invalid enum
+    if (pname == GL_COMPILE_STATUS) { *params = GL_TRUE; }
+    if (pname == GL_INFO_LOG_LENGTH) { *params = 0; }
+}
+const GLubyte *APIENTRY NullGetString(GLenum name) {
+    Record(call_GetString);
+    const char *string = "";
+    switch (name) {
+        case GL_VENDOR:
+            string = "Quark";
+            break;
+        case GL_RENDERER:
+            string = "Quark null GL";
+            break;
+        case GL_VERSION:
+            string = "4.6.0 Core Profile";
+            break;
+        case GL_SHADING_LANGUAGE_VERSION:
+            string = "4.60";
+            break;
+        default:
+            break;
+    }
+    return reinterpret_cast<const GLubyte *>(string);
+}
+GLuint APIENTRY NullGetUniformBlockIndex(GLuint, const GLchar *) {
+    Record(call_GetUniformBlockIndex);
+    return 0;
+}
+GLint APIENTRY NullGetUniformLocation(GLuint, const GLchar *) {
+    Record(call_GetUniformLocation);
+    return 0;
+}
+}// namespace
+
+void qrk::nullgl::Load() {
+    frame = Counters();
+    nextName = 1;
+    boundBuffers.clear();
+    bufferStorage.clear();
+    {
+        std::lock_guard<std::mutex> lock(lastFrameMutex);
+        lastFrame = Counters();
+    }
+    GLVersion.major = 4;
+    GLVersion.minor = 6;
+
+#define Q_NULL_GL_LOAD(name) glad_gl##name = Null##name;
+    Q_NULL_GL_CALLS(Q_NULL_GL_LOAD)
+#undef Q_NULL_GL_LOAD
+}
+
+void qrk::nullgl::EndFrame() {
+    {
+        std::lock_guard<std::mutex> lock(lastFrameMutex);
+        lastFrame = frame;
+    }
+    frame = Counters();
+}
+
+qrk::nullgl::FrameStats qrk::nullgl::LastFrame() {
+    Counters counters;
+    {
+        std::lock_guard<std::mutex> lock(lastFrameMutex);
+        counters = lastFrame;
+    }
+    return ToStats(counters);
+}
+
+qrk::nullgl::FrameStats qrk::nullgl::Recorded() { return ToStats(frame); }
\ No newline at end of file
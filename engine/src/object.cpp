@@ -1,4 +1,6 @@
 #include "../include/object.hpp"
+#include "../include/gl_state.hpp"
+#include "../include/mesh_pool.hpp"
 
 void qrk::Object::LoadObjectAsync(
         const std::string& path, std::atomic_bool *finishedFlag,
@@ -398,10 +400,41 @@ std::string qrk::Object::DumpObjectData(const std::string &path) const {
     return dataDump.str();
 }
 
+qrk::GLMesh::GLMesh(const qrk::Object &_objectData)
+    : VAO(0), VBO(0), vertexCount(_objectData.vertexNumber),
+      id(qrk::assets::MeshPool::CreateId()) {
+    glCreateVertexArrays(1, &VAO);
+    glCreateBuffers(1, &VBO);
+    glNamedBufferData(VBO, _objectData.data.size() * sizeof(GLfloat),
+                      _objectData.data.data(), GL_STATIC_DRAW);
+    //vertex position, texture position and normal
+    glVertexArrayVertexBuffer(VAO, 0, VBO, 0, 9 * sizeof(GLfloat));
+    qrk::assets::SetVertexFormat(VAO, {{0, 4, 0},
+                                       {1, 2, 4 * sizeof(GLfloat)},
+                                       {2, 3, 6 * sizeof(GLfloat)}});
+
+    bounds = qrk::AABB();
+    for (size_t vertex = 0; vertex + 9 <= _objectData.data.size();
+         vertex += 9) {
+        for (int i = 0; i < 3; i++) {
+            float value = _objectData.data[vertex + i];
+            if (vertex == 0 || value < bounds.min[i]) { bounds.min[i] = value; }
+            if (vertex == 0 || value > bounds.max[i]) { bounds.max[i] = value; }
+        }
+    }
+}
+
+qrk::GLMesh::~GLMesh() {
+    qrk::assets::MeshPool::Release(id);
+    qrk::glState.DeleteVertexArrays(1, &VAO);
+    qrk::glState.DeleteBuffers(1, &VBO);
+}
+
 qrk::DrawData_3D qrk::GLObject::GetDrawData() {
     qrk::DrawData_3D returnData;
-    returnData.VAO = this->VAO;
-    returnData.VBO = this->VBO;
+    returnData.VAO = mesh->VAO;
+    returnData.VBO = mesh->VBO;
+    returnData.mesh = mesh->id;
     if (textured) {
         returnData.texture = this->texture;
         returnData.textured = true;
@@ -409,10 +442,16 @@ qrk::DrawData_3D qrk::GLObject::GetDrawData() {
         returnData.texture = nullptr;
         returnData.textured = false;
     }
-    returnData.vertexCount = this->vertexNumber;
-    returnData.position = this->posMatrix;
-    returnData.rotation = this->rotMatrix;
-    returnData.scale = this->sclMatrix;
+    returnData.vertexCount = mesh->vertexCount;
+    if (modelDirty) {
+        qrk::mat4 tempMatrix =
+                qrk::CreateModelMatrix(position, rotation, scale);
+        modelMatrix = tempMatrix;
+        modelDirty = false;
+    }
+    returnData.model = this->modelMatrix;
     returnData.color = this->color;
+    returnData.material = this->material;
+    returnData.bounds = mesh->bounds;
     return returnData;
 }
\ No newline at end of file
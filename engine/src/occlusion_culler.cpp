@@ -0,0 +1,441 @@
+#include "../include/occlusion_culler.hpp"
+#include "../include/object.hpp"
+#include "../include/qrk_debug.hpp"
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define Q_OCCLUSION_SSE
+#include <immintrin.h>
+#endif
+
+namespace {
+//clip space w below this is treated as behind the camera
+constexpr float minW = 1e-5f;
+
+void Multiply(const qrk::mat4 &lhs, const qrk::mat4 &rhs, qrk::mat4 &result) {
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            result.data[i][j] = lhs.data[i][0] * rhs.data[0][j] +
+                                lhs.data[i][1] * rhs.data[1][j] +
+                                lhs.data[i][2] * rhs.data[2][j] +
+                                lhs.data[i][3] * rhs.data[3][j];
+        }
+    }
+}
+
+void Transform(const qrk::mat4 &matrix, const float *position, float *clip) {
+    for (int i = 0; i < 4; i++) {
+        clip[i] = matrix.data[i][0] * position[0] +
+                  matrix.data[i][1] * position[1] +
+                  matrix.data[i][2] * position[2] + matrix.data[i][3];
+    }
+}
+
+//in front of the near plane of OpenGL clip space
+bool InFront(const float *clip) {
+    return clip[3] > minW && clip[2] >= -clip[3];
+}
+}// namespace
+
+qrk::Occluder::Occluder(const qrk::Object &object) {
+    if (object.data.empty()) {
+        qrk::debug::Warning("Creating an occluder from an object that is not "
+                            "loaded");
+    }
+    size_t vertexCount = object.data.size() / 9;
+    positions.reserve(vertexCount * 3);
+    for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+        const GLfloat *data = &object.data[vertex * 9];
+        positions.insert(positions.end(), data, data + 3);
+    }
+    ComputeBounds();
+    FindNeighbors();
+}
+
+qrk::Occluder::Occluder(std::vector<float> _positions)
+    : positions(std::move(_positions)) {
+    if (positions.size() % 9 != 0) {
+        qrk::debug::Warning("Occluder positions are not whole triangles");
+        positions.resize(positions.size() - positions.size() % 9);
+    }
+    ComputeBounds();
+    FindNeighbors();
+}
+
+void qrk::Occluder::ComputeBounds() {
+    bounds = qrk::AABB();
+    for (size_t vertex = 0; vertex < positions.size(); vertex += 3) {
+        for (int i = 0; i < 3; i++) {
+            float value = positions[vertex + i];
+            if (vertex == 0 || value < bounds.min[i]) { bounds.min[i] = value; }
+            if (vertex == 0 || value > bounds.max[i]) { bounds.max[i] = value; }
+        }
+    }
+}
+
+void qrk::Occluder::FindNeighbors() {
+    //an edge is the bits of both positions, the lower one first
+    using Position = std::array<uint32_t, 3>;
+    struct EdgeHash {
+        size_t operator()(const std::pair<Position, Position> &edge) const {
+            size_t hash = 0;
+            for (uint32_t value : edge.first) { hash = hash * 31 + value; }
+            for (uint32_t value : edge.second) { hash = hash * 31 + value; }
+            return hash;
+        }
+    };
+    auto getPosition = [&](size_t vertex) {
+        Position position;
+        std::memcpy(position.data(), &positions[vertex * 3], sizeof(position));
+        return position;
+    };
+
+    //edges of every triangle with their position, edges shared by more
+    //than two triangles are left without neighbors
+    struct Shared {
+        uint32_t edges[2];
+        bool swapped[2];
+        int count;
+    };
+    size_t count = GetTriangleCount();
+    std::unordered_map<std::pair<Position, Position>, Shared, EdgeHash>
+            shared;
+    shared.reserve(count * 3);
+    for (size_t triangle = 0; triangle < count; triangle++) {
+        for (int edge = 0; edge < 3; edge++) {
+            Position from = getPosition(triangle * 3 + (edge + 1) % 3);
+            Position to = getPosition(triangle * 3 + (edge + 2) % 3);
+            bool swapped = to < from;
+            if (swapped) { std::swap(from, to); }
+            Shared &entry = shared.try_emplace({from, to}, Shared{})
+                                    .first->second;
+            if (entry.count < 2) {
+                entry.edges[entry.count] =
+                        static_cast<uint32_t>(triangle * 3 + edge);
+                entry.swapped[entry.count] = swapped;
+            }
+            entry.count++;
+        }
+    }
+    neighbors.assign(count * 3, noNeighbor);
+    for (const auto &[edge, entry] : shared) {
+        if (entry.count != 2) { continue; }
+        uint32_t flipped =
+                entry.swapped[0] == entry.swapped[1] ? flippedNeighbor : 0;
+        neighbors[entry.edges[0]] = (entry.edges[1] / 3) | flipped;
+        neighbors[entry.edges[1]] = (entry.edges[0] / 3) | flipped;
+    }
+}
+
+qrk::OcclusionCuller::OcclusionCuller(int _width, int _height)
+    : width((std::max(_width, 1) + tileSize - 1) / tileSize * tileSize),
+      height((std::max(_height, 1) + tileSize - 1) / tileSize * tileSize),
+      viewProjection(qrk::identity4()) {
+    tilesX = width / tileSize;
+    tilesY = height / tileSize;
+    binsX = (width + binWidth - 1) / binWidth;
+    binsY = (height + binHeight - 1) / binHeight;
+    depth.assign(size_t(width) * height, 1.f);
+    tileDepth.assign(size_t(tilesX) * tilesY, 1.f);
+}
+
+void qrk::OcclusionCuller::BeginFrame(const qrk::mat4 &_viewProjection) {
+    viewProjection = _viewProjection;
+    std::fill(depth.begin(), depth.end(), 1.f);
+    std::fill(tileDepth.begin(), tileDepth.end(), 1.f);
+    instances.clear();
+    triangleCount = 0;
+    rasterizedCount = 0;
+}
+
+void qrk::OcclusionCuller::AddOccluder(const Occluder &occluder,
+                                       const qrk::mat4 &model) {
+    if (occluder.GetTriangleCount() == 0) { return; }
+    Instance &instance = instances.emplace_back();
+    instance.occluder = &occluder;
+    Multiply(viewProjection, model, instance.modelViewProjection);
+    instance.firstTriangle = triangleCount;
+    triangleCount += occluder.GetTriangleCount();
+}
+
+void qrk::OcclusionCuller::RenderOccluders(qrk::JobPool *jobs) {
+    //grows to the largest frame and stays, setup writes every triangle
+    if (triangles.size() < triangleCount) {
+        triangles.resize(triangleCount);
+        facing.resize(triangleCount);
+    }
+    int binCount = binsX * binsY;
+    if (jobs == nullptr) {
+        for (const Instance &instance : instances) { SetupTriangles(instance); }
+        for (int bin = 0; bin < binCount; bin++) { RasterizeBin(bin); }
+    } else {
+        jobs->ParallelFor(instances.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                SetupTriangles(instances[i]);
+            }
+        });
+        jobs->ParallelFor(binCount, 1, [&](size_t begin, size_t end) {
+            for (size_t bin = begin; bin < end; bin++) {
+                RasterizeBin(static_cast<int>(bin));
+            }
+        });
+    }
+    rasterizedCount = 0;
+    for (size_t i = 0; i < triangleCount; i++) {
+        if (triangles[i].minX <= triangles[i].maxX) { rasterizedCount++; }
+    }
+}
+
+void qrk::OcclusionCuller::SetupTriangles(const Instance &instance) {
+    const std::vector<float> &positions = instance.occluder->GetPositions();
+    size_t count = instance.occluder->GetTriangleCount();
+    for (size_t i = 0; i < count; i++) {
+        Triangle &triangle = triangles[instance.firstTriangle + i];
+        //an empty box marks triangles that are skipped
+        triangle.minX = 0;
+        triangle.maxX = -1;
+        facing[instance.firstTriangle + i] = 0;
+
+        float x[3], y[3], z[3];
+        bool visible = true;
+        for (int vertex = 0; vertex < 3; vertex++) {
+            float clip[4];
+            Transform(instance.modelViewProjection,
+                      &positions[(i * 3 + vertex) * 3], clip);
+            if (!InFront(clip)) {
+                visible = false;
+                break;
+            }
+            float inverseW = 1.f / clip[3];
+            x[vertex] = (clip[0] * inverseW * 0.5f + 0.5f) * width;
+            y[vertex] = (0.5f - clip[1] * inverseW * 0.5f) * height;
+            z[vertex] = clip[2] * inverseW;
+        }
+        if (!visible) { continue; }
+
+        //twice the signed area, the edges face inwards whatever the winding
+        float area = (x[1] - x[0]) * (y[2] - y[0]) -
+                     (x[2] - x[0]) * (y[1] - y[0]);
+        if (std::abs(area) < 1e-8f) { continue; }
+        float sign = area > 0.f ? 1.f : -1.f;
+        facing[instance.firstTriangle + i] = area > 0.f ? 1 : -1;
+
+        //pixels whose center is inside the bounds of the triangle
+        float left = std::min({x[0], x[1], x[2]});
+        float right = std::max({x[0], x[1], x[2]});
+        float top = std::min({y[0], y[1], y[2]});
+        float bottom = std::max({y[0], y[1], y[2]});
+        int minX = std::max(static_cast<int>(std::ceil(left - 0.5f)), 0);
+        int maxX = std::min(static_cast<int>(std::floor(right - 0.5f)),
+                            width - 1);
+        int minY = std::max(static_cast<int>(std::ceil(top - 0.5f)), 0);
+        int maxY = std::min(static_cast<int>(std::floor(bottom - 0.5f)),
+                            height - 1);
+        if (minX > maxX || minY > maxY) { continue; }
+
+        for (int edge = 0; edge < 3; edge++) {
+            int from = (edge + 1) % 3;
+            int to = (edge + 2) % 3;
+            triangle.edges[edge][0] = sign * (y[from] - y[to]);
+            triangle.edges[edge][1] = sign * (x[to] - x[from]);
+            triangle.edges[edge][2] =
+                    sign * (x[from] * y[to] - y[from] * x[to]);
+        }
+
+        //depth is linear in screen space after the divide, moving half a
+        //pixel along both axes gives the farthest depth within a pixel
+        float dzdx = ((z[1] - z[0]) * (y[2] - y[0]) -
+                      (z[2] - z[0]) * (y[1] - y[0])) /
+                     area;
+        float dzdy = ((z[2] - z[0]) * (x[1] - x[0]) -
+                      (z[1] - z[0]) * (x[2] - x[0])) /
+                     area;
+        triangle.z[0] = z[0] - dzdx * x[0] - dzdy * y[0] +
+                        0.5f * (std::abs(dzdx) + std::abs(dzdy));
+        triangle.z[1] = dzdx;
+        triangle.z[2] = dzdy;
+        triangle.maxZ = std::max({z[0], z[1], z[2]});
+        triangle.minX = minX;
+        triangle.maxX = maxX;
+        triangle.minY = minY;
+        triangle.maxY = maxY;
+    }
+
+    //pixels on the outline only count when they are covered completely,
+    //which moves the edge inwards by half a pixel along both axes. The
+    //neighbor lies across the edge when it has the same winding on screen,
+    //or the opposite one when the mesh is wound the other way there
+    const std::vector<uint32_t> &neighbors = instance.occluder->GetNeighbors();
+    for (size_t i = 0; i < count; i++) {
+        Triangle &triangle = triangles[instance.firstTriangle + i];
+        if (triangle.minX > triangle.maxX) { continue; }
+        int winding = facing[instance.firstTriangle + i];
+        for (int edge = 0; edge < 3; edge++) {
+            uint32_t neighbor = neighbors[i * 3 + edge];
+            if (neighbor != Occluder::noNeighbor) {
+                int expected = neighbor & Occluder::flippedNeighbor ? -winding
+                                                                    : winding;
+                neighbor &= ~Occluder::flippedNeighbor;
+                if (facing[instance.firstTriangle + neighbor] == expected) {
+                    continue;
+                }
+            }
+            float *values = triangle.edges[edge];
+            values[2] -= 0.5f * (std::abs(values[0]) + std::abs(values[1]));
+        }
+    }
+}
+
+void qrk::OcclusionCuller::RasterizeBin(int bin) {
+    int binMinX = (bin % binsX) * binWidth;
+    int binMinY = (bin / binsX) * binHeight;
+    int binMaxX = std::min(binMinX + binWidth, width) - 1;
+    int binMaxY = std::min(binMinY + binHeight, height) - 1;
+    for (size_t i = 0; i < triangleCount; i++) {
+        const Triangle &triangle = triangles[i];
+        int minX = std::max(triangle.minX, binMinX);
+        int maxX = std::min(triangle.maxX, binMaxX);
+        int minY = std::max(triangle.minY, binMinY);
+        int maxY = std::min(triangle.maxY, binMaxY);
+        if (minX > maxX || minY > maxY) { continue; }
+        RasterizeTriangle(triangle, minX, minY, maxX, maxY);
+    }
+
+    //farthest depth of every tile in the bin
+    for (int tileY = binMinY / tileSize; tileY <= binMaxY / tileSize;
+         tileY++) {
+        for (int tileX = binMinX / tileSize; tileX <= binMaxX / tileSize;
+             tileX++) {
+            float farthest = 0.f;
+            for (int y = 0; y < tileSize; y++) {
+                const float *row = &depth[size_t(tileY * tileSize + y) * width +
+                                          tileX * tileSize];
+                for (int x = 0; x < tileSize; x++) {
+                    farthest = std::max(farthest, row[x]);
+                }
+            }
+            tileDepth[size_t(tileY) * tilesX + tileX] = farthest;
+        }
+    }
+}
+
+void qrk::OcclusionCuller::RasterizeTriangle(const Triangle &triangle,
+                                             int minX, int minY, int maxX,
+                                             int maxY) {
+    const float(*edges)[3] = triangle.edges;
+#ifdef Q_OCCLUSION_SSE
+    //bins and rows are a multiple of 4 pixels wide, so a group starting
+    //at or before minX never reaches into the next bin
+    int startX = minX & ~3;
+    const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 maxZ = _mm_set1_ps(triangle.maxZ);
+    __m128 a[3], rowValues[3];
+    for (int edge = 0; edge < 3; edge++) {
+        a[edge] = _mm_set1_ps(edges[edge][0]);
+    }
+    const __m128 dzdx = _mm_set1_ps(triangle.z[1]);
+    for (int y = minY; y <= maxY; y++) {
+        float centerY = y + 0.5f;
+        for (int edge = 0; edge < 3; edge++) {
+            rowValues[edge] = _mm_set1_ps(edges[edge][1] * centerY +
+                                          edges[edge][2]);
+        }
+        __m128 rowZ = _mm_set1_ps(triangle.z[0] + triangle.z[2] * centerY);
+        float *row = &depth[size_t(y) * width];
+        for (int x = startX; x <= maxX; x += 4) {
+            __m128 centerX = _mm_add_ps(_mm_set1_ps(float(x)), offsets);
+            __m128 inside = _mm_cmpge_ps(
+                    _mm_add_ps(_mm_mul_ps(a[0], centerX), rowValues[0]), zero);
+            for (int edge = 1; edge < 3; edge++) {
+                __m128 value = _mm_add_ps(_mm_mul_ps(a[edge], centerX),
+                                          rowValues[edge]);
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(value, zero));
+            }
+            if (_mm_movemask_ps(inside) == 0) { continue; }
+            __m128 z = _mm_min_ps(
+                    _mm_add_ps(_mm_mul_ps(dzdx, centerX), rowZ), maxZ);
+            __m128 stored = _mm_loadu_ps(row + x);
+            __m128 nearest = _mm_min_ps(stored, z);
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest),
+                                             _mm_andnot_ps(inside, stored)));
+        }
+    }
+#else
+    for (int y = minY; y <= maxY; y++) {
+        float centerY = y + 0.5f;
+        float *row = &depth[size_t(y) * width];
+        for (int x = minX; x <= maxX; x++) {
+            float centerX = x + 0.5f;
+            bool inside = true;
+            for (int edge = 0; edge < 3 && inside; edge++) {
+                inside = edges[edge][0] * centerX + edges[edge][1] * centerY +
+                                 edges[edge][2] >=
+                         0.f;
+            }
+            if (!inside) { continue; }
+            float z = std::min(triangle.z[0] + triangle.z[1] * centerX +
+                                       triangle.z[2] * centerY,
+                               triangle.maxZ);
+            row[x] = std::min(row[x], z);
+        }
+    }
+#endif
+}
+
+bool qrk::OcclusionCuller::IsVisible(const qrk::AABB &box) const {
+    float left = FLT_MAX, right = -FLT_MAX, top = FLT_MAX, bottom = -FLT_MAX;
+    float nearest = FLT_MAX;
+    for (int corner = 0; corner < 8; corner++) {
+        float position[3] = {(corner & 1) ? box.max[0] : box.min[0],
+                             (corner & 2) ? box.max[1] : box.min[1],
+                             (corner & 4) ? box.max[2] : box.min[2]};
+        float clip[4];
+        Transform(viewProjection, position, clip);
+        //nothing is known about boxes reaching past the near plane
+        if (!InFront(clip)) { return true; }
+        float inverseW = 1.f / clip[3];
+        float x = (clip[0] * inverseW * 0.5f + 0.5f) * width;
+        float y = (0.5f - clip[1] * inverseW * 0.5f) * height;
+        left = std::min(left, x);
+        right = std::max(right, x);
+        top = std::min(top, y);
+        bottom = std::max(bottom, y);
+        nearest = std::min(nearest, clip[2] * inverseW);
+    }
+    if (right < 0.f || left > width || bottom < 0.f || top > height ||
+        nearest > 1.f) {
+        return false;
+    }
+
+    //every pixel the box touches
+    int minX = std::max(static_cast<int>(std::floor(left)), 0);
+    int minY = std::max(static_cast<int>(std::floor(top)), 0);
+    int maxX = std::min(static_cast<int>(std::ceil(right)) - 1, width - 1);
+    int maxY = std::min(static_cast<int>(std::ceil(bottom)) - 1, height - 1);
+    maxX = std::max(maxX, minX);
+    maxY = std::max(maxY, minY);
+    for (int tileY = minY / tileSize; tileY <= maxY / tileSize; tileY++) {
+        for (int tileX = minX / tileSize; tileX <= maxX / tileSize; tileX++) {
+            if (nearest > tileDepth[size_t(tileY) * tilesX + tileX]) {
+                continue;
+            }
+            int startX = std::max(minX, tileX * tileSize);
+            int endX = std::min(maxX, tileX * tileSize + tileSize - 1);
+            int startY = std::max(minY, tileY * tileSize);
+            int endY = std::min(maxY, tileY * tileSize + tileSize - 1);
+            for (int y = startY; y <= endY; y++) {
+                const float *row = &depth[size_t(y) * width];
+                for (int x = startX; x <= endX; x++) {
+                    if (nearest <= row[x]) { return true; }
+                }
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,172 @@
+#include "../include/pass_profiler.hpp"
+#include <algorithm>
+
+namespace {
+float Milliseconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<float, std::milli>(duration).count();
+}
+float Milliseconds(GLuint64 begin, GLuint64 end) {
+    return static_cast<float>(end - begin) / 1000000.f;
+}
+}// namespace
+
+const char *qrk::PassName(DrawPass pass) {
+    switch (pass) {
+        case Q_PASS_OPAQUE:
+            return "3d";
+        case Q_PASS_2D:
+            return "2d";
+        case Q_PASS_UI:
+            return "UI";
+        case Q_PASS_TEXT:
+            return "text";
+        case Q_PASS_DEPTH:
+            return "depth";
+    }
+    return "unknown";
+}
+
+void qrk::PassProfiler::Create(int latency, size_t _historySize) {
+    if (!sets.empty()) { Delete(); }
+    sets.resize(latency);
+    for (QuerySet &set : sets) {
+        glCreateQueries(GL_TIMESTAMP, queryCount, set.queries);
+        glCreateQueries(GL_SAMPLES_PASSED, Q_PASS_COUNT, set.samples);
+    }
+    current = 0;
+    std::lock_guard<std::mutex> lock(historyMutex);
+    history.assign(_historySize, FrameTiming());
+    historyStart = 0;
+    historyCount = 0;
+}
+
+void qrk::PassProfiler::Delete() {
+    for (QuerySet &set : sets) {
+        glDeleteQueries(queryCount, set.queries);
+        glDeleteQueries(Q_PASS_COUNT, set.samples);
+    }
+    sets.clear();
+}
+
+void qrk::PassProfiler::BeginFrame() {
+    if (sets.empty()) { return; }
+    current = (current + 1) % static_cast<int>(sets.size());
+    QuerySet &set = sets[current];
+    Collect(set);
+    set.timing = FrameTiming();
+    set.timing.frame = frameCount++;
+    std::fill(std::begin(set.passUsed), std::end(set.passUsed), false);
+    glQueryCounter(set.queries[0], GL_TIMESTAMP);
+    frameStart = clock::now();
+}
+
+void qrk::PassProfiler::EndFrame() {
+    if (sets.empty()) { return; }
+    QuerySet &set = sets[current];
+    glQueryCounter(set.queries[1], GL_TIMESTAMP);
+    set.timing.total.cpu = Milliseconds(clock::now() - frameStart);
+    set.pending = true;
+}
+
+void qrk::PassProfiler::BeginPass(DrawPass pass) {
+    if (sets.empty()) { return; }
+    QuerySet &set = sets[current];
+    glQueryCounter(set.queries[2 + pass * 2], GL_TIMESTAMP);
+    glBeginQuery(GL_SAMPLES_PASSED, set.samples[pass]);
+    set.passUsed[pass] = true;
+    passStart[pass] = clock::now();
+}
+
+void qrk::PassProfiler::EndPass(DrawPass pass) {
+    if (sets.empty()) { return; }
+    QuerySet &set = sets[current];
+    glEndQuery(GL_SAMPLES_PASSED);
+    glQueryCounter(set.queries[3 + pass * 2], GL_TIMESTAMP);
+    set.timing.passes[pass].cpu +=
+            Milliseconds(clock::now() - passStart[pass]);
+}
+
+void qrk::PassProfiler::Collect(QuerySet &set) {
+    if (!set.pending) { return; }
+    set.pending = false;
+    //timestamps complete in order, the frame end is written last
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(set.queries[1], GL_QUERY_RESULT_AVAILABLE,
+                       &available);
+    if (available == GL_TRUE) {
+        GLuint64 timestamps[queryCount];
+        for (size_t i = 0; i < queryCount; i++) {
+            if (i >= 2 && !set.passUsed[(i - 2) / 2]) { continue; }
+            glGetQueryObjectui64v(set.queries[i], GL_QUERY_RESULT,
+                                  &timestamps[i]);
+        }
+        set.timing.total.gpu = Milliseconds(timestamps[0], timestamps[1]);
+        for (size_t pass = 0; pass < Q_PASS_COUNT; pass++) {
+            if (!set.passUsed[pass]) { continue; }
+            set.timing.passes[pass].gpu = Milliseconds(
+                    timestamps[2 + pass * 2], timestamps[3 + pass * 2]);
+            glGetQueryObjectui64v(set.samples[pass], GL_QUERY_RESULT,
+                                  &set.timing.passes[pass].samples);
+        }
+        set.timing.gpuValid = true;
+    }
+
+    std::lock_guard<std::mutex> lock(historyMutex);
+    if (history.empty()) { return; }
+    history[(historyStart + historyCount) % history.size()] = set.timing;
+    if (historyCount < history.size()) {
+        historyCount++;
+    } else {
+        historyStart = (historyStart + 1) % history.size();
+    }
+}
+
+std::vector<qrk::FrameTiming> qrk::PassProfiler::GetHistory() const {
+    std::lock_guard<std::mutex> lock(historyMutex);
+    std::vector<FrameTiming> frames;
+    frames.reserve(historyCount);
+    for (size_t age = 0; age < historyCount; age++) {
+        frames.push_back(GetHistoryFrame(age));
+    }
+    return frames;
+}
+
+qrk::FrameTiming qrk::PassProfiler::GetLatest() const {
+    std::lock_guard<std::mutex> lock(historyMutex);
+    if (historyCount == 0) { return FrameTiming(); }
+    return GetHistoryFrame(historyCount - 1);
+}
+
+qrk::FrameTiming qrk::PassProfiler::GetAverage() const {
+    std::lock_guard<std::mutex> lock(historyMutex);
+    FrameTiming average;
+    if (historyCount == 0) { return average; }
+    size_t gpuFrames = 0;
+    for (size_t age = 0; age < historyCount; age++) {
+        const FrameTiming &frame = GetHistoryFrame(age);
+        average.total.cpu += frame.total.cpu;
+        for (size_t pass = 0; pass < Q_PASS_COUNT; pass++) {
+            average.passes[pass].cpu += frame.passes[pass].cpu;
+        }
+        if (!frame.gpuValid) { continue; }
+        gpuFrames++;
+        average.total.gpu += frame.total.gpu;
+        for (size_t pass = 0; pass < Q_PASS_COUNT; pass++) {
+            average.passes[pass].gpu += frame.passes[pass].gpu;
+            average.passes[pass].samples += frame.passes[pass].samples;
+        }
+    }
+    float cpuScale = 1.f / static_cast<float>(historyCount);
+    float gpuScale =
+            gpuFrames == 0 ? 0.f : 1.f / static_cast<float>(gpuFrames);
+    average.total.cpu *= cpuScale;
+    average.total.gpu *= gpuScale;
+    for (PassTiming &pass : average.passes) {
+        pass.cpu *= cpuScale;
+        pass.gpu *= gpuScale;
+        if (gpuFrames != 0) { pass.samples /= gpuFrames; }
+    }
+    average.frame = GetHistoryFrame(historyCount - 1).frame;
+    average.gpuValid = gpuFrames != 0;
+    return average;
+}
\ No newline at end of file
@@ -7,8 +7,7 @@ void qrk::debug::OpenLogFile(const std::string &path) {
     fullPath << path << "/log_" << time(nullptr) << ".txt";
     logFile.open(fullPath.str());
     if (!logFile.is_open()) {
-        MessageBox(0, "Failed to open log file", "Warning",
-                   MB_OK | MB_ICONEXCLAMATION);
+        ShowWarningBox("Failed to open log file");
     }
 }
 void qrk::debug::Log(const std::string &log) {
@@ -0,0 +1,90 @@
+#include "../include/render_window.hpp"
+
+qrk::RenderWindow::~RenderWindow() {
+    if (threaded) {
+        StopRenderThread();
+        //the renderer releases its buffers on this thread
+        window.MakeContextCurrent();
+    }
+}
+
+void qrk::RenderWindow::Draw() {
+    if (!threaded) {
+        renderer.Draw();
+        window.SwapWindowBuffers();
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(frameMutex);
+    frameDone.wait(lock, [this] { return !framePending; });
+    //the recorded draws move to the renderer, recording continues into
+    //a list recycled from an earlier frame
+    renderer.SubmitDrawList(recording, 0);
+    renderer.EndRecording();
+    frameClear = clearRequested;
+    frameSize = window.GetSize();
+    clearRequested = false;
+    framePending = true;
+    lock.unlock();
+    frameReady.notify_one();
+}
+
+void qrk::RenderWindow::Close() {
+    if (threaded) {
+        StopRenderThread();
+        window.MakeContextCurrent();
+        threaded = false;
+    }
+    window.Close();
+}
+
+void qrk::RenderWindow::StartRenderThread() {
+    window.SetContextDetached(true);
+    window.ReleaseContext();
+    renderThread = std::thread(&RenderWindow::RenderLoop, this);
+}
+
+void qrk::RenderWindow::StopRenderThread() {
+    if (!renderThread.joinable()) { return; }
+    {
+        std::lock_guard<std::mutex> lock(frameMutex);
+        stopping = true;
+    }
+    frameReady.notify_one();
+    renderThread.join();
+    window.SetContextDetached(false);
+}
+
+void qrk::RenderWindow::RenderLoop() {
+    qrk::vec2u viewport = qrk::vec2u({0, 0});
+    while (true) {
+        bool clear;
+        qrk::vec2u size;
+        {
+            std::unique_lock<std::mutex> lock(frameMutex);
+            frameReady.wait(lock, [this] { return framePending || stopping; });
+            if (!framePending) { return; }
+            clear = frameClear;
+            size = frameSize;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(contextMutex);
+            window.MakeContextCurrent();
+            if (size.x() != viewport.x() || size.y() != viewport.y()) {
+                glViewport(0, 0, size.x(), size.y());
+                viewport = size;
+            }
+            if (clear) { window.Clear(); }
+            renderer.Draw(size);
+            window.SwapWindowBuffers();
+            window.ReleaseContext();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(frameMutex);
+            framePending = false;
+        }
+        frameDone.notify_one();
+    }
+}
\ No newline at end of file
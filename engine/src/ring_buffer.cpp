@@ -0,0 +1,170 @@
+#include "../include/ring_buffer.hpp"
+#include "../include/gl_state.hpp"
+
+namespace {
+//regions start on a multiple of the largest offset alignment GL allows, so
+//offsets aligned within a region stay aligned in the buffer
+constexpr GLsizeiptr Q_RING_REGION_ALIGNMENT = 256;
+
+GLsizeiptr Align(GLsizeiptr value, GLsizeiptr alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+}// namespace
+
+void qrk::assets::RingBuffer::Create(GLsizeiptr _regionSize,
+                                     int _regionCount) {
+    if (buffer != 0) { Delete(); }
+    regionSize = Align(_regionSize, Q_RING_REGION_ALIGNMENT);
+    regionCount = _regionCount;
+    region = 0;
+    head = 0;
+    frameSize = 0;
+    fences.assign(regionCount, nullptr);
+    mapped = CreateMapped(buffer, regionSize * regionCount);
+    target = buffer;
+}
+
+void qrk::assets::RingBuffer::Delete() {
+    if (buffer == 0) { return; }
+    for (GLsync &fence : fences) {
+        if (fence != nullptr) { glDeleteSync(fence); }
+        fence = nullptr;
+    }
+    //deleting a mapped buffer unmaps it, draws still using it keep it alive
+    for (Overflow &overflow : overflows) {
+        qrk::glState.DeleteBuffers(1, &overflow.buffer);
+    }
+    overflows.clear();
+    for (Retired &old : retired) {
+        glDeleteSync(old.fence);
+        qrk::glState.DeleteBuffers(1, &old.buffer);
+    }
+    retired.clear();
+    qrk::glState.DeleteBuffers(1, &buffer);
+    buffer = 0;
+    target = 0;
+    mapped = nullptr;
+}
+
+void qrk::assets::RingBuffer::BeginFrame(GLsizeiptr reserve) {
+    if (buffer == 0) { return; }
+    ReleaseRetired();
+    //a frame that overflowed is likely to be followed by a similar one
+    reserve = std::max(reserve, frameSize);
+    region = (region + 1) % regionCount;
+    head = 0;
+    frameSize = 0;
+    if (reserve > regionSize) {
+        //frames in flight keep reading the old buffer until their fences
+        //signal, the new one is unused and needs no wait
+        for (GLsync &fence : fences) {
+            if (fence != nullptr) { glDeleteSync(fence); }
+            fence = nullptr;
+        }
+        Retire(buffer);
+        regionSize = Align(std::max(reserve, regionSize * 2),
+                           Q_RING_REGION_ALIGNMENT);
+        region = 0;
+        mapped = CreateMapped(buffer, regionSize * regionCount);
+        target = buffer;
+        return;
+    }
+    target = buffer;
+    WaitForRegion(region);
+}
+
+void qrk::assets::RingBuffer::EndFrame() {
+    if (buffer == 0) { return; }
+    if (fences[region] != nullptr) { glDeleteSync(fences[region]); }
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    frameSize += head;
+    for (Overflow &overflow : overflows) {
+        frameSize += overflow.head + Q_RING_REGION_ALIGNMENT;
+        Retire(overflow.buffer);
+    }
+    overflows.clear();
+}
+
+GLintptr qrk::assets::RingBuffer::Write(const void *data, GLsizeiptr size,
+                                        GLint alignment) {
+    GLsizeiptr start = Align(head, alignment);
+    if (start + size <= regionSize) {
+        GLintptr offset = region * regionSize + start;
+        std::memcpy(mapped + offset, data, size);
+        head = start + size;
+        target = buffer;
+        return offset;
+    }
+
+    //the frame outgrew its region. Everything written so far stays where
+    //it is, the rest of the frame continues in a new buffer and the next
+    //frame grows the regions
+    if (overflows.empty() ||
+        Align(overflows.back().head, alignment) + size >
+                overflows.back().size) {
+        GLsizeiptr overflowSize = Align(std::max(regionSize, size + alignment),
+                                        Q_RING_REGION_ALIGNMENT);
+        qrk::debug::LogWarning("Ring buffer region overflow, continuing in a " +
+                               std::to_string(overflowSize) + " byte buffer");
+        Overflow overflow = {0, nullptr, overflowSize, 0};
+        overflow.mapped = CreateMapped(overflow.buffer, overflowSize);
+        overflows.push_back(overflow);
+    }
+    Overflow &overflow = overflows.back();
+    GLintptr offset = Align(overflow.head, alignment);
+    std::memcpy(overflow.mapped + offset, data, size);
+    overflow.head = offset + size;
+    target = overflow.buffer;
+    return offset;
+}
+
+void qrk::assets::RingBuffer::WaitForRegion(int index) {
+    GLsync &fence = fences[index];
+    if (fence == nullptr) { return; }
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    while (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+        if (result == GL_WAIT_FAILED) {
+            qrk::debug::LogError("Ring buffer fence wait failed");
+            break;
+        }
+        result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                  1000000);
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void qrk::assets::RingBuffer::Retire(GLuint retiredBuffer) {
+    retired.push_back(
+            {retiredBuffer, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0)});
+}
+
+void qrk::assets::RingBuffer::ReleaseRetired() {
+    auto released = std::remove_if(
+            retired.begin(), retired.end(), [](Retired &old) {
+                if (glClientWaitSync(old.fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+                    return false;
+                }
+                glDeleteSync(old.fence);
+                qrk::glState.DeleteBuffers(1, &old.buffer);
+                return true;
+            });
+    retired.erase(released, retired.end());
+}
+
+unsigned char *qrk::assets::RingBuffer::CreateMapped(GLuint &handle,
+                                                     GLsizeiptr size) {
+    const GLbitfield flags =
+            GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &handle);
+    qrk::glState.BindBuffer(GL_COPY_WRITE_BUFFER, handle);
+    glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+    auto *memory = static_cast<unsigned char *>(
+            glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+    qrk::glState.BindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    if (memory == nullptr) {
+        qrk::debug::Error("Failed to map ring buffer",
+                          qrk::debug::Q_RUNTIME_ERROR);
+    }
+    return memory;
+}
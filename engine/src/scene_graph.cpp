@@ -0,0 +1,315 @@
+#include "../include/scene_graph.hpp"
+#include "../include/qrk_debug.hpp"
+#include <algorithm>
+
+namespace {
+constexpr uint32_t unknownDepth = UINT32_MAX;
+
+//model matrices are affine, so the last row of the product stays 0 0 0 1
+void MultiplyAffine(const qrk::mat4 &lhs, const qrk::mat4 &rhs,
+                    qrk::mat4 &result) {
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 4; j++) {
+            result.data[i][j] = lhs.data[i][0] * rhs.data[0][j] +
+                                lhs.data[i][1] * rhs.data[1][j] +
+                                lhs.data[i][2] * rhs.data[2][j];
+        }
+        result.data[i][3] += lhs.data[i][3];
+    }
+    result.data[3] = {0, 0, 0, 1};
+}
+
+template<typename T>
+void Permute(std::vector<T> &values, const std::vector<uint32_t> &order) {
+    std::vector<T> sorted;
+    sorted.reserve(order.size());
+    for (uint32_t index : order) { sorted.push_back(std::move(values[index])); }
+    values.swap(sorted);
+}
+}// namespace
+
+qrk::SceneNode qrk::SceneGraph::Add(SceneNode parent) {
+    uint32_t parentIndex = noParent;
+    uint32_t depth = 0;
+    if (parent.IsValid()) {
+        if (!Contains(parent)) {
+            qrk::debug::Warning(
+                    "Adding a node under a parent that is not in the scene");
+            return SceneNode();
+        }
+        parentIndex = GetIndex(parent);
+        depth = depths[parentIndex] + 1;
+    }
+
+    uint32_t slot;
+    if (freeSlots.empty()) {
+        slot = static_cast<uint32_t>(slotNodes.size());
+        slotNodes.push_back(0);
+        generations.push_back(0);
+    } else {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    uint32_t index = static_cast<uint32_t>(nodeSlots.size());
+    slotNodes[slot] = index;
+
+    //appending keeps the depth order as long as no level above grows
+    if (!orderDirty && !depths.empty() && depth < depths.back()) {
+        orderDirty = true;
+    }
+    if (!orderDirty) {
+        if (levelStarts.empty()) { levelStarts.push_back(0); }
+        if (depth + 2 > levelStarts.size()) {
+            levelStarts.push_back(index + 1);
+        } else {
+            levelStarts.back() = index + 1;
+        }
+    }
+
+    nodeSlots.push_back(slot);
+    parents.push_back(parentIndex);
+    depths.push_back(depth);
+    positions.push_back(qrk::vec3f({0, 0, 0}));
+    rotations.push_back(qrk::vec3f({0, 0, 0}));
+    scales.push_back(qrk::vec3f({1, 1, 1}));
+    localMatrices.push_back(qrk::identity4());
+    worldMatrices.push_back(qrk::identity4());
+    localDirty.push_back(0);
+    worldDirty.push_back(1);
+    removed.push_back(0);
+    changed.push_back(0);
+    anyDirty = true;
+    return {slot, generations[slot]};
+}
+
+void qrk::SceneGraph::Remove(SceneNode node) {
+    if (!Contains(node)) {
+        qrk::debug::Warning("Removing a node that is not in the scene");
+        return;
+    }
+    uint32_t index = GetIndex(node);
+    removed[index] = 1;
+    //the slot is free right away, the node leaves the arrays on Update
+    nodeSlots[index] = noParent;
+    generations[node.slot]++;
+    freeSlots.push_back(node.slot);
+    orderDirty = true;
+}
+
+bool qrk::SceneGraph::SetParent(SceneNode node, SceneNode parent) {
+    if (!Contains(node) || (parent.IsValid() && !Contains(parent))) {
+        qrk::debug::Warning("Parenting a node that is not in the scene");
+        return false;
+    }
+    uint32_t index = GetIndex(node);
+    uint32_t parentIndex = parent.IsValid() ? GetIndex(parent) : noParent;
+    for (uint32_t ancestor = parentIndex; ancestor != noParent;
+         ancestor = parents[ancestor]) {
+        if (ancestor == index) {
+            qrk::debug::Warning("Parenting a node to its own descendant");
+            return false;
+        }
+    }
+    parents[index] = parentIndex;
+    worldDirty[index] = 1;
+    anyDirty = true;
+    orderDirty = true;
+    return true;
+}
+
+qrk::SceneNode qrk::SceneGraph::GetParent(SceneNode node) const {
+    if (!Contains(node)) { return SceneNode(); }
+    uint32_t parentIndex = parents[GetIndex(node)];
+    if (parentIndex == noParent) { return SceneNode(); }
+    uint32_t slot = nodeSlots[parentIndex];
+    if (slot == noParent) { return SceneNode(); }
+    return {slot, generations[slot]};
+}
+
+void qrk::SceneGraph::SetPosition(SceneNode node,
+                                  const qrk::vec3f &position) {
+    if (!Contains(node)) {
+        qrk::debug::Warning("Moving a node that is not in the scene");
+        return;
+    }
+    uint32_t index = GetIndex(node);
+    positions[index] = position;
+    localDirty[index] = 1;
+    anyDirty = true;
+}
+
+void qrk::SceneGraph::SetRotation(SceneNode node,
+                                  const qrk::vec3f &rotation) {
+    if (!Contains(node)) {
+        qrk::debug::Warning("Rotating a node that is not in the scene");
+        return;
+    }
+    uint32_t index = GetIndex(node);
+    rotations[index] = rotation;
+    localDirty[index] = 1;
+    anyDirty = true;
+}
+
+void qrk::SceneGraph::SetScale(SceneNode node, const qrk::vec3f &scale) {
+    if (!Contains(node)) {
+        qrk::debug::Warning("Scaling a node that is not in the scene");
+        return;
+    }
+    uint32_t index = GetIndex(node);
+    scales[index] = scale;
+    localDirty[index] = 1;
+    anyDirty = true;
+}
+
+qrk::vec3f qrk::SceneGraph::GetPosition(SceneNode node) const {
+    if (!Contains(node)) { return qrk::vec3f({0, 0, 0}); }
+    return positions[GetIndex(node)];
+}
+
+qrk::vec3f qrk::SceneGraph::GetRotation(SceneNode node) const {
+    if (!Contains(node)) { return qrk::vec3f({0, 0, 0}); }
+    return rotations[GetIndex(node)];
+}
+
+qrk::vec3f qrk::SceneGraph::GetScale(SceneNode node) const {
+    if (!Contains(node)) { return qrk::vec3f({1, 1, 1}); }
+    return scales[GetIndex(node)];
+}
+
+void qrk::SceneGraph::Update(qrk::JobPool *jobs) {
+    if (orderDirty) { Reorder(); }
+    if (!anyDirty) {
+        //nothing moved, only clear what the last update reported
+        if (anyChanged) {
+            std::fill(changed.begin(), changed.end(), 0);
+            anyChanged = false;
+        }
+        return;
+    }
+
+    if (jobs == nullptr) {
+        UpdateRange(0, Size());
+    } else {
+        //a level only reads the levels above it, which are done
+        for (size_t level = 0; level + 1 < levelStarts.size(); level++) {
+            size_t first = levelStarts[level];
+            size_t count = levelStarts[level + 1] - first;
+            jobs->ParallelFor(count, 1024, [&](size_t begin, size_t end) {
+                UpdateRange(first + begin, first + end);
+            });
+        }
+    }
+    anyDirty = false;
+    anyChanged = true;
+}
+
+const qrk::mat4 *qrk::SceneGraph::GetWorldMatrix(SceneNode node) const {
+    if (!Contains(node)) { return nullptr; }
+    return &worldMatrices[GetIndex(node)];
+}
+
+bool qrk::SceneGraph::IsChanged(SceneNode node) const {
+    return Contains(node) && changed[GetIndex(node)] != 0;
+}
+
+void qrk::SceneGraph::Reorder() {
+    size_t count = nodeSlots.size();
+
+    //depth of every node from its ancestors, walking up only until a node
+    //with a known depth. Children of removed nodes are removed with them
+    std::fill(depths.begin(), depths.end(), unknownDepth);
+    uint32_t levelCount = 0;
+    for (uint32_t node = 0; node < count; node++) {
+        if (depths[node] != unknownDepth) { continue; }
+        walk.clear();
+        uint32_t ancestor = node;
+        while (ancestor != noParent && depths[ancestor] == unknownDepth) {
+            walk.push_back(ancestor);
+            ancestor = parents[ancestor];
+        }
+        uint32_t depth = ancestor == noParent ? 0 : depths[ancestor] + 1;
+        bool removedAbove = ancestor != noParent && removed[ancestor];
+        for (size_t i = walk.size(); i-- > 0; depth++) {
+            uint32_t current = walk[i];
+            depths[current] = depth;
+            removedAbove = removedAbove || removed[current];
+            removed[current] = removedAbove;
+        }
+        levelCount = std::max(levelCount, depth);
+    }
+
+    //counting sort by depth keeps the order within a level
+    levelStarts.assign(levelCount + 1, 0);
+    for (uint32_t node = 0; node < count; node++) {
+        if (!removed[node]) { levelStarts[depths[node] + 1]++; }
+    }
+    for (size_t level = 1; level < levelStarts.size(); level++) {
+        levelStarts[level] += levelStarts[level - 1];
+    }
+    size_t kept = levelStarts.back();
+    order.resize(kept);
+    newIndices.assign(count, noParent);
+    std::vector<size_t> next(levelStarts.begin(), levelStarts.end() - 1);
+    for (uint32_t node = 0; node < count; node++) {
+        if (removed[node]) {
+            //removed with an ancestor, its slot is still taken
+            uint32_t slot = nodeSlots[node];
+            if (slot != noParent) {
+                generations[slot]++;
+                freeSlots.push_back(slot);
+            }
+            continue;
+        }
+        size_t index = next[depths[node]]++;
+        order[index] = node;
+        newIndices[node] = static_cast<uint32_t>(index);
+    }
+    while (levelStarts.size() > 1 &&
+           levelStarts[levelStarts.size() - 2] == kept) {
+        levelStarts.pop_back();
+    }
+
+    Permute(nodeSlots, order);
+    Permute(parents, order);
+    Permute(depths, order);
+    Permute(positions, order);
+    Permute(rotations, order);
+    Permute(scales, order);
+    Permute(localMatrices, order);
+    Permute(worldMatrices, order);
+    Permute(localDirty, order);
+    Permute(worldDirty, order);
+    removed.assign(kept, 0);
+    changed.assign(kept, 0);
+    for (size_t index = 0; index < kept; index++) {
+        slotNodes[nodeSlots[index]] = static_cast<uint32_t>(index);
+        if (parents[index] != noParent) {
+            parents[index] = newIndices[parents[index]];
+        }
+    }
+    orderDirty = false;
+    //every node reports its changes again
+    anyDirty = true;
+}
+
+void qrk::SceneGraph::UpdateRange(size_t begin, size_t end) {
+    for (size_t node = begin; node < end; node++) {
+        uint32_t parent = parents[node];
+        bool dirty = localDirty[node] || worldDirty[node] ||
+                     (parent != noParent && changed[parent]);
+        changed[node] = dirty;
+        if (!dirty) { continue; }
+        if (localDirty[node]) {
+            localMatrices[node] = qrk::CreateModelMatrix(
+                    positions[node], rotations[node], scales[node]);
+            localDirty[node] = 0;
+        }
+        worldDirty[node] = 0;
+        if (parent == noParent) {
+            worldMatrices[node].data = localMatrices[node].data;
+        } else {
+            MultiplyAffine(worldMatrices[parent], localMatrices[node],
+                           worldMatrices[node]);
+        }
+    }
+}
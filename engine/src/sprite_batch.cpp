@@ -0,0 +1,94 @@
+#include "../include/sprite_batch.hpp"
+#include "../include/draw.hpp"
+#include "../include/gl_state.hpp"
+#include <cstddef>
+
+void qrk::SpriteBatch::Create() {
+    //two triangles covering -1 to 1, vertex position then texture position
+    const GLfloat quad[] = {
+            1,  1,  1, 0, -1, 1,  0, 0, -1, -1, 0, 1,
+            -1, -1, 0, 1, 1,  -1, 1, 1, 1,  1,  1, 0,
+    };
+    glCreateVertexArrays(1, &VAO);
+    glCreateBuffers(1, &quadVBO);
+    glNamedBufferStorage(quadVBO, sizeof(quad), quad, 0);
+    glCreateBuffers(1, &instanceVBO);
+
+    //binding 0 holds the quad, binding 1 advances once per sprite
+    glVertexArrayVertexBuffer(VAO, 0, quadVBO, 0, 4 * sizeof(GLfloat));
+    glVertexArrayVertexBuffer(VAO, 1, instanceVBO, 0, sizeof(SpriteInstance));
+    glVertexArrayBindingDivisor(VAO, 1, 1);
+
+    qrk::assets::SetVertexFormat(
+            VAO, {{0, 2, 0},
+                  {1, 2, 2 * sizeof(GLfloat)},
+                  {2, 4, offsetof(SpriteInstance, position), 1},
+                  {3, 4, offsetof(SpriteInstance, uvRect), 1},
+                  {4, 4, offsetof(SpriteInstance, color), 1},
+                  {5, 2, offsetof(SpriteInstance, rotation), 1}});
+
+    const unsigned char white[] = {255, 255, 255, 255};
+    whiteTexture.Create(1, 1);
+    whiteTexture.Update(0, 0, 1, 1, white);
+}
+
+void qrk::SpriteBatch::Draw(std::vector<qrk::DrawData_2D> &queue,
+                            const std::vector<qrk::SortKey> &order,
+                            qrk::assets::Program &program,
+                            qrk::vec2f screenSize, qrk::JobPool &jobs,
+                            qrk::assets::RingBuffer *stream) {
+    if (order.empty()) { return; }
+
+    instances.resize(order.size());
+    jobs.ParallelFor(order.size(), 1024, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            qrk::DrawData_2D &sprite = queue[order[i].index];
+            SpriteInstance &instance = instances[i];
+            instance.position.data = sprite.position.data;
+            instance.size.data = sprite.size.data;
+            instance.uvRect.data = sprite.uvRect.data;
+            instance.color.data = {sprite.color.r, sprite.color.g,
+                                   sprite.color.b, sprite.color.a};
+            instance.rotation = sprite.rotation;
+            instance.zLayer = sprite.zLayer;
+        }
+    });
+
+    GLsizeiptr size = instances.size() * sizeof(SpriteInstance);
+    if (stream != nullptr) {
+        GLintptr offset =
+                stream->Write(instances.data(), size, sizeof(SpriteInstance));
+        glVertexArrayVertexBuffer(VAO, 1, stream->GetHandle(), offset,
+                                  sizeof(SpriteInstance));
+    } else {
+        //orphan the old storage instead of waiting for the previous frame
+        if (size > instanceCapacity) { instanceCapacity = size * 2; }
+        glNamedBufferData(instanceVBO, instanceCapacity, nullptr,
+                          GL_STREAM_DRAW);
+        glNamedBufferSubData(instanceVBO, 0, size, instances.data());
+        glVertexArrayVertexBuffer(VAO, 1, instanceVBO, 0,
+                                  sizeof(SpriteInstance));
+    }
+
+    //the vertex array stays bound for the next pass, the renderer unbinds
+    //it at the end of the frame
+    qrk::glState.BindVertexArray(VAO);
+    program.UseProgram();
+    qrk::glState.Uniform2f(0, screenSize.x(), screenSize.y());
+    size_t runStart = 0;
+    while (runStart < order.size()) {
+        qrk::Texture2D *texture = queue[order[runStart].index].texture;
+        size_t runEnd = runStart + 1;
+        while (runEnd < order.size() &&
+               queue[order[runEnd].index].texture == texture) {
+            runEnd++;
+        }
+
+        if (texture == nullptr) { texture = &whiteTexture; }
+        texture->BindTexture();
+        glDrawArraysInstancedBaseInstance(
+                GL_TRIANGLES, 0, 6, static_cast<GLsizei>(runEnd - runStart),
+                static_cast<GLuint>(runStart));
+        runStart = runEnd;
+    }
+}
@@ -1,4 +1,5 @@
 #include "../include/texture.hpp"
+#include "../include/gl_state.hpp"
 
 void qrk::Image::LoadFromFile(const std::string &path) {
     this->imageData = stbi_load(path.c_str(), &this->width, &this->height,
@@ -35,9 +36,9 @@ void qrk::Texture2D::LoadFromFile(const std::string &path,
 
     if (!imageData) { qrk::debug::Error("Failed to load image: " + path, 10); }
 
-    glActiveTexture(GL_TEXTURE0);
+    qrk::glState.ActiveTexture(GL_TEXTURE0);
     glGenTextures(1, &this->texture);
-    glBindTexture(GL_TEXTURE_2D, this->texture);
+    qrk::glState.BindTexture(GL_TEXTURE_2D, this->texture);
 
     switch (channels) {
         case STBI_grey:
@@ -74,9 +75,9 @@ void qrk::Texture2D::LoadFromImage(qrk::Image &image,
                             "without explicitly deleting the object");
         DeleteTexture();
     }
-    glActiveTexture(GL_TEXTURE0);
+    qrk::glState.ActiveTexture(GL_TEXTURE0);
     glGenTextures(1, &this->texture);
-    glBindTexture(GL_TEXTURE_2D, this->texture);
+    qrk::glState.BindTexture(GL_TEXTURE_2D, this->texture);
 
     switch (image.channels) {
         case STBI_grey:
@@ -117,11 +118,38 @@ void qrk::Texture2D::LoadFromImage(qrk::Image &image,
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, settings.nearFilter);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, settings.farFilter);
 }
+void qrk::Texture2D::Create(int width, int height,
+                            const qrk::Texture2DSettings &settings,
+                            int levels) {
+    if (this->texture != 0) { DeleteTexture(); }
+    qrk::glState.ActiveTexture(GL_TEXTURE0);
+    glGenTextures(1, &this->texture);
+    qrk::glState.BindTexture(GL_TEXTURE_2D, this->texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, settings.wrap_s);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, settings.wrap_t);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, settings.nearFilter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, settings.farFilter);
+    //the levels past the first are allocated by the first GenerateMipmaps
+    if (levels > 1) { glGenerateMipmap(GL_TEXTURE_2D); }
+}
+void qrk::Texture2D::Update(int x, int y, int width, int height,
+                            const unsigned char *pixels) {
+    BindTexture();
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGBA,
+                    GL_UNSIGNED_BYTE, pixels);
+}
+void qrk::Texture2D::GenerateMipmaps() {
+    BindTexture();
+    glGenerateMipmap(GL_TEXTURE_2D);
+}
 void qrk::Texture2D::DeleteTexture() {
-    glDeleteTextures(1, &this->texture);
+    qrk::glState.DeleteTextures(1, &this->texture);
     this->texture = 0;
 }
 void qrk::Texture2D::BindTexture() {
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, this->texture);
+    qrk::glState.ActiveTexture(GL_TEXTURE0);
+    qrk::glState.BindTexture(GL_TEXTURE_2D, this->texture);
 }
\ No newline at end of file
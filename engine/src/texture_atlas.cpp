@@ -0,0 +1,163 @@
+#include "../include/texture_atlas.hpp"
+#include <algorithm>
+
+qrk::TextureAtlas::TextureAtlas(const qrk::TextureAtlasSettings &_settings)
+    : settings(_settings) {
+    settings.mipLevels = std::max(settings.mipLevels, 1);
+    cellSize = 1 << (settings.mipLevels - 1);
+    //bilinear filtering reads up to a pixel past the edge on every level
+    gutter = std::max(settings.padding, cellSize);
+    if (settings.pageSize < cellSize) {
+        qrk::debug::Error("Atlas pages are smaller than their smallest "
+                          "mip level",
+                          qrk::debug::Q_RUNTIME_ERROR);
+    }
+}
+
+qrk::AtlasRegion qrk::TextureAtlas::Add(const qrk::Image &image) {
+    return Add(std::vector<const qrk::Image *>{&image})[0];
+}
+
+std::vector<qrk::AtlasRegion>
+qrk::TextureAtlas::Add(const std::vector<const qrk::Image *> &images) {
+    std::vector<AtlasRegion> regions(images.size());
+    std::vector<stbrp_rect> rects;
+    rects.reserve(images.size());
+    int pageCells = settings.pageSize / cellSize;
+    auto cells = [&](int size) {
+        return (size + 2 * gutter + cellSize - 1) / cellSize;
+    };
+    for (size_t i = 0; i < images.size(); i++) {
+        const qrk::Image &image = *images[i];
+        bool validChannels = (image.channels >= STBI_grey &&
+                              image.channels <= STBI_rgb_alpha) ||
+                             image.channels == Q_TEXT_TEXTURE;
+        if (image.imageData == nullptr || image.width <= 0 ||
+            image.height <= 0 || !validChannels) {
+            qrk::debug::Error("Invalid image added to a texture atlas",
+                              qrk::debug::Q_FAILED_TO_LOAD_IMAGE);
+        }
+        stbrp_rect rect = {};
+        rect.id = static_cast<int>(i);
+        rect.w = cells(image.width);
+        rect.h = cells(image.height);
+        if (rect.w > pageCells || rect.h > pageCells) {
+            qrk::debug::Error("Image of " + std::to_string(image.width) +
+                                      "x" + std::to_string(image.height) +
+                                      " does not fit on an atlas page",
+                              qrk::debug::Q_RUNTIME_ERROR);
+        }
+        rects.push_back(rect);
+    }
+
+    //earlier pages keep their free room, only what does not fit on any of
+    //them starts a new page
+    float pageSize = static_cast<float>(settings.pageSize);
+    for (size_t pageIndex = 0; !rects.empty(); pageIndex++) {
+        Page &page = pageIndex < pages.size() ? *pages[pageIndex] : AddPage();
+        stbrp_pack_rects(&page.context, rects.data(),
+                         static_cast<int>(rects.size()));
+        for (const stbrp_rect &rect : rects) {
+            if (!rect.was_packed) { continue; }
+            const qrk::Image &image = *images[rect.id];
+            int x = rect.x * cellSize;
+            int y = rect.y * cellSize;
+            Upload(page, image, x, y, rect.w * cellSize, rect.h * cellSize);
+
+            AtlasRegion &region = regions[rect.id];
+            region.texture = &page.texture;
+            region.uvRect = qrk::vec4f(
+                    {static_cast<float>(x + gutter) / pageSize,
+                     static_cast<float>(y + gutter) / pageSize,
+                     static_cast<float>(image.width) / pageSize,
+                     static_cast<float>(image.height) / pageSize});
+            region.width = image.width;
+            region.height = image.height;
+            imageCount++;
+            imageArea += static_cast<size_t>(image.width) * image.height;
+        }
+        rects.erase(std::remove_if(rects.begin(), rects.end(),
+                                   [](const stbrp_rect &rect) {
+                                       return rect.was_packed != 0;
+                                   }),
+                    rects.end());
+    }
+    return regions;
+}
+
+qrk::AtlasRegion qrk::TextureAtlas::AddFromFile(const std::string &path) {
+    qrk::Image image(path);
+    return Add(image);
+}
+
+void qrk::TextureAtlas::GenerateMipmaps() {
+    for (std::unique_ptr<Page> &page : pages) {
+        if (!page->mipmapsDirty) { continue; }
+        page->texture.GenerateMipmaps();
+        page->mipmapsDirty = false;
+    }
+}
+
+float qrk::TextureAtlas::GetOccupancy() const {
+    if (pages.empty()) { return 0.f; }
+    double pageArea = static_cast<double>(settings.pageSize) *
+                      static_cast<double>(settings.pageSize);
+    return static_cast<float>(static_cast<double>(imageArea) /
+                              (pageArea * static_cast<double>(pages.size())));
+}
+
+qrk::TextureAtlas::Page &qrk::TextureAtlas::AddPage() {
+    auto page = std::make_unique<Page>();
+    page->texture.Create(settings.pageSize, settings.pageSize,
+                         settings.filtering, settings.mipLevels);
+    int pageCells = settings.pageSize / cellSize;
+    page->nodes.resize(pageCells);
+    stbrp_init_target(&page->context, pageCells, pageCells,
+                      page->nodes.data(), pageCells);
+    pages.push_back(std::move(page));
+    return *pages.back();
+}
+
+void qrk::TextureAtlas::Upload(Page &page, const qrk::Image &image, int x,
+                               int y, int width, int height) {
+    //the whole cell is written, past the image its edge pixels repeat
+    int stride = image.channels == Q_TEXT_TEXTURE ? 1 : image.channels;
+    staging.resize(static_cast<size_t>(width) * height * 4);
+    unsigned char *pixel = staging.data();
+    for (int row = 0; row < height; row++) {
+        int sourceRow = std::clamp(row - gutter, 0, image.height - 1);
+        for (int column = 0; column < width; column++, pixel += 4) {
+            int sourceColumn = std::clamp(column - gutter, 0, image.width - 1);
+            const unsigned char *source =
+                    image.imageData +
+                    (static_cast<size_t>(sourceRow) * image.width +
+                     sourceColumn) *
+                            stride;
+            //expanded like the swizzles of Texture2D::LoadFromImage
+            switch (image.channels) {
+                case STBI_grey:
+                    pixel[0] = pixel[1] = pixel[2] = source[0];
+                    pixel[3] = 255;
+                    break;
+                case Q_TEXT_TEXTURE:
+                    pixel[0] = pixel[1] = pixel[2] = pixel[3] = source[0];
+                    break;
+                case STBI_grey_alpha:
+                    pixel[0] = pixel[1] = pixel[2] = source[0];
+                    pixel[3] = source[1];
+                    break;
+                case STBI_rgb:
+                    pixel[0] = source[0];
+                    pixel[1] = source[1];
+                    pixel[2] = source[2];
+                    pixel[3] = 255;
+                    break;
+                default:
+                    std::copy(source, source + 4, pixel);
+                    break;
+            }
+        }
+    }
+    page.texture.Update(x, y, width, height, staging.data());
+    if (settings.mipLevels > 1) { page.mipmapsDirty = true; }
+}
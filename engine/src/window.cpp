@@ -1,4 +1,5 @@
 #include "../include/window.hpp"
+#include "../include/GL_assets.hpp"
 
 LRESULT CALLBACK qrk::glWindow::Process(HWND hWnd, UINT message, WPARAM wParam,
                                         LPARAM lParam) {
@@ -26,7 +27,8 @@ LRESULT qrk::glWindow::WndProcess(UINT message, WPARAM wParam, LPARAM lParam) {
                 qrk::vec2u size(
                         {(unsigned int) rect.right - (unsigned int) rect.left,
                          (unsigned int) rect.bottom - (unsigned int) rect.top});
-                glViewport(0, 0, size.x(), size.y());
+                //a detached context is resized by the thread that owns it
+                if (!contextDetached) { glViewport(0, 0, size.x(), size.y()); }
                 this->windowSize = size;
             }
             break;
@@ -35,7 +37,9 @@ LRESULT qrk::glWindow::WndProcess(UINT message, WPARAM wParam, LPARAM lParam) {
             this->Open = false;
             return NULL;
         case WM_ACTIVATE:
-            if (wParam == WA_CLICKACTIVE) { MakeContextCurrent(); }
+            if (wParam == WA_CLICKACTIVE && !contextDetached) {
+                MakeContextCurrent();
+            }
             break;
         case WM_MOUSEMOVE:
             if (mouseMovedCallback != nullptr) {
@@ -223,6 +227,10 @@ bool qrk::glWindow::CreateContext(int multisamplingLevel, int glMajorVersion,
         qrk::debug::LogError("Could not initialize GLAD");
         return false;
     }
+    qrk::assets::LoadParallelShaderCompile(
+            [](const char *name) { return (void *) wglGetProcAddress(name); });
+    //nothing is bound in a new context
+    qrk::glState.Invalidate();
     return true;
 }
 
@@ -5,11 +5,10 @@ in vec4 f_color;
 
 out vec4 finalColor;
 
-uniform bool textured;
-uniform sampler2D f_texture;
+//untextured sprites sample a white texture
+layout(binding = 0) uniform sampler2D f_texture;
 
 void main()
 {
-	if(textured) { finalColor = texture(f_texture, f_texturePos) * vec4(f_color.x, f_color.z, f_color.y, f_color.w); }
-	else { finalColor = f_color; }
+	finalColor = texture(f_texture, f_texturePos) * f_color;
 }
\ No newline at end of file
@@ -2,25 +2,28 @@
 
 layout (location = 0) in vec2 vertexPos;
 layout (location = 1) in vec2 texturePos;
+//per sprite attributes, position and size are in pixels
+layout (location = 2) in vec4 positionSize;
+layout (location = 3) in vec4 uvRect;
+layout (location = 4) in vec4 color;
+layout (location = 5) in vec2 rotationLayer;
 
-layout(std140, row_major) uniform uniformBlock{
-	mat4 rotation;
-    vec2 position;
-    vec2 size;
-    vec4 color;
-    float zLayer;
-};
+//set by the sprite batch
+layout (location = 0) uniform vec2 screenSize;
 
 out vec2 f_texturePos;
 out vec4 f_color;
 
 void main()
 {
-    f_texturePos = texturePos;
+    f_texturePos = uvRect.xy + texturePos * uvRect.zw;
     f_color = color;
-    vec4 vPos = vec4(vertexPos * size, 0, 1);
-    vPos = rotation * vPos;
-    vec4 finalPos = vPos + vec4(position, 0, 0);
-    finalPos.z = zLayer;
-    gl_Position = finalPos;
+    float s = sin(rotationLayer.x);
+    float c = cos(rotationLayer.x);
+    vec2 corner = vertexPos * positionSize.zw * 0.5;
+    corner = vec2(c * corner.x - s * corner.y, s * corner.x + c * corner.y);
+    vec2 halfScreen = screenSize * 0.5;
+    vec2 center = (positionSize.xy - halfScreen) / halfScreen;
+    center.y = -center.y;
+    gl_Position = vec4(center + corner / halfScreen, rotationLayer.y, 1);
 }
\ No newline at end of file
@@ -3,9 +3,24 @@
 #define Q_POINT 0
 #define Q_DIRECTIONAL 1
 
-uniform sampler2D inTexture;
-uniform bool textured;
+//cluster grid, must match light_clusters.hpp
+#define Q_CLUSTERS_X 16
+#define Q_CLUSTERS_Y 9
+#define Q_CLUSTERS_Z 24
 
+//specialized like 3d_vertex_shader.vert
+
+layout(binding = 0) uniform sampler2D inTexture;
+
+layout(std140, row_major) uniform uniformBlock{
+	mat4 view;
+	mat4 projection;
+	vec3 cameraPosition;
+	//maps log(w) to a cluster slice, scale then bias
+	vec4 clusterDepth;
+};
+
+#if !VERTEX_FORMAT
 struct LightSource
 {
 	int lightType;
@@ -28,10 +43,19 @@ struct Material
 	vec3 ambient;
 };
 
-layout(std430, binding = 4) buffer lightSources{
+layout(std430, binding = 4) readonly buffer lightSources{
 	LightSource sources[];
 };
 
+//offset and count of every cluster's range in lightIndices
+layout(std430, binding = 7) readonly buffer lightClusters{
+	uvec2 clusters[];
+};
+
+layout(std430, binding = 8) readonly buffer lightIndices{
+	uint indices[];
+};
+
 in vec3 f_normals;
 in vec2 f_textures;
 in vec4 f_color;
@@ -53,28 +77,46 @@ vec3 CalculatePointSource(LightSource source)
 	//attenuation
 	float dist = length(source.position - f_transformedVertices.xyz);
 	float attentuation = 1.0f / (source.constant + source.linear * dist + source.quadratic * (dist * dist));
+	//past the range LightRange computes for the clusters the light is dropped, so
+	//the result does not depend on which lights share a cluster
+	float brightest = max(max(max(source.ambient.r, source.ambient.g), source.ambient.b),
+		max(max(max(source.diffuse.r, source.diffuse.g), source.diffuse.b),
+		max(max(source.specular.r, source.specular.g), source.specular.b)));
+	if(attentuation * brightest < 1.0f / 256.0f) { return vec3(0.f); }
 	//combine
 	vec3 ambient_F = source.ambient * f_material.ambient;
 	vec3 diffuse_F = diffuse * source.diffuse * f_material.diffuse;
 	vec3 specular_F = specular * source.specular * f_material.specular;
 
-	return specular_F + diffuse_F + ambient_F;
+	return (specular_F + diffuse_F + ambient_F) * attentuation;
 }
 
 void main()
 {
-	vec3 lightResult;
-	if(sources.length() != 0){
-		for(int i = 0; i < sources.length(); i++){
-			if(sources[i].lightType == Q_POINT) { lightResult += CalculatePointSource(sources[i]); }
-		}
+#if NUM_LIGHTS
+	vec3 lightResult = vec3(0.f);
+	//only the point lights binned into this fragment's cluster
+	vec2 tile = (f_transformedVertices.xy / f_transformedVertices.w) * 0.5f + 0.5f;
+	int slice = int(floor(log(f_transformedVertices.w) * clusterDepth.x + clusterDepth.y));
+	ivec3 cluster = clamp(ivec3(tile * vec2(Q_CLUSTERS_X, Q_CLUSTERS_Y), slice),
+		ivec3(0), ivec3(Q_CLUSTERS_X - 1, Q_CLUSTERS_Y - 1, Q_CLUSTERS_Z - 1));
+	uvec2 range = clusters[(cluster.z * Q_CLUSTERS_Y + cluster.y) * Q_CLUSTERS_X + cluster.x];
+	for(uint i = 0; i < range.y; i++){
+		lightResult += CalculatePointSource(sources[indices[range.x + i]]);
 	}
-	else {lightResult = vec3(1.f, 1.f, 1.f);}
+#else
+	vec3 lightResult = vec3(1.f, 1.f, 1.f);
+#endif
 
-	if(textured){
-		outColor = texture(inTexture, f_textures) * f_color * vec4(lightResult, 1.f);
-	}
-	else{
-		outColor = f_color * vec4(lightResult, 1.f);
-	}
-}
\ No newline at end of file
+#if TEXTURED
+	outColor = texture(inTexture, f_textures) * f_color * vec4(lightResult, 1.f);
+#else
+	outColor = f_color * vec4(lightResult, 1.f);
+#endif
+}
+#else
+//only the depth is written
+void main()
+{
+}
+#endif
\ No newline at end of file
@@ -1,5 +1,10 @@
 #version 460 core
 
+//specialized by ProgramVariants, every feature is defined to 0 or 1:
+//TEXTURED samples the texture of the draw, NUM_LIGHTS 1 shades with the
+//clustered point lights and 0 draws unlit, VERTEX_FORMAT 1 reads only the
+//position and writes only the depth for the pre-pass
+
 struct Material
 {
 	float shininess;
@@ -9,6 +14,7 @@ struct Material
 };
 
 layout (location = 0) in vec4 vertLocation;
+#if !VERTEX_FORMAT
 layout (location = 1) in vec2 textureLoaction;
 layout (location = 2) in vec3 normalLoaction;
 
@@ -18,29 +24,52 @@ out vec4 f_color;
 out vec4 f_transformedVertices;
 out vec3 f_cameraPosition;
 out Material f_material;
+#endif
+
+struct Instance
+{
+	mat4 model;
+	vec4 color;
+	uint material;
+};
 
 layout(std140, row_major) uniform uniformBlock{
-	mat4 position;
-	mat4 rotation;
-	mat4 scale;
 	mat4 view;
 	mat4 projection;
-	vec4 color;
 	vec3 cameraPosition;
-	Material material;
+	//maps log(w) to a cluster slice, scale then bias
+	vec4 clusterDepth;
 };
 
+layout(std430, row_major, binding = 5) readonly buffer instanceData{
+	Instance instances[];
+};
+
+layout(std430, binding = 6) readonly buffer materialData{
+	Material materials[];
+};
+
+//the depth pre-pass variant computes the same position, the color pass
+//tests its depth for equality
+invariant gl_Position;
+
 void main()
 {
-	vec4 vertexTransformed = projection * view * position * rotation * scale * vertLocation;
+	Instance instance = instances[gl_BaseInstance + gl_InstanceID];
+	mat4 transform = projection * view * instance.model;
+
+	vec4 vertexTransformed = transform * vertLocation;
 	gl_Position = vertexTransformed;
+#if !VERTEX_FORMAT
 	f_transformedVertices = vertexTransformed;
-	mat3 normalMatrix = mat3(projection * view * rotation * scale);
+	//the translation does not reach the upper 3x3 of an affine model matrix
+	mat3 normalMatrix = mat3(transform);
 	normalMatrix = transpose(inverse(normalMatrix));
 
 	f_normals = normalize(normalMatrix * normalLoaction);
 	f_textures = textureLoaction;
-	f_color = color;
+	f_color = instance.color;
 	f_cameraPosition = cameraPosition;
-	f_material = material;
+	f_material = materials[instance.material];
+#endif
 }
\ No newline at end of file
@@ -3,7 +3,7 @@
 in vec4 f_color;
 in vec2 f_texturePosition;
 
-uniform sampler2D f_texture;
+layout(binding = 0) uniform sampler2D f_texture;
 
 out vec4 color;
 
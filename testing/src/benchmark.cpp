@@ -0,0 +1,1103 @@
+#include <../include/render_window.hpp>
+#include <../include/dynamic_bvh.hpp>
+#include <../include/gl_state.hpp>
+#include <../include/glyph_renderer.hpp>
+#include <../include/mesh_pool.hpp>
+#include <../include/misc_functions.hpp>
+#include <../include/object.hpp>
+#include <../include/occlusion_culler.hpp>
+#include <../include/rect.hpp>
+#include <../include/scene_graph.hpp>
+#include <../include/texture_atlas.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <optional>
+#ifdef Q_NULL_GL
+#include <../include/null_gl.hpp>
+#endif
+
+//every heap allocation of the process, so the benchmarks can check that
+//frames stop allocating once they reach a steady size
+std::atomic<size_t> heapAllocations = 0;
+void *operator new(size_t bytes) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *memory = std::malloc(bytes == 0 ? 1 : bytes)) { return memory; }
+    throw std::bad_alloc();
+}
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, size_t) noexcept { std::free(memory); }
+
+//renderer throughput benchmarks, results go to the console and the log
+struct BenchmarkResult {
+    float frameTime = 0.f;
+    float drawsPerMs = 0.f;
+    float allocationsPerFrame = 0.f;
+    size_t frameArenaBytes = 0;
+    qrk::FrameTiming passes;
+    qrk::GLStateStats state;
+#ifdef Q_NULL_GL
+    //GL work is deterministic without a driver, so it is reported exactly
+    size_t drawsPerFrame = 0;
+    qrk::nullgl::FrameStats setup;
+    qrk::nullgl::FrameStats frame;
+#endif
+};
+
+void Report(const std::string &name, const BenchmarkResult &result) {
+    std::string report =
+            name + ": " +
+            qrk::misc::to_string_precision(result.frameTime, 3) +
+            " ms/frame, " +
+            qrk::misc::to_string_precision(result.drawsPerMs, 1) +
+            " draws/ms";
+    auto time = [](const qrk::PassTiming &timing) {
+        return qrk::misc::to_string_precision(timing.cpu, 3) + "/" +
+               qrk::misc::to_string_precision(timing.gpu, 3);
+    };
+    report += "\n    cpu/gpu ms: total " + time(result.passes.total);
+    for (size_t pass = 0; pass < qrk::Q_PASS_COUNT; pass++) {
+        const char *name = qrk::PassName(static_cast<qrk::DrawPass>(pass));
+        report += std::string(", ") + name + " " +
+                  time(result.passes.passes[pass]);
+    }
+    //samples that passed the depth test, their ratio to the covered
+    //samples is the overdraw of the pass
+    report += "\n    samples:";
+    for (size_t pass = 0; pass < qrk::Q_PASS_COUNT; pass++) {
+        const char *name = qrk::PassName(static_cast<qrk::DrawPass>(pass));
+        report += std::string(pass == 0 ? " " : ", ") + name + " " +
+                  std::to_string(result.passes.passes[pass].samples);
+    }
+    report += "\n    memory: " +
+              qrk::misc::to_string_precision(result.allocationsPerFrame, 2) +
+              " heap allocations/frame, " +
+              std::to_string(result.frameArenaBytes) +
+              " bytes frame arena high water mark";
+    //binds and uniforms the state cache dropped in the last frame
+    report += "\n    state cache: " +
+              std::to_string(result.state.TotalIssued()) + " issued, " +
+              std::to_string(result.state.TotalElided()) + " elided";
+    for (size_t kind = 0; kind < qrk::Q_STATE_KIND_COUNT; kind++) {
+        const char *name =
+                qrk::StateKindName(static_cast<qrk::GLStateKind>(kind));
+        report += std::string(kind == 0 ? " (" : ", ") + name + " " +
+                  std::to_string(result.state.issued[kind]) + "/" +
+                  std::to_string(result.state.elided[kind]);
+    }
+    report += ")";
+#ifdef Q_NULL_GL
+    const qrk::nullgl::FrameStats &frame = result.frame;
+    report += "\n    setup: " + std::to_string(result.setup.calls) +
+              " GL calls, " + std::to_string(result.setup.bytesUploaded) +
+              " bytes uploaded";
+    report += "\n    frame: " + std::to_string(frame.calls) + " GL calls (" +
+              qrk::misc::to_string_precision(
+                      (float) frame.calls / (float) result.drawsPerFrame, 3) +
+              " per draw), " + std::to_string(frame.stateChanges) +
+              " state changes, " + std::to_string(frame.drawCalls) +
+              " draw calls, " + std::to_string(frame.indirectCommands) +
+              " indirect commands, " + std::to_string(frame.instances) +
+              " instances, " + std::to_string(frame.bytesUploaded) +
+              " bytes uploaded";
+    for (const auto &[call, count] : frame.callCounts) {
+        report += "\n        " + call + ": " + std::to_string(count);
+    }
+#endif
+    std::cout << report << std::endl;
+    qrk::debug::Log(report);
+}
+
+//submits the same mixed 3d, 2d and text scene every frame. With more than
+//one record thread every thread fills its own draw list. A retained scene
+//is registered once and only moves a hundredth of its cubes every frame
+BenchmarkResult RunSubmissionBenchmark(const std::string &name,
+                                       qrk::RenderWindowSettings settings,
+                                       int recordThreads = 1,
+                                       bool retained = false,
+                                       int frames = 300) {
+    constexpr int objectCount = 1000;
+    constexpr int rectCount = 5000;
+    constexpr int textCount = 100;
+    constexpr int lightCount = 256;
+
+    qrk::RenderWindow window(qrk::vec2u({800, 800}), name, settings);
+    //a render thread owns the context, resources are created while holding it
+    std::optional<qrk::ScopedContext> context(std::in_place, window);
+    window.GetWindow().SetSwapInterval(0);
+    qrk::Texture2D texture("resources/textures/testTexture.png");
+    qrk::Font font("resources/fonts/slkscr.ttf", 20, 300);
+
+    qrk::GLObject cube("resources/objects/cube.obj");
+    std::vector<qrk::GLObject> objects(objectCount, cube);
+    for (int i = 0; i < objectCount; i++) {
+        objects[i].SetPosition((float) (i % 20) - 10.f,
+                               (float) (i / 20 % 20) - 10.f,
+                               -20.f - (float) (i / 400) * 5.f);
+        objects[i].SetScale(0.3f, 0.3f, 0.3f);
+    }
+    //point lights with falloff spread over the clip space the cubes are lit
+    //in, each only reaches the clusters around it
+    for (int i = 0; i < lightCount; i++) {
+        qrk::LightSource light(qrk::vec3f({(float) (i % 16) * 5.f - 40.f,
+                                           (float) (i / 16) * 5.f - 40.f,
+                                           20.f + (float) (i % 7) * 2.f}),
+                               {255, 200, 150, 255});
+        light.linear = 0.5f;
+        light.quadratic = 0.5f;
+        window.GetRenderer().AddLightSource(light);
+    }
+    std::vector<qrk::Rect> rects;
+    rects.reserve(rectCount);
+    for (int i = 0; i < rectCount; i++) {
+        rects.emplace_back(qrk::vec2f({8, 8}));
+        rects.back().SetPosition((float) (i % 100) * 8.f,
+                                 (float) (i / 100) * 8.f);
+        if (i % 2 == 0) { rects.back().SetTexture(texture); }
+    }
+    //every text needs its own buffers, so they are not copied
+    std::vector<qrk::Text> texts;
+    texts.reserve(textCount);
+    for (int i = 0; i < textCount; i++) {
+        texts.emplace_back(font);
+        texts.back().SetText("Text " + std::to_string(i));
+        texts.back().SetPosition((float) (i % 10) * 80.f,
+                                 (float) (i / 10) * 40.f);
+    }
+
+    if (retained) {
+        for (qrk::GLObject &object : objects) {
+            object.Register(window.GetRenderer());
+        }
+        for (qrk::Rect &rect : rects) { rect.Register(window.GetRenderer()); }
+        for (qrk::Text &text : texts) { text.Register(window.GetRenderer()); }
+    }
+
+    //records every n-th draw starting at first into the list, changed
+    //text meshes go into the frame arena
+    auto record = [&](qrk::DrawList &list, int first, int step) {
+        std::pmr::memory_resource *arena = window.GetRenderer().GetFrameArena();
+        for (int i = first; i < objectCount; i += step) {
+            list.QueueDraw(objects[i].GetDrawData());
+        }
+        for (int i = first; i < rectCount; i += step) {
+            list.QueueDraw(rects[i].GetDrawData());
+        }
+        for (int i = first; i < textCount; i += step) {
+            list.QueueDraw(texts[i].GetDrawData(arena));
+        }
+    };
+    std::vector<qrk::DrawList> lists(recordThreads);
+    //the record threads are started once, a thread per list
+    std::optional<qrk::JobPool> recorders;
+    if (recordThreads > 1) { recorders.emplace(recordThreads); }
+    context.reset();
+#ifdef Q_NULL_GL
+    qrk::nullgl::FrameStats setup = qrk::nullgl::Recorded();
+#endif
+
+    const size_t drawsPerFrame = objectCount + rectCount + textCount;
+    float totalTime = 0.f;
+    size_t measuredAllocations = 0;
+    int measuredFrames = 0;
+    for (int frame = 0; frame < frames && window.IsOpen(); frame++) {
+        window.GetWindow().GetWindowMessage();
+        window.ClearWindow();
+
+        size_t allocations = heapAllocations.load();
+        auto start = std::chrono::steady_clock::now();
+        if (retained) {
+            for (int i = 0; i < objectCount / 100; i++) {
+                objects[(frame * 10 + i) % objectCount].SetRotation(
+                        0.f, (float) frame, 0.f);
+            }
+        } else if (recordThreads > 1) {
+            recorders->ParallelFor(
+                    recordThreads, 1, [&](size_t begin, size_t end) {
+                        for (size_t t = begin; t < end; t++) {
+                            record(lists[t], (int) t, recordThreads);
+                            window.GetRenderer().SubmitDrawList(
+                                    lists[t], static_cast<uint32_t>(t));
+                        }
+                    });
+        } else {
+            for (qrk::GLObject &object : objects) {
+                window.QueueDraw(object.GetDrawData());
+            }
+            for (qrk::Rect &rect : rects) {
+                window.QueueDraw(rect.GetDrawData());
+            }
+            std::pmr::memory_resource *arena =
+                    window.GetRenderer().GetFrameArena();
+            for (qrk::Text &text : texts) {
+                window.QueueDraw(text.GetDrawData(arena));
+            }
+        }
+        window.Draw();
+        float frameTime = std::chrono::duration<float, std::milli>(
+                                  std::chrono::steady_clock::now() - start)
+                                  .count();
+        //skip warm up frames, until the lists and queues reached their size
+        if (frame >= 10) {
+            totalTime += frameTime;
+            measuredAllocations += heapAllocations.load() - allocations;
+            measuredFrames++;
+        }
+    }
+    BenchmarkResult result;
+    result.passes = window.GetRenderer().GetProfiler().GetAverage();
+    result.frameArenaBytes = window.GetRenderer().GetFrameArenaHighWaterMark();
+    result.state = qrk::glState.LastFrame();
+    window.Close();
+
+#ifdef Q_NULL_GL
+    result.drawsPerFrame = drawsPerFrame;
+    result.setup = std::move(setup);
+    result.frame = qrk::nullgl::LastFrame();
+#endif
+    if (measuredFrames == 0) { return result; }
+    result.frameTime = totalTime / (float) measuredFrames;
+    result.drawsPerMs = (float) drawsPerFrame / result.frameTime;
+    result.allocationsPerFrame =
+            (float) measuredAllocations / (float) measuredFrames;
+    return result;
+}
+
+//updates a city of 100 blocks, each with 10 buildings of 10 floors of 10
+//props, after moving every node, one block and nothing. After each the
+//world matrices are compared with multiplying the local matrices up the
+//parents
+bool RunSceneGraphBenchmark(qrk::JobPool *jobs, int frames = 30) {
+    qrk::SceneGraph scene;
+    std::vector<qrk::SceneNode> blocks;
+    std::vector<qrk::SceneNode> nodes;
+    for (int block = 0; block < 100; block++) {
+        blocks.push_back(scene.Add());
+        nodes.push_back(blocks.back());
+        for (int building = 0; building < 10; building++) {
+            qrk::SceneNode buildingNode = scene.Add(blocks.back());
+            scene.SetPosition(buildingNode,
+                              qrk::vec3f({(float) building * 2.f, 0, 0}));
+            nodes.push_back(buildingNode);
+            for (int floor = 0; floor < 10; floor++) {
+                qrk::SceneNode floorNode = scene.Add(buildingNode);
+                scene.SetPosition(floorNode,
+                                  qrk::vec3f({0, (float) floor * 3.f, 0}));
+                nodes.push_back(floorNode);
+                for (int prop = 0; prop < 10; prop++) {
+                    nodes.push_back(scene.Add(floorNode));
+                    scene.SetPosition(nodes.back(),
+                                      qrk::vec3f({(float) prop * 0.1f, 0,
+                                                  0.5f}));
+                }
+            }
+        }
+    }
+    scene.Update(jobs);
+
+    std::vector<qrk::mat4> expected(nodes.size());
+    std::vector<char> known(nodes.size());
+    auto world = [&](auto &&self, qrk::SceneNode node) -> const qrk::mat4 & {
+        if (known[node.slot]) { return expected[node.slot]; }
+        qrk::vec3f position = scene.GetPosition(node);
+        qrk::vec3f rotation = scene.GetRotation(node);
+        qrk::vec3f scale = scene.GetScale(node);
+        qrk::mat4 translation({1, 0, 0, position.x(), 0, 1, 0, position.y(),
+                               0, 0, 1, position.z(), 0, 0, 0, 1});
+        qrk::mat4 rotationMatrix = qrk::CreateRotationMatrix(
+                rotation.x(), rotation.y(), rotation.z());
+        qrk::mat4 scaleMatrix({scale.x(), 0, 0, 0, 0, scale.y(), 0, 0, 0, 0,
+                               scale.z(), 0, 0, 0, 0, 1});
+        qrk::mat4 local = translation * rotationMatrix * scaleMatrix;
+        qrk::SceneNode parent = scene.GetParent(node);
+        if (parent.IsValid()) {
+            qrk::mat4 parentWorld = self(self, parent);
+            local = parentWorld * local;
+        }
+        expected[node.slot] = local;
+        known[node.slot] = 1;
+        return expected[node.slot];
+    };
+    bool matches = true;
+    auto verify = [&]() {
+        std::fill(known.begin(), known.end(), 0);
+        for (qrk::SceneNode node : nodes) {
+            const qrk::mat4 &reference = world(world, node);
+            const qrk::mat4 *actual = scene.GetWorldMatrix(node);
+            if (actual == nullptr) {
+                matches = false;
+                continue;
+            }
+            for (int i = 0; i < 4; i++) {
+                for (int j = 0; j < 4; j++) {
+                    float value = reference.data[i][j];
+                    if (std::abs(actual->data[i][j] - value) >
+                        1e-4f * (1.f + std::abs(value))) {
+                        matches = false;
+                    }
+                }
+            }
+        }
+    };
+
+    auto measure = [&](auto &&change) {
+        float totalTime = 0.f;
+        for (int frame = 0; frame < frames; frame++) {
+            change(frame);
+            auto start = std::chrono::steady_clock::now();
+            scene.Update(jobs);
+            totalTime += std::chrono::duration<float, std::milli>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+        }
+        verify();
+        return qrk::misc::to_string_precision(totalTime / (float) frames, 3);
+    };
+    //measured one after the other, the operands of + are not sequenced
+    std::string allMoved = measure([&](int frame) {
+        for (qrk::SceneNode node : nodes) {
+            scene.SetRotation(node, qrk::vec3f({0, (float) frame, 0}));
+        }
+    });
+    std::string blockMoved = measure([&](int frame) {
+        scene.SetPosition(blocks[frame % blocks.size()],
+                          qrk::vec3f({(float) frame, 0, 0}));
+    });
+    std::string unchanged = measure([](int) {});
+    std::string report =
+            std::string("Scene graph ") + (jobs ? "on job pool" : "serial") +
+            ", " + std::to_string(scene.Size()) + " nodes: all moved " +
+            allMoved + " ms, one block moved " + blockMoved +
+            " ms, unchanged " + unchanged + " ms, world matrices " +
+            (matches ? "passed" : "failed");
+    std::cout << report << std::endl;
+    qrk::debug::Log(report);
+    if (!matches) {
+        qrk::debug::LogError("Scene graph world matrices do not match");
+    }
+    return matches;
+}
+
+//moves 100k boxes through a 200 unit cube, under a tenth of a unit every
+//frame, then looks at them through a camera and casts rays into them.
+//Afterwards the queries are compared with testing every box
+bool RunBVHBenchmark(int frames = 30) {
+    constexpr int objectCount = 100000;
+    qrk::DynamicBVH tree(0.25f);
+    std::vector<qrk::AABB> boxes(objectCount);
+    std::vector<uint32_t> proxies(objectCount);
+    auto place = [&](int object, int frame) {
+        float t = (float) frame * 0.002f + (float) object;
+        float center[3] = {std::sin(t * 0.37f) * 100.f,
+                           std::cos(t * 0.23f) * 100.f,
+                           std::sin(t * 0.11f + 1.f) * 100.f};
+        for (int i = 0; i < 3; i++) {
+            boxes[object].min[i] = center[i] - 0.5f;
+            boxes[object].max[i] = center[i] + 0.5f;
+        }
+    };
+    for (int object = 0; object < objectCount; object++) {
+        place(object, 0);
+        proxies[object] = tree.Insert(boxes[object], object);
+    }
+
+    float refitTime = 0.f;
+    float frustumTime = 0.f;
+    float rayTime = 0.f;
+    size_t reinserted = 0;
+    size_t visible = 0;
+    size_t hits = 0;
+    qrk::Frustum frustum = qrk::CreateFrustum(
+            qrk::CreatePerspectiveProjectionMatrix(1.f, 1.f, 0.1f, 150.f));
+    auto elapsed = [](std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<float, std::milli>(
+                       std::chrono::steady_clock::now() - start)
+                .count();
+    };
+    for (int frame = 1; frame <= frames; frame++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int object = 0; object < objectCount; object++) {
+            place(object, frame);
+            reinserted += tree.Move(proxies[object], boxes[object]);
+        }
+        refitTime += elapsed(start);
+
+        start = std::chrono::steady_clock::now();
+        tree.QueryFrustum(frustum, [&](uint32_t) {
+            visible++;
+            return true;
+        });
+        frustumTime += elapsed(start);
+
+        start = std::chrono::steady_clock::now();
+        for (int ray = 0; ray < 1000; ray++) {
+            float angle = (float) ray * 0.00628f;
+            tree.QueryRay(qrk::vec3f({0, 0, 0}),
+                          qrk::vec3f({std::cos(angle), std::sin(angle), 0.3f}),
+                          FLT_MAX, [&](uint32_t) {
+                              //the first box entered ends the ray
+                              hits++;
+                              return 0.f;
+                          });
+        }
+        rayTime += elapsed(start);
+    }
+
+    //the tree holds enlarged boxes, so a query has to report every object
+    //whose box passes the test, once, and only objects whose enlarged box
+    //passes it
+    bool matches = true;
+    std::vector<char> reported(objectCount);
+    auto compare = [&](auto &&query, auto &&test) {
+        std::fill(reported.begin(), reported.end(), 0);
+        query([&](uint32_t proxy) {
+            uint64_t object = tree.GetUserData(proxy);
+            if (object >= objectCount || proxies[object] != proxy ||
+                reported[object]) {
+                matches = false;
+                return;
+            }
+            reported[object] = 1;
+        });
+        for (int object = 0; object < objectCount; object++) {
+            if (reported[object] ? !test(tree.GetBox(proxies[object]))
+                                 : test(boxes[object])) {
+                matches = false;
+            }
+        }
+    };
+    qrk::mat4 view = qrk::LookAtMatrix(qrk::vec3f({0, 0, 0}),
+                                       qrk::vec3f({1.f, 0.2f, 0.5f}),
+                                       qrk::vec3f({0, 1, 0}));
+    qrk::Frustum wideFrustum = qrk::CreateFrustum(
+            qrk::CreatePerspectiveProjectionMatrix(70.f, 1.5f, 0.1f, 150.f) *
+            view);
+    for (const qrk::Frustum &query : {frustum, wideFrustum}) {
+        compare(
+                [&](auto &&callback) {
+                    tree.QueryFrustum(query, [&](uint32_t proxy) {
+                        callback(proxy);
+                        return true;
+                    });
+                },
+                [&](const qrk::AABB &box) {
+                    return qrk::TestFrustum(query, box) != qrk::Q_OUTSIDE;
+                });
+    }
+    for (int i = 0; i < 4; i++) {
+        qrk::AABB query;
+        for (int axis = 0; axis < 3; axis++) {
+            query.min[axis] = (float) (i * 30 - 60 + axis * 10) - 20.f;
+            query.max[axis] = query.min[axis] + 40.f;
+        }
+        compare(
+                [&](auto &&callback) {
+                    tree.QueryOverlap(query, [&](uint32_t proxy) {
+                        callback(proxy);
+                        return true;
+                    });
+                },
+                [&](const qrk::AABB &box) {
+                    return qrk::Overlaps(box, query);
+                });
+    }
+    for (int ray = 0; ray < 50; ray++) {
+        float angle = (float) ray * 0.125f;
+        qrk::vec3f origin({(float) ray - 25.f, 10.f, -20.f});
+        qrk::vec3f direction({std::cos(angle), std::sin(angle * 0.5f),
+                              std::sin(angle)});
+        float start[3] = {origin.x(), origin.y(), origin.z()};
+        float inverse[3] = {1.f / direction.x(), 1.f / direction.y(),
+                            1.f / direction.z()};
+        float maxDistance = 150.f;
+        auto enters = [&](const qrk::AABB &box, float &distance) {
+            return qrk::IntersectRay(box, start, inverse, maxDistance,
+                                     distance);
+        };
+        compare(
+                [&](auto &&callback) {
+                    tree.QueryRay(origin, direction, maxDistance,
+                                  [&](uint32_t proxy) {
+                                      callback(proxy);
+                                      return maxDistance;
+                                  });
+                },
+                [&](const qrk::AABB &box) {
+                    float distance;
+                    return enters(box, distance);
+                });
+        //clipping the ray to every confirmed hit still finds the closest
+        float closest = maxDistance;
+        tree.QueryRay(origin, direction, maxDistance, [&](uint32_t proxy) {
+            float distance;
+            if (enters(boxes[tree.GetUserData(proxy)], distance)) {
+                closest = std::min(closest, distance);
+            }
+            return closest;
+        });
+        float scanned = maxDistance;
+        for (const qrk::AABB &box : boxes) {
+            float distance;
+            if (enters(box, distance)) {
+                scanned = std::min(scanned, distance);
+            }
+        }
+        if (closest != scanned) { matches = false; }
+    }
+
+    auto average = [&](float value) {
+        return qrk::misc::to_string_precision(value / (float) frames, 3);
+    };
+    std::string report =
+            "BVH, " + std::to_string(objectCount) +
+            " moving boxes: refit " + average(refitTime) + " ms/frame (" +
+            std::to_string(reinserted / frames) + " reinserted), frustum " +
+            average(frustumTime) + " ms (" + std::to_string(visible / frames) +
+            " visible), 1000 rays " + average(rayTime) + " ms (" +
+            std::to_string(hits / frames) + " hits), height " +
+            std::to_string(tree.GetHeight()) + ", area ratio " +
+            qrk::misc::to_string_precision(tree.GetAreaRatio(), 1) +
+            ", queries match a full scan: " + (matches ? "passed" : "failed");
+    std::cout << report << std::endl;
+    qrk::debug::Log(report);
+    if (!matches) { qrk::debug::LogError("BVH queries missed boxes"); }
+    return matches;
+}
+
+//looks down a street of a 20x20 grid of buildings, turning a little every
+//frame, and tests 100k boxes scattered between them against the buildings.
+//The first and the last frame are checked against rays cast through the
+//pixel centers, and boxes placed right behind the buildings
+bool RunOcclusionBenchmark(qrk::JobPool *jobs, int frames = 30) {
+    //the cube is 2 units wide, buildings are 8 with 4 unit streets
+    qrk::Object cube("resources/objects/cube.obj", false);
+    qrk::Occluder occluder(cube);
+    std::vector<qrk::mat4> buildings;
+    for (int x = 0; x < 20; x++) {
+        for (int z = 0; z < 20; z++) {
+            float height = 10.f + (float) ((x * 7 + z * 13) % 20);
+            buildings.push_back(qrk::CreateModelMatrix(
+                    qrk::vec3f({(float) x * 12.f - 114.f, height * 0.5f,
+                                (float) z * -12.f - 6.f}),
+                    qrk::vec3f({0, 0, 0}),
+                    qrk::vec3f({4.f, height * 0.5f, 4.f})));
+        }
+    }
+    std::vector<qrk::AABB> boxes(100000);
+    for (size_t i = 0; i < boxes.size(); i++) {
+        float t = (float) i;
+        float center[3] = {std::sin(t * 0.37f) * 120.f,
+                           1.f + std::abs(std::sin(t * 0.11f)) * 20.f,
+                           std::cos(t * 0.23f) * 120.f - 120.f};
+        for (int axis = 0; axis < 3; axis++) {
+            boxes[i].min[axis] = center[axis] - 0.5f;
+            boxes[i].max[axis] = center[axis] + 0.5f;
+        }
+    }
+
+    qrk::OcclusionCuller culler;
+    qrk::mat4 projection =
+            qrk::CreatePerspectiveProjectionMatrix(1.f, 2.f, 1.f, 500.f);
+    const float eye[3] = {0, 2, 10};
+    std::vector<qrk::AABB> buildingBoxes;
+    for (const qrk::mat4 &model : buildings) {
+        buildingBoxes.push_back(
+                qrk::TransformAABB(occluder.GetBounds(), model));
+    }
+    //distance to the first building through every pixel center, in units
+    //of the ray direction
+    int width = culler.GetWidth();
+    int height = culler.GetHeight();
+    std::vector<float> buildingDistance(size_t(width) * height);
+    size_t missed = 0;
+    size_t leaked = 0;
+    size_t placed = 0;
+    auto check = [&](const qrk::mat4 &view, const qrk::mat4 &viewProjection,
+                     const qrk::Frustum &frustum) {
+        //the view rotates camera space into the world by its rows, and the
+        //projection scales camera x and y over the distance
+        auto ray = [&](float x, float y, float inverse[3]) {
+            float camera[3] = {(x / width * 2.f - 1.f) / projection.data[0][0],
+                               (1.f - y / height * 2.f) / projection.data[1][1],
+                               -1.f};
+            for (int axis = 0; axis < 3; axis++) {
+                float direction = view.data[0][axis] * camera[0] +
+                                  view.data[1][axis] * camera[1] +
+                                  view.data[2][axis] * camera[2];
+                inverse[axis] = 1.f / direction;
+            }
+        };
+        auto firstBuilding = [&](const float inverse[3], float maxDistance) {
+            float distance;
+            for (const qrk::AABB &building : buildingBoxes) {
+                if (qrk::IntersectRay(building, eye, inverse, maxDistance,
+                                      distance)) {
+                    maxDistance = distance;
+                }
+            }
+            return maxDistance;
+        };
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                float inverse[3];
+                ray((float) x + 0.5f, (float) y + 0.5f, inverse);
+                buildingDistance[size_t(y) * width + x] =
+                        firstBuilding(inverse, FLT_MAX);
+            }
+        }
+        //a box seen through a pixel center before any building has to be
+        //visible
+        for (const qrk::AABB &box : boxes) {
+            if (qrk::TestFrustum(frustum, box) == qrk::Q_OUTSIDE ||
+                culler.IsVisible(box)) {
+                continue;
+            }
+            float left = FLT_MAX, right = -FLT_MAX;
+            float top = FLT_MAX, bottom = -FLT_MAX;
+            for (int corner = 0; corner < 8; corner++) {
+                float position[3] = {(corner & 1) ? box.max[0] : box.min[0],
+                                     (corner & 2) ? box.max[1] : box.min[1],
+                                     (corner & 4) ? box.max[2] : box.min[2]};
+                float clip[4];
+                for (int i = 0; i < 4; i++) {
+                    clip[i] = viewProjection.data[i][0] * position[0] +
+                              viewProjection.data[i][1] * position[1] +
+                              viewProjection.data[i][2] * position[2] +
+                              viewProjection.data[i][3];
+                }
+                float x = (clip[0] / clip[3] * 0.5f + 0.5f) * width;
+                float y = (0.5f - clip[1] / clip[3] * 0.5f) * height;
+                left = std::min(left, x);
+                right = std::max(right, x);
+                top = std::min(top, y);
+                bottom = std::max(bottom, y);
+            }
+            bool seen = false;
+            int minX = std::max((int) std::floor(left), 0);
+            int maxX = std::min((int) std::ceil(right), width - 1);
+            int minY = std::max((int) std::floor(top), 0);
+            int maxY = std::min((int) std::ceil(bottom), height - 1);
+            for (int y = minY; y <= maxY && !seen; y++) {
+                for (int x = minX; x <= maxX && !seen; x++) {
+                    float inverse[3];
+                    ray((float) x + 0.5f, (float) y + 0.5f, inverse);
+                    float distance;
+                    seen = qrk::IntersectRay(
+                            box, eye, inverse,
+                            buildingDistance[size_t(y) * width + x], distance);
+                }
+            }
+            missed += seen;
+        }
+        //a box past a building, with every corner of a box three times its
+        //size hidden by that building, has to be culled
+        for (const qrk::AABB &building : buildingBoxes) {
+            float center[3];
+            for (int axis = 0; axis < 3; axis++) {
+                center[axis] = eye[axis] +
+                               ((building.min[axis] + building.max[axis]) *
+                                        0.5f -
+                                eye[axis]) *
+                                       1.5f;
+            }
+            qrk::AABB box, margin;
+            for (int axis = 0; axis < 3; axis++) {
+                box.min[axis] = center[axis] - 0.25f;
+                box.max[axis] = center[axis] + 0.25f;
+                margin.min[axis] = center[axis] - 0.75f;
+                margin.max[axis] = center[axis] + 0.75f;
+            }
+            if (qrk::TestFrustum(frustum, margin) != qrk::Q_INSIDE) {
+                continue;
+            }
+            bool hidden = true;
+            for (int corner = 0; corner < 8 && hidden; corner++) {
+                float inverse[3];
+                for (int axis = 0; axis < 3; axis++) {
+                    float position = (corner & (1 << axis)) ? margin.max[axis]
+                                                            : margin.min[axis];
+                    inverse[axis] = 1.f / (position - eye[axis]);
+                }
+                float distance;
+                hidden = qrk::IntersectRay(building, eye, inverse, 1.f,
+                                           distance);
+            }
+            if (!hidden) { continue; }
+            placed++;
+            leaked += culler.IsVisible(box);
+        }
+    };
+    float rasterTime = 0.f;
+    float testTime = 0.f;
+    size_t inFrustum = 0;
+    size_t visible = 0;
+    auto elapsed = [](std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<float, std::milli>(
+                       std::chrono::steady_clock::now() - start)
+                .count();
+    };
+    for (int frame = 0; frame < frames; frame++) {
+        float angle = (float) frame * 0.01f;
+        qrk::mat4 view = qrk::LookAtMatrix(
+                qrk::vec3f({0, 2, 10}),
+                qrk::vec3f({std::sin(angle), 2, 9.f - std::cos(angle)}),
+                qrk::vec3f({0, 1, 0}));
+        qrk::mat4 viewProjection = projection * view;
+        qrk::Frustum frustum = qrk::CreateFrustum(viewProjection);
+
+        auto start = std::chrono::steady_clock::now();
+        culler.BeginFrame(viewProjection);
+        for (const qrk::mat4 &model : buildings) {
+            culler.AddOccluder(occluder, model);
+        }
+        culler.RenderOccluders(jobs);
+        rasterTime += elapsed(start);
+
+        start = std::chrono::steady_clock::now();
+        for (const qrk::AABB &box : boxes) {
+            if (qrk::TestFrustum(frustum, box) == qrk::Q_OUTSIDE) {
+                continue;
+            }
+            inFrustum++;
+            visible += culler.IsVisible(box);
+        }
+        testTime += elapsed(start);
+        if (frame == 0 || frame == frames - 1) {
+            check(view, viewProjection, frustum);
+        }
+    }
+    auto average = [&](float value) {
+        return qrk::misc::to_string_precision(value / (float) frames, 3);
+    };
+    std::string report =
+            std::string("Occlusion culling ") +
+            (jobs ? "on job pool" : "serial") + ", " +
+            std::to_string(buildings.size()) + " occluders (" +
+            std::to_string(culler.GetRasterizedTriangleCount()) +
+            " triangles drawn): rasterize " + average(rasterTime) +
+            " ms, test " + std::to_string(boxes.size()) + " boxes " +
+            average(testTime) + " ms, " + std::to_string(visible / frames) +
+            " of " + std::to_string(inFrustum / frames) +
+            " in the frustum visible, " + std::to_string(missed) +
+            " hidden but seen by rays, " + std::to_string(leaked) + " of " +
+            std::to_string(placed) + " boxes behind buildings visible";
+    std::cout << report << std::endl;
+    qrk::debug::Log(report);
+    if (missed != 0) {
+        qrk::debug::LogError("Occlusion culling hid visible boxes");
+    }
+    if (leaked != 0 || placed == 0) {
+        qrk::debug::LogError("Occlusion culling kept hidden boxes");
+    }
+    return missed == 0 && leaked == 0 && placed != 0;
+}
+
+//registers a mesh with a pool, deletes its object and uploads a different
+//mesh with as many vertices into its range. Then fills one buffer name with
+//two meshes in turn, like GL reusing the name of a deleted buffer. The pool
+//has to copy the new mesh every time
+bool RunMeshPoolCheck() {
+    qrk::RenderWindow window(qrk::vec2u({64, 64}), "Benchmark - mesh pool");
+    qrk::assets::MeshPool pool;
+    pool.Create(64);
+    qrk::Object cube("resources/objects/cube.obj", false);
+    qrk::Object smallCube("resources/objects/cube.obj", false);
+    for (size_t vertex = 0; vertex < smallCube.data.size(); vertex += 9) {
+        for (int i = 0; i < 3; i++) { smallCube.data[vertex + i] *= 0.5f; }
+    }
+    auto holds = [&](GLint first, const std::vector<GLfloat> &data) {
+#ifdef Q_NULL_GL
+        //the null backend keeps no buffer contents
+        return true;
+#else
+        std::vector<GLfloat> copied(data.size());
+        glGetNamedBufferSubData(pool.GetBuffer(),
+                                static_cast<GLintptr>(first) *
+                                        qrk::assets::MeshPool::vertexStride,
+                                static_cast<GLsizeiptr>(data.size() *
+                                                        sizeof(GLfloat)),
+                                copied.data());
+        return copied == data;
+#endif
+    };
+
+    GLint first = 0;
+    {
+        qrk::GLObject object(cube);
+        qrk::DrawData_3D draw = object.GetDrawData();
+        first = pool.Register(draw.mesh, draw.VBO, draw.vertexCount);
+    }
+    pool.CollectReleased();
+    qrk::GLObject object(smallCube);
+    qrk::DrawData_3D draw = object.GetDrawData();
+    bool replaced =
+            pool.Register(draw.mesh, draw.VBO, draw.vertexCount) == first &&
+            pool.GetMeshCount() == 1 && holds(first, smallCube.data);
+
+    GLuint buffer = 0;
+    GLsizeiptr bytes =
+            static_cast<GLsizeiptr>(cube.data.size() * sizeof(GLfloat));
+    glCreateBuffers(1, &buffer);
+    glNamedBufferData(buffer, bytes, cube.data.data(), GL_STATIC_DRAW);
+    uint32_t mesh = qrk::assets::MeshPool::CreateId();
+    pool.Register(mesh, buffer, cube.vertexNumber);
+    pool.Unregister(mesh);
+    glNamedBufferData(buffer, bytes, smallCube.data.data(), GL_STATIC_DRAW);
+    GLint reused = pool.Register(qrk::assets::MeshPool::CreateId(), buffer,
+                                 cube.vertexNumber);
+    bool renamed = holds(reused, smallCube.data);
+    qrk::glState.DeleteBuffers(1, &buffer);
+    window.Close();
+
+    std::string report =
+            std::string("Mesh pool, deleted mesh replaced: ") +
+            (replaced ? "passed" : "failed") + ", buffer name reused: " +
+            (renamed ? "passed" : "failed");
+    std::cout << report << std::endl;
+    qrk::debug::Log(report);
+    if (!replaced || !renamed) {
+        qrk::debug::LogError("Mesh pool kept a deleted mesh");
+    }
+    return replaced && renamed;
+}
+
+//draws 4000 sprites with an image of their own, once from a texture per
+//image and once from a texture atlas
+void RunAtlasBenchmark(bool atlas, int frames = 100) {
+    constexpr int spriteCount = 4000;
+    constexpr int imageSize = 16;
+
+    qrk::RenderWindow window(qrk::vec2u({800, 800}), "Benchmark - atlas");
+    window.GetWindow().SetSwapInterval(0);
+    std::vector<std::unique_ptr<qrk::Image>> images;
+    for (int i = 0; i < spriteCount; i++) {
+        //freed by the image with stbi_image_free
+        auto *pixels = static_cast<unsigned char *>(
+                std::malloc(imageSize * imageSize * 4));
+        for (int pixel = 0; pixel < imageSize * imageSize; pixel++) {
+            pixels[pixel * 4] = static_cast<unsigned char>(i);
+            pixels[pixel * 4 + 1] = static_cast<unsigned char>(i >> 8);
+            pixels[pixel * 4 + 2] = static_cast<unsigned char>(pixel);
+            pixels[pixel * 4 + 3] = 255;
+        }
+        images.push_back(std::make_unique<qrk::Image>());
+        images.back()->LoadFromData(pixels, imageSize, imageSize, 4);
+    }
+
+    qrk::TextureAtlas textureAtlas;
+    std::vector<qrk::Texture2D> textures(atlas ? 0 : spriteCount);
+    std::vector<qrk::AtlasRegion> regions;
+    if (atlas) {
+        std::vector<const qrk::Image *> packed;
+        for (const auto &image : images) { packed.push_back(image.get()); }
+        regions = textureAtlas.Add(packed);
+    }
+    std::vector<qrk::Rect> rects;
+    rects.reserve(spriteCount);
+    for (int i = 0; i < spriteCount; i++) {
+        rects.emplace_back(qrk::vec2f({8, 8}));
+        rects.back().SetPosition((float) (i % 100) * 8.f,
+                                 (float) (i / 100) * 8.f);
+        if (atlas) {
+            rects.back().SetTexture(regions[i]);
+        } else {
+            textures[i].LoadFromImage(*images[i]);
+            rects.back().SetTexture(textures[i]);
+        }
+    }
+
+    float totalTime = 0.f;
+    int measuredFrames = 0;
+    for (int frame = 0; frame < frames && window.IsOpen(); frame++) {
+        window.GetWindow().GetWindowMessage();
+        window.ClearWindow();
+        auto start = std::chrono::steady_clock::now();
+        for (qrk::Rect &rect : rects) { window.QueueDraw(rect.GetDrawData()); }
+        window.Draw();
+        if (frame >= 10) {
+            totalTime += std::chrono::duration<float, std::milli>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+            measuredFrames++;
+        }
+    }
+    std::string storage = "in their own textures";
+    if (atlas) {
+        storage = "in " + std::to_string(textureAtlas.GetPageCount()) +
+                  " atlas pages (" +
+                  qrk::misc::to_string_precision(
+                          textureAtlas.GetOccupancy() * 100.f, 1) +
+                  "% used)";
+    }
+    qrk::GLStateStats state = qrk::glState.LastFrame();
+    std::string report =
+            "Sprites, " + std::to_string(spriteCount) + " images " + storage +
+            ": " +
+            qrk::misc::to_string_precision(
+                    totalTime / (float) std::max(measuredFrames, 1), 3) +
+            " ms/frame, " + std::to_string(state.issued[qrk::Q_STATE_TEXTURE]) +
+            " texture binds";
+#ifdef Q_NULL_GL
+    report += ", " + std::to_string(qrk::nullgl::LastFrame().drawCalls) +
+              " draw calls";
+#endif
+    window.Close();
+    std::cout << report << std::endl;
+    qrk::debug::Log(report);
+}
+
+//draws 100k sprites in runs of 1000 with the same texture, cycling
+//through two textures and none, spread over four layers. The sort keeps
+//the submission order within a layer, so without a driver the frame has
+//to take one draw call per run of equal textures after sorting by layer
+bool RunMixedTextureBenchmark(int frames = 100) {
+    constexpr int spriteCount = 100000;
+    constexpr int runLength = 1000;
+    constexpr int layerCount = 4;
+
+    qrk::RenderWindow window(qrk::vec2u({800, 800}),
+                             "Benchmark - mixed textures");
+    window.GetWindow().SetSwapInterval(0);
+    qrk::Texture2D first("resources/textures/testTexture.png");
+    qrk::Texture2D second("resources/textures/testTexture.png");
+    qrk::Texture2D *textures[] = {&first, &second, nullptr};
+    std::vector<qrk::Rect> rects;
+    rects.reserve(spriteCount);
+    //layer and texture of every sprite, in submission order
+    std::vector<std::pair<float, qrk::Texture2D *>> order;
+    for (int i = 0; i < spriteCount; i++) {
+        rects.emplace_back(qrk::vec2f({4, 4}));
+        rects.back().SetPosition((float) (i % 200) * 4.f,
+                                 (float) (i / 200 % 200) * 4.f);
+        float layer = (float) (i / runLength % layerCount) * 0.25f;
+        qrk::Texture2D *texture = textures[i / runLength % 3];
+        rects.back().SetLayer(layer);
+        if (texture != nullptr) { rects.back().SetTexture(*texture); }
+        order.push_back({layer, texture});
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [](const auto &a, const auto &b) {
+                         return a.first < b.first;
+                     });
+    size_t runs = 1;
+    for (size_t i = 1; i < order.size(); i++) {
+        runs += order[i].second != order[i - 1].second;
+    }
+
+    float totalTime = 0.f;
+    int measuredFrames = 0;
+    for (int frame = 0; frame < frames && window.IsOpen(); frame++) {
+        window.GetWindow().GetWindowMessage();
+        window.ClearWindow();
+        auto start = std::chrono::steady_clock::now();
+        for (qrk::Rect &rect : rects) { window.QueueDraw(rect.GetDrawData()); }
+        window.Draw();
+        if (frame >= 10) {
+            totalTime += std::chrono::duration<float, std::milli>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+            measuredFrames++;
+        }
+    }
+    qrk::GLStateStats state = qrk::glState.LastFrame();
+    std::string report =
+            "Sprites, " + std::to_string(spriteCount) +
+            " with mixed textures on " + std::to_string(layerCount) +
+            " layers: " +
+            qrk::misc::to_string_precision(
+                    totalTime / (float) std::max(measuredFrames, 1), 3) +
+            " ms/frame, " + std::to_string(state.issued[qrk::Q_STATE_TEXTURE]) +
+            " texture binds, " +
+            std::to_string(state.issued[qrk::Q_STATE_PROGRAM]) +
+            " program changes";
+    bool batched = true;
+#ifdef Q_NULL_GL
+    size_t drawCalls = qrk::nullgl::LastFrame().drawCalls;
+    batched = drawCalls == runs;
+    report += ", " + std::to_string(drawCalls) + " draw calls (" +
+              std::to_string(runs) + " expected)";
+#endif
+    window.Close();
+    std::cout << report << std::endl;
+    qrk::debug::Log(report);
+    if (!batched) { qrk::debug::LogError("Mixed texture sprites not batched"); }
+    return batched;
+}
+
+int run() {
+    bool passed = RunMeshPoolCheck();
+    passed = RunBVHBenchmark() && passed;
+    passed = RunOcclusionBenchmark(nullptr) && passed;
+    passed = RunSceneGraphBenchmark(nullptr) && passed;
+    {
+        qrk::JobPool jobs;
+        passed = RunOcclusionBenchmark(&jobs) && passed;
+        passed = RunSceneGraphBenchmark(&jobs) && passed;
+    }
+
+    qrk::RenderWindowSettings settings;
+    settings.renderSettings.profilePasses = true;
+    settings.renderSettings.persistentMapping = false;
+    Report("glBufferSubData uniforms",
+           RunSubmissionBenchmark("Benchmark - subdata", settings));
+    settings.renderSettings.persistentMapping = true;
+    Report("Persistent ring buffer uniforms",
+           RunSubmissionBenchmark("Benchmark - ring buffer", settings));
+    settings.renderSettings.depthPrepass = true;
+    Report("Depth pre-pass",
+           RunSubmissionBenchmark("Benchmark - depth pre-pass", settings));
+    settings.renderSettings.depthPrepass = false;
+    Report("Retained scene",
+           RunSubmissionBenchmark("Benchmark - retained", settings, 1, true));
+    Report("Parallel draw lists",
+           RunSubmissionBenchmark("Benchmark - draw lists", settings, 4));
+    settings.renderThread = true;
+    Report("Render thread",
+           RunSubmissionBenchmark("Benchmark - render thread", settings));
+    RunAtlasBenchmark(false);
+    RunAtlasBenchmark(true);
+    passed = RunMixedTextureBenchmark() && passed;
+    return passed ? 0 : 1;
+}
+
+#include <../include/qrk_debug.hpp>
+#ifdef SUBSYSTEM_CONSOLE
+int main(){
+    try {
+        return run();
+    } catch (std::exception &e) {
+        try {
+            return std::stoi(e.what());
+        } catch (...) {
+            const std::string error(e.what());
+            qrk::debug::ShowErrorBox(error);
+            qrk::debug::LogError(error);
+            return -1;
+        }
+    } catch (...) {
+        qrk::debug::LogError("Unhandled exception");
+        return -1;
+    }
+}
+#elif SUBSYSTEM_WINDOWS
+int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR pCmdLine, int nCmdShow) {
+    try {
+        return run();
+    } catch (std::exception &e) {
+        try {
+            return std::stoi(e.what());
+        } catch (...) {
+            const std::string error(e.what());
+            qrk::debug::ShowErrorBox(error);
+            qrk::debug::LogError(error);
+            return -1;
+        }
+    } catch (...) {
+        qrk::debug::LogError("Unhandled exception");
+        return -1;
+    }
+}
+#endif